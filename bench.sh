@@ -0,0 +1,32 @@
+#!/bin/bash
+# Runs every benchmark config below on the connected Quest and pulls the
+# results to bench-results/<commit>/, one JSON file per config. Build and
+# install first.
+CONFIGS=(
+    "name=baseline,objects=100,triangles=12,overdraw=1"
+    "name=objects,objects=4000,triangles=12,overdraw=1"
+    "name=triangles,objects=100,triangles=20000,overdraw=1"
+    "name=overdraw,objects=400,triangles=2,overdraw=8"
+)
+DEVICE_DIR=/sdcard/Android/data/com.makepad.hello_quest/files
+OUT=bench-results/$(git rev-parse --short HEAD)
+mkdir -p $OUT
+
+for config in "${CONFIGS[@]}"; do
+    name=$(echo $config | sed 's/.*name=\([^,]*\).*/\1/')
+    result=$DEVICE_DIR/bench-$name.json
+    echo "bench $name"
+    ./stop.sh
+    adb shell rm -f $result
+    adb shell setprop debug.hello_quest.bench "$config"
+    ./start.sh > /dev/null
+    # the app exits by itself once the results are written
+    for i in $(seq 120); do
+        adb shell test -f $result && break
+        sleep 2
+    done
+    adb pull $result $OUT/ > /dev/null || echo "bench $name: no results"
+done
+
+adb shell setprop debug.hello_quest.bench "''"
+./stop.sh
@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/eventfd.h>
 #include <sys/resource.h>
 
 #include "android_native_app_glue.h"
@@ -47,18 +48,13 @@ static void free_saved_state(struct android_app* android_app) {
 }
 
 int8_t android_app_read_cmd(struct android_app* android_app) {
-    int8_t cmd;
-    if (read(android_app->msgread, &cmd, sizeof(cmd)) == sizeof(cmd)) {
-        switch (cmd) {
-            case APP_CMD_SAVE_STATE:
-                free_saved_state(android_app);
-                break;
-        }
-        return cmd;
-    } else {
-        LOGE("No data on command pipe!");
+    int8_t cmd = cmd_ring_pop(&android_app->cmdRing);
+    switch (cmd) {
+        case APP_CMD_SAVE_STATE:
+            free_saved_state(android_app);
+            break;
     }
-    return -1;
+    return cmd;
 }
 
 static void print_cur_config(struct android_app* android_app) {
@@ -199,10 +195,18 @@ static void process_input(struct android_app* app, struct android_poll_source* s
 }
 
 static void process_cmd(struct android_app* app, struct android_poll_source* source) {
-    int8_t cmd = android_app_read_cmd(app);
-    android_app_pre_exec_cmd(app, cmd);
-    if (app->onAppCmd != NULL) app->onAppCmd(app, cmd);
-    android_app_post_exec_cmd(app, cmd);
+    // Reset the eventfd before draining, so a command posted while we drain
+    // re-arms it and at worst causes one spurious wakeup, never a lost one.
+    uint64_t count;
+    if (read(app->cmdEventFd, &count, sizeof(count)) != sizeof(count) && errno != EAGAIN) {
+        LOGE("Failure reading android_app cmd eventfd: %s\n", strerror(errno));
+    }
+    int8_t cmd;
+    while ((cmd = android_app_read_cmd(app)) >= 0) {
+        android_app_pre_exec_cmd(app, cmd);
+        if (app->onAppCmd != NULL) app->onAppCmd(app, cmd);
+        android_app_post_exec_cmd(app, cmd);
+    }
 }
 
 static void* android_app_entry(void* param) {
@@ -221,7 +225,7 @@ static void* android_app_entry(void* param) {
     android_app->inputPollSource.process = process_input;
 
     ALooper* looper = ALooper_prepare(ALOOPER_PREPARE_ALLOW_NON_CALLBACKS);
-    ALooper_addFd(looper, android_app->msgread, LOOPER_ID_MAIN, ALOOPER_EVENT_INPUT, NULL,
+    ALooper_addFd(looper, android_app->cmdEventFd, LOOPER_ID_MAIN, ALOOPER_EVENT_INPUT, NULL,
             &android_app->cmdPollSource);
     android_app->looper = looper;
 
@@ -255,13 +259,11 @@ static struct android_app* android_app_create(ANativeActivity* activity,
         memcpy(android_app->savedState, savedState, savedStateSize);
     }
 
-    int msgpipe[2];
-    if (pipe(msgpipe)) {
-        LOGE("could not create pipe: %s", strerror(errno));
+    android_app->cmdEventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (android_app->cmdEventFd < 0) {
+        LOGE("could not create eventfd: %s", strerror(errno));
         return NULL;
     }
-    android_app->msgread = msgpipe[0];
-    android_app->msgwrite = msgpipe[1];
 
     pthread_attr_t attr; 
     pthread_attr_init(&attr);
@@ -279,8 +281,17 @@ static struct android_app* android_app_create(ANativeActivity* activity,
 }
 
 static void android_app_write_cmd(struct android_app* android_app, int8_t cmd) {
-    if (write(android_app->msgwrite, &cmd, sizeof(cmd)) != sizeof(cmd)) {
-        LOGE("Failure writing android_app cmd: %s\n", strerror(errno));
+    if (!cmd_ring_push(&android_app->cmdRing, cmd)) {
+        // Only possible if the app thread stops servicing its looper.
+        LOGE("android_app cmd ring full, waiting for app thread\n");
+        while (!cmd_ring_push(&android_app->cmdRing, cmd)) {
+            sched_yield();
+        }
+    }
+
+    uint64_t one = 1;
+    if (write(android_app->cmdEventFd, &one, sizeof(one)) != sizeof(one)) {
+        LOGE("Failure signalling android_app cmd: %s\n", strerror(errno));
     }
 }
 
@@ -326,8 +337,7 @@ static void android_app_free(struct android_app* android_app) {
     }
     pthread_mutex_unlock(&android_app->mutex);
 
-    close(android_app->msgread);
-    close(android_app->msgwrite);
+    close(android_app->cmdEventFd);
     pthread_cond_destroy(&android_app->cond);
     pthread_mutex_destroy(&android_app->mutex);
     free(android_app);
@@ -22,6 +22,8 @@
 #include <pthread.h>
 #include <sched.h>
 
+#include "cmd_ring.h"
+
 #include <android/configuration.h>
 #include <android/looper.h>
 #include <android/native_activity.h>
@@ -167,8 +169,11 @@ struct android_app {
     pthread_mutex_t mutex;
     pthread_cond_t cond;
 
-    int msgread;
-    int msgwrite;
+    // Commands flow from the activity's main thread (the only producer)
+    // to the app thread (the only consumer) through this lock-free ring.
+    // cmdEventFd is signalled after every post so the app's ALooper wakes.
+    int cmdEventFd;
+    struct cmd_ring cmdRing;
 
     pthread_t thread;
 
@@ -313,7 +318,8 @@ enum {
 
 /**
  * Call when ALooper_pollAll() returns LOOPER_ID_MAIN, reading the next
- * app command message.
+ * app command message.  Returns -1 once no more commands are pending, so
+ * keep calling it until then: several commands may share one wakeup.
  */
 int8_t android_app_read_cmd(struct android_app* android_app);
 
@@ -0,0 +1,81 @@
+#include "arena.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LOGI(...) log_write(LOG_CATEGORY_APP, LOG_PRIORITY_INFO, __VA_ARGS__)
+#define LOGE(...) log_write(LOG_CATEGORY_APP, LOG_PRIORITY_ERROR, __VA_ARGS__)
+
+void arena_create(struct arena* arena, const char* name, size_t capacity) {
+    memset(arena, 0, sizeof(*arena));
+    arena->name = name;
+    arena->base = malloc(capacity);
+    if (arena->base == NULL) {
+        LOGE("can't allocate %zu bytes for arena %s", capacity, name);
+        exit(EXIT_FAILURE);
+    }
+    arena->capacity = capacity;
+}
+
+void arena_destroy(struct arena* arena) {
+    free(arena->base);
+    arena->base = NULL;
+    arena->capacity = 0;
+    arena->offset = 0;
+}
+
+void* arena_alloc(struct arena* arena, size_t size, size_t align) {
+    size_t offset = (arena->offset + align - 1) & ~(align - 1);
+    if (offset + size > arena->capacity) {
+        LOGE("arena %s exhausted: %zu bytes requested, %zu of %zu used",
+             arena->name, size, arena->offset, arena->capacity);
+        exit(EXIT_FAILURE);
+    }
+    arena->offset = offset + size;
+    if (arena->offset > arena->high_water) {
+        arena->high_water = arena->offset;
+    }
+    return arena->base + offset;
+}
+
+void* arena_calloc(struct arena* arena, size_t size, size_t align) {
+    void* memory = arena_alloc(arena, size, align);
+    memset(memory, 0, size);
+    return memory;
+}
+
+void arena_report(const struct arena* arena) {
+    LOGI("arena %s: %zu used, high water %zu of %zu bytes",
+         arena->name, arena->offset, arena->high_water, arena->capacity);
+}
+
+void frame_arena_create(struct frame_arena* frame_arena, size_t capacity) {
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i) {
+        arena_create(&frame_arena->arenas[i], "frame", capacity);
+    }
+    frame_arena->current = &frame_arena->arenas[0];
+}
+
+void frame_arena_destroy(struct frame_arena* frame_arena) {
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i) {
+        arena_destroy(&frame_arena->arenas[i]);
+    }
+    frame_arena->current = NULL;
+}
+
+struct arena* frame_arena_begin(struct frame_arena* frame_arena, uint64_t frame_index) {
+    struct arena* arena = &frame_arena->arenas[frame_index % FRAMES_IN_FLIGHT];
+    arena_reset(arena);
+    frame_arena->current = arena;
+    return arena;
+}
+
+size_t frame_arena_high_water(const struct frame_arena* frame_arena) {
+    size_t high_water = 0;
+    for (int i = 0; i < FRAMES_IN_FLIGHT; ++i) {
+        if (frame_arena->arenas[i].high_water > high_water) {
+            high_water = frame_arena->arenas[i].high_water;
+        }
+    }
+    return high_water;
+}
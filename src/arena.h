@@ -0,0 +1,60 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of frames the CPU may run ahead of the GPU/compositor. Frame arena
+// memory handed out for frame N stays valid until frame N + FRAMES_IN_FLIGHT
+// starts.
+#define FRAMES_IN_FLIGHT 3
+
+// A linear allocator over a single fixed block. Allocations are only ever
+// released all at once, either by arena_reset or by rewinding to a mark.
+struct arena {
+    const char* name;
+    uint8_t* base;
+    size_t capacity;
+    size_t offset;
+    size_t high_water;
+};
+
+struct frame_arena {
+    struct arena arenas[FRAMES_IN_FLIGHT];
+    struct arena* current;
+};
+
+void arena_create(struct arena* arena, const char* name, size_t capacity);
+void arena_destroy(struct arena* arena);
+
+// Never returns NULL; running out of space is a budgeting bug and fatal.
+void* arena_alloc(struct arena* arena, size_t size, size_t align);
+void* arena_calloc(struct arena* arena, size_t size, size_t align);
+
+#define arena_push_array(arena, type, count) \
+    ((type*)arena_calloc((arena), sizeof(type) * (count), _Alignof(type)))
+
+static inline size_t arena_mark(const struct arena* arena) {
+    return arena->offset;
+}
+
+static inline void arena_rewind(struct arena* arena, size_t mark) {
+    arena->offset = mark;
+}
+
+static inline void arena_reset(struct arena* arena) {
+    arena->offset = 0;
+}
+
+void arena_report(const struct arena* arena);
+
+void frame_arena_create(struct frame_arena* frame_arena, size_t capacity);
+void frame_arena_destroy(struct frame_arena* frame_arena);
+
+// Select and reset the arena for the given frame. Call once per frame, right
+// after xrWaitFrame returns.
+struct arena* frame_arena_begin(struct frame_arena* frame_arena, uint64_t frame_index);
+
+size_t frame_arena_high_water(const struct frame_arena* frame_arena);
+
+#endif /* _ARENA_H */
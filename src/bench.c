@@ -0,0 +1,213 @@
+#include "bench.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LOGI(...) log_write(LOG_CATEGORY_APP, LOG_PRIORITY_INFO, __VA_ARGS__)
+#define LOGE(...) log_write(LOG_CATEGORY_APP, LOG_PRIORITY_ERROR, __VA_ARGS__)
+
+static const char* PHASE_NAMES[BENCH_PHASE_COUNT] = {
+        "wait", "update", "begin", "cull", "render", "submit", "cpu", "frame", "gpu",
+};
+
+static const struct bench_config DEFAULT_CONFIG = {
+        .name = "default",
+        .objects = 500,
+        .triangles = 200,
+        .overdraw = 1,
+        .warmup = 120,
+        .frames = 600,
+};
+
+static int64_t bench_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static bool bench_parse(struct bench_config* config, const char* spec) {
+    *config = DEFAULT_CONFIG;
+    char copy[256];
+    snprintf(copy, sizeof(copy), "%s", spec);
+    char* save = NULL;
+    for (char* pair = strtok_r(copy, ",", &save); pair != NULL; pair = strtok_r(NULL, ",", &save)) {
+        char* value = strchr(pair, '=');
+        if (value == NULL) {
+            LOGE("bench: expected key=value, got %s", pair);
+            return false;
+        }
+        *value++ = '\0';
+        if (strcmp(pair, "name") == 0) {
+            snprintf(config->name, sizeof(config->name), "%s", value);
+            continue;
+        }
+        char* end;
+        unsigned long number = strtoul(value, &end, 10);
+        if (*end != '\0') {
+            LOGE("bench: %s is not a number", value);
+            return false;
+        }
+        if (strcmp(pair, "objects") == 0) {
+            config->objects = (uint32_t)number;
+        } else if (strcmp(pair, "triangles") == 0) {
+            config->triangles = (uint32_t)number;
+        } else if (strcmp(pair, "overdraw") == 0) {
+            config->overdraw = (uint32_t)number;
+        } else if (strcmp(pair, "warmup") == 0) {
+            config->warmup = (uint32_t)number;
+        } else if (strcmp(pair, "frames") == 0) {
+            config->frames = (uint32_t)number;
+        } else {
+            LOGE("bench: unknown key %s", pair);
+            return false;
+        }
+    }
+    if (config->overdraw == 0 || config->frames == 0 || config->frames > BENCH_MAX_FRAMES) {
+        LOGE("bench: overdraw has to be at least 1 and frames 1 to %d", BENCH_MAX_FRAMES);
+        return false;
+    }
+    return true;
+}
+
+void bench_init(struct bench* bench, const char* spec) {
+    memset(bench, 0, sizeof(*bench));
+    if (!bench_parse(&bench->config, spec)) {
+        LOGE("bench: bad spec \"%s\", benchmark off", spec);
+        return;
+    }
+    arena_create(&bench->arena, "bench", BENCH_ARENA_SIZE);
+    for (int i = 0; i < BENCH_PHASE_COUNT; i++) {
+        bench->samples[i] = arena_alloc(&bench->arena, bench->config.frames * sizeof(float), sizeof(float));
+    }
+    bench->warmup_left = bench->config.warmup;
+    bench->enabled = true;
+    LOGI("bench %s: %u objects, %u triangles each, overdraw %u, %u frames after %u warmup",
+         bench->config.name, bench->config.objects, bench->config.triangles, bench->config.overdraw,
+         bench->config.frames, bench->config.warmup);
+}
+
+void bench_destroy(struct bench* bench) {
+    if (bench->enabled) {
+        arena_destroy(&bench->arena);
+        bench->enabled = false;
+    }
+}
+
+void bench_frame_begin(struct bench* bench) {
+    if (!bench_running(bench)) {
+        return;
+    }
+    bench->frame_start = bench_time_ns();
+    bench->mark = bench->frame_start;
+    memset(bench->current, 0, sizeof(bench->current));
+}
+
+void bench_phase_end(struct bench* bench, enum bench_phase phase) {
+    if (!bench_running(bench)) {
+        return;
+    }
+    int64_t now = bench_time_ns();
+    bench->current[phase] = (now - bench->mark) / 1e6f;
+    bench->mark = now;
+}
+
+static void bench_sample(struct bench* bench, enum bench_phase phase, float ms) {
+    if (bench->counts[phase] < bench->config.frames) {
+        bench->samples[phase][bench->counts[phase]++] = ms;
+    }
+}
+
+void bench_gpu(struct bench* bench, float ms) {
+    if (bench_running(bench) && bench->warmup_left == 0) {
+        bench_sample(bench, BENCH_PHASE_GPU, ms);
+    }
+}
+
+bool bench_frame_end(struct bench* bench, uint32_t draw_calls, bool missed) {
+    if (!bench_running(bench)) {
+        return false;
+    }
+    if (bench->warmup_left > 0) {
+        bench->warmup_left--;
+        return false;
+    }
+    bench->current[BENCH_PHASE_FRAME] = (bench->mark - bench->frame_start) / 1e6f;
+    bench->current[BENCH_PHASE_CPU] = bench->current[BENCH_PHASE_FRAME] - bench->current[BENCH_PHASE_WAIT];
+    for (int i = 0; i < BENCH_PHASE_COUNT; i++) {
+        if (i != BENCH_PHASE_GPU) {
+            bench_sample(bench, i, bench->current[i]);
+        }
+    }
+    bench->draw_calls += draw_calls;
+    bench->missed += missed;
+    if (bench->counts[BENCH_PHASE_FRAME] < bench->config.frames) {
+        return false;
+    }
+    bench->finished = true;
+    return true;
+}
+
+static int bench_compare(const void* a, const void* b) {
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// nearest rank, samples sorted
+static float bench_percentile(const float* samples, uint32_t count, uint32_t percent) {
+    uint32_t rank = (count * percent + 99) / 100;
+    return samples[rank > 0 ? rank - 1 : 0];
+}
+
+bool bench_write(struct bench* bench, const char* path, const char* renderer, float refresh_rate) {
+    // written aside and renamed, so whoever polls for the file never sees half of it
+    char temp_path[512];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE* file = fopen(temp_path, "w");
+    if (file == NULL) {
+        LOGE("bench: can't write %s", temp_path);
+        return false;
+    }
+    const struct bench_config* config = &bench->config;
+    uint32_t frames = bench->counts[BENCH_PHASE_FRAME];
+    fprintf(file, "{\n");
+    fprintf(file, "  \"name\": \"%s\",\n", config->name);
+    fprintf(file, "  \"config\": { \"objects\": %u, \"triangles\": %u, \"overdraw\": %u, \"warmup\": %u, "
+                  "\"frames\": %u },\n",
+            config->objects, config->triangles, config->overdraw, config->warmup, config->frames);
+    fprintf(file, "  \"renderer\": \"%s\",\n", renderer);
+    fprintf(file, "  \"refresh_rate\": %.1f,\n", refresh_rate);
+    fprintf(file, "  \"frames\": %u,\n", frames);
+    fprintf(file, "  \"missed_frames\": %u,\n", bench->missed);
+    fprintf(file, "  \"draw_calls_per_frame\": %.1f,\n", frames > 0 ? (double)bench->draw_calls / frames : 0.0);
+    fprintf(file, "  \"phases_ms\": {\n");
+    for (int i = 0; i < BENCH_PHASE_COUNT; i++) {
+        float* samples = bench->samples[i];
+        uint32_t count = bench->counts[i];
+        const char* separator = i + 1 < BENCH_PHASE_COUNT ? "," : "";
+        if (count == 0) {
+            fprintf(file, "    \"%s\": null%s\n", PHASE_NAMES[i], separator);
+            continue;
+        }
+        double sum = 0.0;
+        for (uint32_t j = 0; j < count; j++) {
+            sum += samples[j];
+        }
+        qsort(samples, count, sizeof(float), bench_compare);
+        fprintf(file, "    \"%s\": { \"samples\": %u, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, "
+                      "\"p99\": %.3f, \"max\": %.3f }%s\n",
+                PHASE_NAMES[i], count, sum / count, bench_percentile(samples, count, 50),
+                bench_percentile(samples, count, 90), bench_percentile(samples, count, 99), samples[count - 1],
+                separator);
+    }
+    fprintf(file, "  }\n");
+    fprintf(file, "}\n");
+    if (fclose(file) != 0 || rename(temp_path, path) != 0) {
+        LOGE("bench: can't write %s", path);
+        return false;
+    }
+    LOGI("bench %s: %u frames, %u missed, results in %s", config->name, frames, bench->missed, path);
+    return true;
+}
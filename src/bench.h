@@ -0,0 +1,88 @@
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include "arena.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Benchmark mode: the real frame loop runs over a synthetic scene for a
+// fixed number of frames, every phase of every frame is timed, and the
+// distributions are written as JSON so runs of two builds can be diffed.
+// Dynamic resolution, refresh rate and clock level changes are held off
+// while it runs, so every measured frame asks the same of the hardware.
+// Results are only comparable between runs on the same headset in the same
+// state; only the spec parser and percentiles are tested on the host.
+
+#define BENCH_MAX_FRAMES 4000
+// samples, and the synthetic mesh built by the app
+#define BENCH_ARENA_SIZE (2 * 1024 * 1024)
+
+enum bench_phase {
+    // xrWaitFrame
+    BENCH_PHASE_WAIT,
+    BENCH_PHASE_UPDATE,
+    // xrBeginFrame
+    BENCH_PHASE_BEGIN,
+    // locating the views, culling and starting the draw lists
+    BENCH_PHASE_CULL,
+    // both eyes, swapchain and draw list waits included
+    BENCH_PHASE_RENDER,
+    // quad layers and xrEndFrame
+    BENCH_PHASE_SUBMIT,
+    // the phases after xrWaitFrame
+    BENCH_PHASE_CPU,
+    BENCH_PHASE_FRAME,
+    // from the GPU timer, when it has a result
+    BENCH_PHASE_GPU,
+    BENCH_PHASE_COUNT,
+};
+
+struct bench_config {
+    char name[32];
+    uint32_t objects;
+    // per object
+    uint32_t triangles;
+    // layers of objects covering the same pixels
+    uint32_t overdraw;
+    uint32_t warmup;
+    uint32_t frames;
+};
+
+struct bench {
+    bool enabled;
+    bool finished;
+    struct bench_config config;
+    struct arena arena;
+    uint32_t warmup_left;
+    int64_t frame_start;
+    int64_t mark;
+    float current[BENCH_PHASE_COUNT];
+    float* samples[BENCH_PHASE_COUNT];
+    uint32_t counts[BENCH_PHASE_COUNT];
+    uint64_t draw_calls;
+    uint32_t missed;
+};
+
+// spec is comma separated key=value pairs, for example
+// "name=dense,objects=2000,triangles=200,overdraw=4,frames=600"; keys left
+// out keep their defaults. A bad spec leaves the benchmark off.
+void bench_init(struct bench* bench, const char* spec);
+void bench_destroy(struct bench* bench);
+
+static inline bool bench_running(const struct bench* bench) {
+    return bench->enabled && !bench->finished;
+}
+
+// At the start of a frame, then at the end of each of its phases in order.
+void bench_frame_begin(struct bench* bench);
+void bench_phase_end(struct bench* bench, enum bench_phase phase);
+void bench_gpu(struct bench* bench, float ms);
+
+// After each rendered frame. Returns true once, for the last measured one.
+bool bench_frame_end(struct bench* bench, uint32_t draw_calls, bool missed);
+
+// Writes the config, the environment and per phase percentiles in ms.
+// Sorts the samples.
+bool bench_write(struct bench* bench, const char* path, const char* renderer, float refresh_rate);
+
+#endif /* _BENCH_H */
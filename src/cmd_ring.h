@@ -0,0 +1,42 @@
+#ifndef _CMD_RING_H
+#define _CMD_RING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Lock-free ring of one byte commands, for exactly one producer thread and
+// one consumer thread. head and tail only ever grow; they are reduced to a
+// slot index when used, so a full ring is tail - head == CMD_RING_SIZE.
+
+// Must be a power of two.
+#define CMD_RING_SIZE 64
+
+struct cmd_ring {
+    uint32_t head;
+    uint32_t tail;
+    int8_t cmds[CMD_RING_SIZE];
+};
+
+// Producer only. Returns false, leaving the ring as it was, when it is full.
+static inline bool cmd_ring_push(struct cmd_ring* ring, int8_t cmd) {
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == CMD_RING_SIZE) {
+        return false;
+    }
+    ring->cmds[tail & (CMD_RING_SIZE - 1)] = cmd;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Consumer only. Returns -1 when the ring is empty.
+static inline int8_t cmd_ring_pop(struct cmd_ring* ring) {
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    if (head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+        return -1;
+    }
+    int8_t cmd = ring->cmds[head & (CMD_RING_SIZE - 1)];
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return cmd;
+}
+
+#endif /* _CMD_RING_H */
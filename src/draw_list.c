@@ -0,0 +1,61 @@
+#include "draw_list.h"
+
+// entities per segment, raised for scenes that would need more than
+// DRAW_LIST_MAX_SEGMENTS of them
+#define DRAW_LIST_JOB_GRAIN 256
+
+static void draw_list_record_segment(struct draw_list* list, uint32_t begin, uint32_t end) {
+    const struct entities* entities = list->entities;
+    struct draw_cmd* cmds = list->cmds;
+    uint32_t count = 2 * begin;
+    uint32_t mesh = UINT32_MAX;
+    for (uint32_t i = begin; i < end; i++) {
+        if (!(entities->visible[i] & list->view_bit)) {
+            continue;
+        }
+        // every segment binds its first mesh, so segments don't depend on each other
+        if (entities->meshes[i] != mesh) {
+            mesh = entities->meshes[i];
+            cmds[count++] = (struct draw_cmd) { DRAW_OP_MESH, (uint16_t)mesh, 0 };
+        }
+        cmds[count++] = (struct draw_cmd) { DRAW_OP_DRAW, 0, i };
+        XrMatrix4x4f_Multiply(&list->mvps[i], &list->view_proj, &entities->world[i]);
+        XrMatrix4x4f_Multiply(&list->prev_mvps[i], &list->view_proj, &entities->prev_world[i]);
+    }
+    list->segments[begin / list->grain] = (struct draw_segment) { 2 * begin, count };
+}
+
+// A range covers several segments when jobs_parallel_for runs it inline.
+static void draw_list_record_range(void* data, uint32_t begin, uint32_t end) {
+    struct draw_list* list = data;
+    while (begin < end) {
+        uint32_t segment_end = (begin / list->grain + 1) * list->grain;
+        if (segment_end > end) {
+            segment_end = end;
+        }
+        draw_list_record_segment(list, begin, segment_end);
+        begin = segment_end;
+    }
+}
+
+static void draw_list_record_job(void* data) {
+    struct draw_list* list = data;
+    jobs_parallel_for(list->jobs, list->entities->count, list->grain, draw_list_record_range, list);
+}
+
+void draw_list_record(struct draw_list* list, struct arena* arena, const struct entities* entities, uint32_t view,
+                      const XrMatrix4x4f* view_proj, struct jobs* jobs, struct job_counter* counter) {
+    uint32_t count = entities->count;
+    // every slot a segment may write is written before replay reads it, so no clearing
+    list->cmds = arena_alloc(arena, 2 * (size_t)count * sizeof(struct draw_cmd), _Alignof(struct draw_cmd));
+    list->mvps = arena_alloc(arena, (size_t)count * sizeof(XrMatrix4x4f), _Alignof(XrMatrix4x4f));
+    list->prev_mvps = arena_alloc(arena, (size_t)count * sizeof(XrMatrix4x4f), _Alignof(XrMatrix4x4f));
+    uint32_t grain = (count + DRAW_LIST_MAX_SEGMENTS - 1) / DRAW_LIST_MAX_SEGMENTS;
+    list->grain = grain > DRAW_LIST_JOB_GRAIN ? grain : DRAW_LIST_JOB_GRAIN;
+    list->segment_count = (count + list->grain - 1) / list->grain;
+    list->entities = entities;
+    list->jobs = jobs;
+    list->view_bit = (uint8_t)(1u << view);
+    list->view_proj = *view_proj;
+    jobs_run(jobs, draw_list_record_job, list, counter);
+}
@@ -0,0 +1,64 @@
+#ifndef _DRAW_LIST_H
+#define _DRAW_LIST_H
+
+#include "arena.h"
+#include "entities.h"
+#include "jobs.h"
+#include <stdint.h>
+
+// Per-view list of draws in a compact, API-agnostic form. Lists are
+// recorded on the job system, one job per view and one segment per chunk
+// of entities, and replayed by the thread that owns the GL context. A
+// chunk writes at most two commands per entity into its own slice of the
+// buffer, so recording needs no synchronisation; replay walks the
+// segments in order.
+//
+// Commands refer to entities by dense index, which stays valid until the
+// entity store changes, so lists must be recorded after the scene update
+// and replayed before the next one. Recording also computes the
+// model-view-projection matrices of the entities drawn, current and
+// previous, so the GL thread only has to upload them. Commands and
+// matrices are allocated from the frame arena handed to draw_list_record.
+
+enum draw_op {
+    DRAW_OP_MESH,
+    DRAW_OP_DRAW,
+};
+
+struct draw_cmd {
+    uint16_t op;
+    // DRAW_OP_MESH: geometry heap mesh the draws that follow use
+    uint16_t mesh;
+    // DRAW_OP_DRAW: entity whose world and prev_world matrices to draw with
+    uint32_t entity;
+};
+
+#define DRAW_LIST_MAX_SEGMENTS 64
+
+struct draw_segment {
+    uint32_t begin;
+    uint32_t end;
+};
+
+struct draw_list {
+    struct draw_cmd* cmds;
+    // by entity index, valid for the entities drawn
+    XrMatrix4x4f* mvps;
+    XrMatrix4x4f* prev_mvps;
+    struct draw_segment segments[DRAW_LIST_MAX_SEGMENTS];
+    uint32_t segment_count;
+    // the recording in flight
+    const struct entities* entities;
+    struct jobs* jobs;
+    uint8_t view_bit;
+    XrMatrix4x4f view_proj;
+    uint32_t grain;
+};
+
+// Record the entities visible in view (a bit of entities->visible) as seen
+// through view_proj. The list is complete once counter reaches zero, and
+// valid until arena is reset.
+void draw_list_record(struct draw_list* list, struct arena* arena, const struct entities* entities, uint32_t view,
+                      const XrMatrix4x4f* view_proj, struct jobs* jobs, struct job_counter* counter);
+
+#endif /* _DRAW_LIST_H */
@@ -0,0 +1,243 @@
+#include "entities.h"
+#include "log.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOGI(...) log_write(LOG_CATEGORY_APP, LOG_PRIORITY_INFO, __VA_ARGS__)
+#define LOGE(...) log_write(LOG_CATEGORY_APP, LOG_PRIORITY_ERROR, __VA_ARGS__)
+
+#define ENTITY_GENERATION_MAX (UINT32_MAX >> ENTITY_INDEX_BITS)
+
+static size_t entities_size(uint32_t capacity) {
+    size_t per_slot = 2 * sizeof(uint32_t);
+    size_t per_entity = sizeof(uint32_t) + sizeof(XrVector3f) * 2 + sizeof(XrQuaternionf) +
+                        sizeof(struct entity_bounds) + sizeof(uint16_t) * 2 + sizeof(uint32_t) +
+                        sizeof(XrMatrix4x4f) * 2 + sizeof(uint8_t);
+    // slack for the alignment of each of the arrays
+    return (per_slot + per_entity) * capacity + 16 * 16;
+}
+
+void entities_create(struct entities* entities, uint32_t capacity) {
+    memset(entities, 0, sizeof(*entities));
+    if (capacity > ENTITY_MAX) {
+        LOGE("entity capacity %u over the maximum of %u", capacity, ENTITY_MAX);
+        exit(EXIT_FAILURE);
+    }
+    struct arena* arena = &entities->arena;
+    arena_create(arena, "entities", entities_size(capacity));
+    entities->capacity = capacity;
+    entities->generations = arena_push_array(arena, uint32_t, capacity);
+    entities->slot_dense = arena_push_array(arena, uint32_t, capacity);
+    entities->handles = arena_push_array(arena, uint32_t, capacity);
+    entities->positions = arena_push_array(arena, XrVector3f, capacity);
+    entities->rotations = arena_push_array(arena, XrQuaternionf, capacity);
+    entities->scales = arena_push_array(arena, XrVector3f, capacity);
+    entities->bounds = arena_push_array(arena, struct entity_bounds, capacity);
+    entities->meshes = arena_push_array(arena, uint16_t, capacity);
+    entities->materials = arena_push_array(arena, uint16_t, capacity);
+    entities->nodes = arena_push_array(arena, uint32_t, capacity);
+    entities->world = arena_push_array(arena, XrMatrix4x4f, capacity);
+    entities->prev_world = arena_push_array(arena, XrMatrix4x4f, capacity);
+    entities->visible = arena_push_array(arena, uint8_t, capacity);
+    entities->free_slot = ENTITY_INVALID;
+    LOGI("entity store for %u entities, %zu bytes", capacity, arena->offset);
+}
+
+void entities_destroy(struct entities* entities) {
+    arena_destroy(&entities->arena);
+    memset(entities, 0, sizeof(*entities));
+}
+
+uint32_t entity_create(struct entities* entities) {
+    if (entities->count == entities->capacity) {
+        return ENTITY_NULL;
+    }
+    uint32_t slot;
+    if (entities->free_slot != ENTITY_INVALID) {
+        slot = entities->free_slot;
+        entities->free_slot = entities->slot_dense[slot];
+    } else {
+        slot = entities->slot_count++;
+        entities->generations[slot] = 1;
+    }
+    uint32_t dense = entities->count++;
+    uint32_t handle = (entities->generations[slot] << ENTITY_INDEX_BITS) | slot;
+    entities->slot_dense[slot] = dense;
+    entities->handles[dense] = handle;
+    entities->positions[dense] = (XrVector3f) { 0.0f, 0.0f, 0.0f };
+    entities->rotations[dense] = (XrQuaternionf) { 0.0f, 0.0f, 0.0f, 1.0f };
+    entities->scales[dense] = (XrVector3f) { 1.0f, 1.0f, 1.0f };
+    entities->bounds[dense] = (struct entity_bounds) { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+    entities->meshes[dense] = 0;
+    entities->materials[dense] = 0;
+    entities->nodes[dense] = ENTITY_NO_NODE;
+    XrMatrix4x4f_CreateTranslation(&entities->world[dense], 0.0f, 0.0f, 0.0f);
+    entities->prev_world[dense] = entities->world[dense];
+    entities->visible[dense] = (1u << ENTITIES_MAX_VIEWS) - 1;
+    return handle;
+}
+
+uint32_t entity_index(const struct entities* entities, uint32_t handle) {
+    uint32_t slot = handle & ENTITY_INDEX_MASK;
+    if (handle == ENTITY_NULL || slot >= entities->slot_count ||
+        entities->generations[slot] != handle >> ENTITY_INDEX_BITS) {
+        return ENTITY_INVALID;
+    }
+    return entities->slot_dense[slot];
+}
+
+void entity_destroy(struct entities* entities, uint32_t handle) {
+    uint32_t dense = entity_index(entities, handle);
+    if (dense == ENTITY_INVALID) {
+        LOGE("destroying stale entity handle %08x", handle);
+        return;
+    }
+    uint32_t slot = handle & ENTITY_INDEX_MASK;
+    uint32_t last = --entities->count;
+    if (dense != last) {
+        uint32_t moved = entities->handles[last];
+        entities->handles[dense] = moved;
+        entities->positions[dense] = entities->positions[last];
+        entities->rotations[dense] = entities->rotations[last];
+        entities->scales[dense] = entities->scales[last];
+        entities->bounds[dense] = entities->bounds[last];
+        entities->meshes[dense] = entities->meshes[last];
+        entities->materials[dense] = entities->materials[last];
+        entities->nodes[dense] = entities->nodes[last];
+        entities->world[dense] = entities->world[last];
+        entities->prev_world[dense] = entities->prev_world[last];
+        entities->visible[dense] = entities->visible[last];
+        entities->slot_dense[moved & ENTITY_INDEX_MASK] = dense;
+    }
+    // wrap around, skipping 0, so a slot is reused 4095 times before handles repeat
+    uint32_t generation = entities->generations[slot] + 1;
+    entities->generations[slot] = generation > ENTITY_GENERATION_MAX ? 1 : generation;
+    entities->slot_dense[slot] = entities->free_slot;
+    entities->free_slot = slot;
+}
+
+// Same result as XrMatrix4x4f_CreateTranslationRotationScale without the two
+// full matrix multiplies: the rotation columns are scaled in place.
+static inline void entity_compose(XrMatrix4x4f* result, const XrVector3f* t, const XrQuaternionf* q,
+                                  const XrVector3f* s) {
+    const float x2 = q->x + q->x;
+    const float y2 = q->y + q->y;
+    const float z2 = q->z + q->z;
+    const float xx2 = q->x * x2;
+    const float yy2 = q->y * y2;
+    const float zz2 = q->z * z2;
+    const float yz2 = q->y * z2;
+    const float wx2 = q->w * x2;
+    const float xy2 = q->x * y2;
+    const float wz2 = q->w * z2;
+    const float xz2 = q->x * z2;
+    const float wy2 = q->w * y2;
+
+    result->m[0] = (1.0f - yy2 - zz2) * s->x;
+    result->m[1] = (xy2 + wz2) * s->x;
+    result->m[2] = (xz2 - wy2) * s->x;
+    result->m[3] = 0.0f;
+    result->m[4] = (xy2 - wz2) * s->y;
+    result->m[5] = (1.0f - xx2 - zz2) * s->y;
+    result->m[6] = (yz2 + wx2) * s->y;
+    result->m[7] = 0.0f;
+    result->m[8] = (xz2 + wy2) * s->z;
+    result->m[9] = (yz2 - wx2) * s->z;
+    result->m[10] = (1.0f - xx2 - yy2) * s->z;
+    result->m[11] = 0.0f;
+    result->m[12] = t->x;
+    result->m[13] = t->y;
+    result->m[14] = t->z;
+    result->m[15] = 1.0f;
+}
+
+// entities per job; composing one is ~20ns, so this keeps jobs well above
+// the cost of scheduling them
+#define ENTITIES_JOB_GRAIN 1024
+
+static void entities_update_world_range(void* data, uint32_t begin, uint32_t end) {
+    struct entities* entities = data;
+    for (uint32_t i = begin; i < end; i++) {
+        if (entities->nodes[i] != ENTITY_NO_NODE) {
+            continue;
+        }
+        entity_compose(&entities->world[i], &entities->positions[i], &entities->rotations[i], &entities->scales[i]);
+    }
+}
+
+void entities_update_world(struct entities* entities, struct jobs* jobs) {
+    memcpy(entities->prev_world, entities->world, sizeof(XrMatrix4x4f) * entities->count);
+    if (jobs == NULL) {
+        entities_update_world_range(entities, 0, entities->count);
+        return;
+    }
+    jobs_parallel_for(jobs, entities->count, ENTITIES_JOB_GRAIN, entities_update_world_range, entities);
+}
+
+struct entities_cull {
+    struct entities* entities;
+    // plane i of view v is planes[v * 6 + i], as (nx, ny, nz, d) with the
+    // inside where n.p + d >= 0
+    float planes[ENTITIES_MAX_VIEWS * 6][4];
+    uint32_t view_count;
+};
+
+// Gribb-Hartmann: the clip planes are sums and differences of the rows of
+// the view-projection matrix. GL clip space, so near is w + z.
+static void entities_frustum_planes(float planes[6][4], const XrMatrix4x4f* m) {
+    for (int i = 0; i < 3; i++) {
+        for (int c = 0; c < 4; c++) {
+            float row_w = m->m[c * 4 + 3];
+            float row_i = m->m[c * 4 + i];
+            planes[i * 2][c] = row_w + row_i;
+            planes[i * 2 + 1][c] = row_w - row_i;
+        }
+    }
+}
+
+static void entities_cull_range(void* data, uint32_t begin, uint32_t end) {
+    struct entities_cull* cull = data;
+    struct entities* entities = cull->entities;
+    for (uint32_t i = begin; i < end; i++) {
+        const float* w = entities->world[i].m;
+        const struct entity_bounds* bounds = &entities->bounds[i];
+        // world space box around the transformed local box
+        float center[3];
+        float extents[3];
+        for (int r = 0; r < 3; r++) {
+            center[r] = w[r] * bounds->center.x + w[4 + r] * bounds->center.y + w[8 + r] * bounds->center.z +
+                        w[12 + r];
+            extents[r] = fabsf(w[r]) * bounds->extents.x + fabsf(w[4 + r]) * bounds->extents.y +
+                         fabsf(w[8 + r]) * bounds->extents.z;
+        }
+        uint8_t visible = 0;
+        for (uint32_t v = 0; v < cull->view_count; v++) {
+            bool inside = true;
+            for (int p = 0; p < 6 && inside; p++) {
+                const float* plane = cull->planes[v * 6 + p];
+                float distance = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+                float radius = fabsf(plane[0]) * extents[0] + fabsf(plane[1]) * extents[1] +
+                               fabsf(plane[2]) * extents[2];
+                inside = distance + radius >= 0.0f;
+            }
+            visible |= (uint8_t)(inside << v);
+        }
+        entities->visible[i] = visible;
+    }
+}
+
+void entities_cull(struct entities* entities, struct jobs* jobs, const XrMatrix4x4f* view_projs,
+                   uint32_t view_count) {
+    struct entities_cull cull;
+    cull.entities = entities;
+    cull.view_count = view_count < ENTITIES_MAX_VIEWS ? view_count : ENTITIES_MAX_VIEWS;
+    for (uint32_t v = 0; v < cull.view_count; v++) {
+        entities_frustum_planes(&cull.planes[v * 6], &view_projs[v]);
+    }
+    if (jobs == NULL) {
+        entities_cull_range(&cull, 0, entities->count);
+        return;
+    }
+    jobs_parallel_for(jobs, entities->count, ENTITIES_JOB_GRAIN, entities_cull_range, &cull);
+}
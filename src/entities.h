@@ -0,0 +1,88 @@
+#ifndef _ENTITIES_H
+#define _ENTITIES_H
+
+#include "arena.h"
+#include "jobs.h"
+#include "xr_linear.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Data-oriented entity store. Components live in dense, parallel arrays
+// indexed 0..count-1 so systems walk them linearly; destroying an entity
+// moves the last one into its place. Entities are referred to by handles
+// that pack a slot index with a generation, so a handle to a destroyed
+// entity is detected instead of silently aliasing whatever reuses the slot.
+
+#define ENTITY_INDEX_BITS 20
+#define ENTITY_INDEX_MASK ((1u << ENTITY_INDEX_BITS) - 1)
+#define ENTITY_MAX (1u << ENTITY_INDEX_BITS)
+// generations start at 1, so 0 is never a valid handle
+#define ENTITY_NULL 0u
+#define ENTITY_INVALID UINT32_MAX
+#define ENTITY_NO_NODE UINT32_MAX
+#define ENTITIES_MAX_VIEWS 4
+
+struct entity_bounds {
+    XrVector3f center;
+    XrVector3f extents;
+};
+
+struct entities {
+    struct arena arena;
+    uint32_t capacity;
+    uint32_t count;
+
+    // per slot
+    uint32_t* generations;
+    // dense index of a live slot, next free slot of a dead one
+    uint32_t* slot_dense;
+    uint32_t free_slot;
+    uint32_t slot_count;
+
+    // dense components
+    uint32_t* handles;
+    XrVector3f* positions;
+    XrQuaternionf* rotations;
+    XrVector3f* scales;
+    // local space
+    struct entity_bounds* bounds;
+    uint16_t* meshes;
+    uint16_t* materials;
+    // transform hierarchy node that owns world, ENTITY_NO_NODE if it is
+    // composed from position, rotation and scale
+    uint32_t* nodes;
+    XrMatrix4x4f* world;
+    // bit v is set if the world bounds touch frustum v given to entities_cull
+    uint8_t* visible;
+    // last frame's world matrix, for motion vectors
+    XrMatrix4x4f* prev_world;
+};
+
+void entities_create(struct entities* entities, uint32_t capacity);
+void entities_destroy(struct entities* entities);
+
+// Returns ENTITY_NULL when the store is full. New entities sit at the
+// origin with identity rotation and unit scale.
+uint32_t entity_create(struct entities* entities);
+void entity_destroy(struct entities* entities, uint32_t handle);
+
+// Dense index of a live entity, or ENTITY_INVALID for a stale handle.
+uint32_t entity_index(const struct entities* entities, uint32_t handle);
+
+static inline bool entity_alive(const struct entities* entities, uint32_t handle) {
+    return entity_index(entities, handle) != ENTITY_INVALID;
+}
+
+// Recompute the world matrix of every entity without a node from position,
+// rotation and scale, keeping the previous ones in prev_world. The caller
+// copies world matrices of node-driven entities from the hierarchy. Split
+// across the job system when jobs is not NULL.
+void entities_update_world(struct entities* entities, struct jobs* jobs);
+
+// Flag, per view, the entities whose world space bounds intersect the
+// view_proj frustum, conservatively: boxes near a frustum corner may pass.
+// At most ENTITIES_MAX_VIEWS views.
+void entities_cull(struct entities* entities, struct jobs* jobs, const XrMatrix4x4f* view_projs,
+                   uint32_t view_count);
+
+#endif /* _ENTITIES_H */
@@ -0,0 +1,27 @@
+#ifndef _FONT_H
+#define _FONT_H
+
+#include <stdint.h>
+
+// Tiny 5x7 bitmap font for rasterizing UI text on the CPU into RGBA8
+// pixels. Covers printable ASCII up to '_', lowercase is drawn as
+// uppercase and anything else as '?'.
+
+#define FONT_GLYPH_WIDTH 5
+#define FONT_GLYPH_HEIGHT 7
+// horizontal and vertical advance in unscaled pixels
+#define FONT_ADVANCE_X 6
+#define FONT_ADVANCE_Y 9
+
+#define FONT_RGBA(r, g, b, a) \
+    ((uint32_t)(r) | ((uint32_t)(g) << 8) | ((uint32_t)(b) << 16) | ((uint32_t)(a) << 24))
+
+// Draw text with its top left corner at (x, y), every font pixel becoming
+// a scale x scale block. '\n' starts a new line; glyphs are clipped to the
+// image.
+void font_draw_text(uint32_t* pixels, int width, int height, int x, int y, int scale, uint32_t color,
+                    const char* text);
+
+void font_fill_rect(uint32_t* pixels, int width, int height, int x, int y, int w, int h, uint32_t color);
+
+#endif /* _FONT_H */
@@ -0,0 +1,75 @@
+#include "foveation.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LOGI(...) log_write(LOG_CATEGORY_XR, LOG_PRIORITY_INFO, __VA_ARGS__)
+#define LOGE(...) log_write(LOG_CATEGORY_XR, LOG_PRIORITY_ERROR, __VA_ARGS__)
+
+static const char* LEVEL_NAMES[] = {
+        [XR_FOVEATION_LEVEL_NONE_FB] = "none",
+        [XR_FOVEATION_LEVEL_LOW_FB] = "low",
+        [XR_FOVEATION_LEVEL_MEDIUM_FB] = "medium",
+        [XR_FOVEATION_LEVEL_HIGH_FB] = "high",
+};
+
+#define LEVEL_COUNT (sizeof(LEVEL_NAMES) / sizeof(LEVEL_NAMES[0]))
+
+void foveation_init(struct foveation* foveation, XrFoveationLevelFB level, XrFoveationDynamicFB dynamic,
+                    PFN_xrCreateFoveationProfileFB create_profile,
+                    PFN_xrDestroyFoveationProfileFB destroy_profile, PFN_xrUpdateSwapchainFB update_swapchain) {
+    foveation->level = level;
+    foveation->dynamic = dynamic;
+    foveation->create_profile = create_profile;
+    foveation->destroy_profile = destroy_profile;
+    foveation->update_swapchain = update_swapchain;
+    foveation->runtime = create_profile != NULL && destroy_profile != NULL && update_swapchain != NULL;
+    LOGI("foveation: level %s, dynamic %d, %s", LEVEL_NAMES[level], dynamic,
+         foveation->runtime ? "XR_FB_foveation" : "reduced resolution periphery fallback");
+}
+
+bool foveation_parse(const char* value, XrFoveationLevelFB* level, XrFoveationDynamicFB* dynamic) {
+    const char* comma = strchr(value, ',');
+    size_t length = comma != NULL ? (size_t)(comma - value) : strlen(value);
+    if (comma != NULL && strcmp(comma + 1, "dynamic") != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < LEVEL_COUNT; i++) {
+        if (strlen(LEVEL_NAMES[i]) == length && strncmp(value, LEVEL_NAMES[i], length) == 0) {
+            *level = (XrFoveationLevelFB)i;
+            *dynamic = comma != NULL ? XR_FOVEATION_DYNAMIC_LEVEL_ENABLED_FB : XR_FOVEATION_DYNAMIC_DISABLED_FB;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool foveation_apply(const struct foveation* foveation, XrSession session, XrSwapchain swapchain) {
+    if (!foveation->runtime) {
+        return false;
+    }
+    XrFoveationLevelProfileCreateInfoFB level_info = { XR_TYPE_FOVEATION_LEVEL_PROFILE_CREATE_INFO_FB };
+    level_info.level = foveation->level;
+    level_info.verticalOffset = 0.0f;
+    level_info.dynamic = foveation->dynamic;
+
+    XrFoveationProfileCreateInfoFB profile_info = { XR_TYPE_FOVEATION_PROFILE_CREATE_INFO_FB };
+    profile_info.next = &level_info;
+    XrFoveationProfileFB profile = XR_NULL_HANDLE;
+    XrResult result = foveation->create_profile(session, &profile_info, &profile);
+    if (!XR_SUCCEEDED(result)) {
+        LOGE("xrCreateFoveationProfileFB failed: %d", result);
+        return false;
+    }
+
+    XrSwapchainStateFoveationFB state = { XR_TYPE_SWAPCHAIN_STATE_FOVEATION_FB };
+    state.profile = profile;
+    result = foveation->update_swapchain(swapchain, (const XrSwapchainStateBaseHeaderFB*)&state);
+    if (!XR_SUCCEEDED(result)) {
+        LOGE("xrUpdateSwapchainFB failed: %d", result);
+    }
+
+    // the swapchain keeps its own copy of the profile
+    foveation->destroy_profile(profile);
+    return XR_SUCCEEDED(result);
+}
@@ -0,0 +1,36 @@
+#ifndef _FOVEATION_H
+#define _FOVEATION_H
+
+#include <openxr/openxr.h>
+#include <stdbool.h>
+
+// Fixed foveated rendering through XR_FB_foveation: the runtime lowers the
+// shading rate towards the edges of each swapchain, by a level and
+// optionally adjusted dynamically to GPU load. Without the extension the
+// app falls back to drawing the periphery at reduced resolution itself.
+
+struct foveation {
+    XrFoveationLevelFB level;
+    XrFoveationDynamicFB dynamic;
+    // XR_FB_foveation is there; the functions are NULL otherwise
+    bool runtime;
+    PFN_xrCreateFoveationProfileFB create_profile;
+    PFN_xrDestroyFoveationProfileFB destroy_profile;
+    PFN_xrUpdateSwapchainFB update_swapchain;
+};
+
+// Any of the functions may be NULL, then foveation_apply does nothing.
+void foveation_init(struct foveation* foveation, XrFoveationLevelFB level, XrFoveationDynamicFB dynamic,
+                    PFN_xrCreateFoveationProfileFB create_profile,
+                    PFN_xrDestroyFoveationProfileFB destroy_profile, PFN_xrUpdateSwapchainFB update_swapchain);
+
+// Parses "none", "low", "medium" or "high", optionally followed by
+// ",dynamic". Returns false and leaves both untouched for anything else.
+bool foveation_parse(const char* value, XrFoveationLevelFB* level, XrFoveationDynamicFB* dynamic);
+
+// Sets the current level on a swapchain created with
+// XR_SWAPCHAIN_CREATE_FOVEATION_SCALED_BIN_BIT_FB. Returns false if the
+// runtime refused it.
+bool foveation_apply(const struct foveation* foveation, XrSession session, XrSwapchain swapchain);
+
+#endif /* _FOVEATION_H */
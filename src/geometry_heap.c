@@ -0,0 +1,276 @@
+#include "geometry_heap.h"
+#include "gl_capture.h"
+#include "log.h"
+#include "resources.h"
+#include <EGL/egl.h>
+#include <GLES2/gl2ext.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOGI(...) log_write(LOG_CATEGORY_GL, LOG_PRIORITY_INFO, __VA_ARGS__)
+#define LOGE(...) log_write(LOG_CATEGORY_GL, LOG_PRIORITY_ERROR, __VA_ARGS__)
+
+// core in GLES 3.2, an extension before that; same signature either way.
+// Without it indices are rebased by the first vertex of their mesh on upload.
+static PFNGLDRAWELEMENTSBASEVERTEXOESPROC draw_elements_base_vertex = NULL;
+static bool draw_elements_base_vertex_checked = false;
+
+static void geometry_allocator_init(struct geometry_allocator* allocator, uint32_t capacity) {
+    allocator->capacity = capacity;
+    allocator->used = 0;
+    allocator->free[0] = (struct geometry_block) { 0, capacity };
+    allocator->free_count = 1;
+}
+
+static uint32_t geometry_allocator_alloc(struct geometry_allocator* allocator, uint32_t size) {
+    for (uint32_t i = 0; i < allocator->free_count; i++) {
+        struct geometry_block* block = &allocator->free[i];
+        if (block->size < size) {
+            continue;
+        }
+        uint32_t offset = block->offset;
+        block->offset += size;
+        block->size -= size;
+        if (block->size == 0) {
+            memmove(block, block + 1, (allocator->free_count - i - 1) * sizeof(*block));
+            allocator->free_count--;
+        }
+        allocator->used += size;
+        return offset;
+    }
+    return GEOMETRY_HEAP_INVALID;
+}
+
+static void geometry_allocator_free(struct geometry_allocator* allocator, uint32_t offset, uint32_t size) {
+    // first free block after the freed one
+    uint32_t next = 0;
+    while (next < allocator->free_count && allocator->free[next].offset < offset) {
+        next++;
+    }
+    bool merge_prev = next > 0 && allocator->free[next - 1].offset + allocator->free[next - 1].size == offset;
+    bool merge_next = next < allocator->free_count && offset + size == allocator->free[next].offset;
+    if (merge_prev && merge_next) {
+        allocator->free[next - 1].size += size + allocator->free[next].size;
+        memmove(&allocator->free[next], &allocator->free[next + 1],
+                (allocator->free_count - next - 1) * sizeof(struct geometry_block));
+        allocator->free_count--;
+    } else if (merge_prev) {
+        allocator->free[next - 1].size += size;
+    } else if (merge_next) {
+        allocator->free[next].offset = offset;
+        allocator->free[next].size += size;
+    } else {
+        // a free block per live allocation at most, plus the tail, so this fits
+        memmove(&allocator->free[next + 1], &allocator->free[next],
+                (allocator->free_count - next) * sizeof(struct geometry_block));
+        allocator->free[next] = (struct geometry_block) { offset, size };
+        allocator->free_count++;
+    }
+    allocator->used -= size;
+}
+
+// Points the bound vertex array at both buffers. A context only sees what
+// another one wrote into a buffer once it attaches the buffer again, so
+// this is repeated whenever the loader has filled in a mesh.
+static void geometry_heap_attach(const struct geometry_heap* heap) {
+    glBindBuffer(GL_ARRAY_BUFFER, heap->vertex_buffer);
+    for (uint32_t i = 0; i < heap->attrib_count; i++) {
+        const struct attrib_pointer* attrib = &heap->attribs[i];
+        glVertexAttribPointer(i, attrib->size, attrib->type, attrib->normalized, attrib->stride, attrib->pointer);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, heap->index_buffer);
+}
+
+void geometry_heap_create(struct geometry_heap* heap, uint32_t vertex_size, uint32_t vertex_capacity,
+                          uint32_t index_capacity, const struct attrib_pointer* attribs, uint32_t attrib_count,
+                          const char* owner) {
+    memset(heap, 0, sizeof(*heap));
+    if (!draw_elements_base_vertex_checked) {
+        static const char* NAMES[] = {
+                "glDrawElementsBaseVertex", "glDrawElementsBaseVertexOES", "glDrawElementsBaseVertexEXT",
+        };
+        for (size_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]) && draw_elements_base_vertex == NULL; i++) {
+            draw_elements_base_vertex = (PFNGLDRAWELEMENTSBASEVERTEXOESPROC)eglGetProcAddress(NAMES[i]);
+        }
+        draw_elements_base_vertex_checked = true;
+        if (draw_elements_base_vertex == NULL) {
+            LOGI("no glDrawElementsBaseVertex, geometry heaps rebase indices on upload");
+        }
+    }
+    if (draw_elements_base_vertex == NULL) {
+        // rebased indices have to stay 16 bit
+        if (vertex_capacity > GEOMETRY_HEAP_REBASED_VERTICES) {
+            LOGI("geometry heap %s: %u vertices at most without glDrawElementsBaseVertex", owner,
+                 GEOMETRY_HEAP_REBASED_VERTICES);
+            vertex_capacity = GEOMETRY_HEAP_REBASED_VERTICES;
+        }
+        heap->rebased_indices = malloc((size_t)index_capacity * sizeof(uint16_t));
+        if (heap->rebased_indices == NULL) {
+            LOGE("can't allocate rebased indices for geometry heap %s", owner);
+            exit(EXIT_FAILURE);
+        }
+    }
+    heap->owner = owner;
+    heap->vertex_size = vertex_size;
+    if (attrib_count > GEOMETRY_HEAP_MAX_ATTRIBS) {
+        LOGE("geometry heap %s: %u attributes, at most %d", owner, attrib_count, GEOMETRY_HEAP_MAX_ATTRIBS);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(heap->attribs, attribs, attrib_count * sizeof(*attribs));
+    heap->attrib_count = attrib_count;
+    geometry_allocator_init(&heap->vertex_space, vertex_capacity);
+    geometry_allocator_init(&heap->index_space, index_capacity);
+
+    glGenBuffers(1, &heap->vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, heap->vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertex_capacity * vertex_size, NULL, GL_STATIC_DRAW);
+    resources_track(RESOURCE_GL_BUFFER, heap->vertex_buffer, (uint64_t)vertex_capacity * vertex_size, owner);
+    glGenBuffers(1, &heap->index_buffer);
+
+    glGenVertexArrays(1, &heap->vertex_array);
+    resources_track(RESOURCE_GL_VERTEX_ARRAY, heap->vertex_array, 0, owner);
+    glBindVertexArray(heap->vertex_array);
+    for (uint32_t i = 0; i < attrib_count; i++) {
+        glEnableVertexAttribArray(i);
+    }
+    geometry_heap_attach(heap);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)index_capacity * sizeof(uint16_t), NULL, GL_STATIC_DRAW);
+    resources_track(RESOURCE_GL_BUFFER, heap->index_buffer, (uint64_t)index_capacity * sizeof(uint16_t), owner);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // the loader context writes into these, it has to see them exist
+    glFlush();
+    LOGI("geometry heap %s: %u vertices, %u indices", owner, vertex_capacity, index_capacity);
+}
+
+// Queues whichever of the two uploads a full loader queue turned away.
+static void geometry_heap_upload(struct geometry_heap* heap, struct loader* loader, struct geometry_mesh* mesh) {
+    if (loader_state(&mesh->vertices) == LOAD_IDLE) {
+        loader_upload_buffer_range(loader, &mesh->vertices, GL_ARRAY_BUFFER, heap->vertex_buffer,
+                                   (size_t)mesh->first_vertex * heap->vertex_size, mesh->vertex_data,
+                                   (size_t)mesh->vertex_count * heap->vertex_size, heap->owner);
+    }
+    if (loader_state(&mesh->indices) == LOAD_IDLE) {
+        loader_upload_buffer_range(loader, &mesh->indices, GL_ELEMENT_ARRAY_BUFFER, heap->index_buffer,
+                                   (size_t)mesh->first_index * sizeof(uint16_t), mesh->index_data,
+                                   (size_t)mesh->index_count * sizeof(uint16_t), heap->owner);
+    }
+}
+
+uint32_t geometry_heap_add(struct geometry_heap* heap, struct loader* loader, const void* vertices,
+                           uint32_t vertex_count, const uint16_t* indices, uint32_t index_count) {
+    uint32_t id = 0;
+    while (id < GEOMETRY_HEAP_MAX_MESHES && heap->meshes[id].used) {
+        id++;
+    }
+    if (id == GEOMETRY_HEAP_MAX_MESHES) {
+        LOGE("geometry heap %s out of meshes", heap->owner);
+        return GEOMETRY_HEAP_INVALID;
+    }
+    uint32_t first_vertex = geometry_allocator_alloc(&heap->vertex_space, vertex_count);
+    if (first_vertex == GEOMETRY_HEAP_INVALID) {
+        LOGE("geometry heap %s can't fit %u vertices (%u of %u used)", heap->owner, vertex_count,
+             heap->vertex_space.used, heap->vertex_space.capacity);
+        return GEOMETRY_HEAP_INVALID;
+    }
+    uint32_t first_index = geometry_allocator_alloc(&heap->index_space, index_count);
+    if (first_index == GEOMETRY_HEAP_INVALID) {
+        LOGE("geometry heap %s can't fit %u indices (%u of %u used)", heap->owner, index_count,
+             heap->index_space.used, heap->index_space.capacity);
+        geometry_allocator_free(&heap->vertex_space, first_vertex, vertex_count);
+        return GEOMETRY_HEAP_INVALID;
+    }
+
+    struct geometry_mesh* mesh = &heap->meshes[id];
+    mesh->used = true;
+    mesh->ready = false;
+    mesh->first_vertex = first_vertex;
+    mesh->vertex_count = vertex_count;
+    mesh->first_index = first_index;
+    mesh->index_count = index_count;
+    mesh->vertex_data = vertices;
+    mesh->index_data = indices;
+    if (heap->rebased_indices != NULL) {
+        uint16_t* rebased = &heap->rebased_indices[first_index];
+        for (uint32_t i = 0; i < index_count; i++) {
+            rebased[i] = (uint16_t)(indices[i] + first_vertex);
+        }
+        mesh->index_data = rebased;
+    }
+    atomic_store_explicit(&mesh->vertices.state, LOAD_IDLE, memory_order_relaxed);
+    atomic_store_explicit(&mesh->indices.state, LOAD_IDLE, memory_order_relaxed);
+    geometry_heap_upload(heap, loader, mesh);
+    heap->pending++;
+    return id;
+}
+
+void geometry_heap_remove(struct geometry_heap* heap, uint32_t id) {
+    if (!geometry_heap_ready(heap, id)) {
+        LOGE("removing mesh %u from geometry heap %s before it is ready", id, heap->owner);
+        return;
+    }
+    struct geometry_mesh* mesh = &heap->meshes[id];
+    geometry_allocator_free(&heap->vertex_space, mesh->first_vertex, mesh->vertex_count);
+    geometry_allocator_free(&heap->index_space, mesh->first_index, mesh->index_count);
+    mesh->used = false;
+    mesh->ready = false;
+}
+
+void geometry_heap_update(struct geometry_heap* heap, struct loader* loader) {
+    bool landed = false;
+    for (uint32_t i = 0; i < GEOMETRY_HEAP_MAX_MESHES && heap->pending > 0; i++) {
+        struct geometry_mesh* mesh = &heap->meshes[i];
+        if (!mesh->used || mesh->ready) {
+            continue;
+        }
+        // poll both, so neither fence lingers behind the other
+        bool vertices_ready = loader_ready(loader, &mesh->vertices);
+        bool indices_ready = loader_ready(loader, &mesh->indices);
+        enum load_state vertices_state = loader_state(&mesh->vertices);
+        enum load_state indices_state = loader_state(&mesh->indices);
+        if (vertices_state == LOAD_FAILED || indices_state == LOAD_FAILED) {
+            // give the space back once the loader is done with both halves
+            if (vertices_state != LOAD_QUEUED && vertices_state != LOAD_FENCED && indices_state != LOAD_QUEUED &&
+                indices_state != LOAD_FENCED) {
+                LOGE("dropping mesh %u from geometry heap %s, its upload failed", i, heap->owner);
+                geometry_allocator_free(&heap->vertex_space, mesh->first_vertex, mesh->vertex_count);
+                geometry_allocator_free(&heap->index_space, mesh->first_index, mesh->index_count);
+                mesh->used = false;
+                heap->pending--;
+            }
+            continue;
+        }
+        geometry_heap_upload(heap, loader, mesh);
+        if (vertices_ready && indices_ready) {
+            mesh->ready = true;
+            heap->pending--;
+            landed = true;
+        }
+    }
+    if (landed) {
+        glBindVertexArray(heap->vertex_array);
+        geometry_heap_attach(heap);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+void geometry_heap_bind(const struct geometry_heap* heap) {
+    glBindVertexArray(heap->vertex_array);
+}
+
+void geometry_heap_draw(const struct geometry_heap* heap, uint32_t id) {
+    const struct geometry_mesh* mesh = &heap->meshes[id];
+    if (draw_elements_base_vertex == NULL) {
+        // indices are rebased already; glDrawElements records itself when capturing
+        glDrawElements(GL_TRIANGLES, (GLsizei)mesh->index_count, GL_UNSIGNED_SHORT,
+                       (const GLvoid*)((uintptr_t)mesh->first_index * sizeof(uint16_t)));
+        return;
+    }
+    GL_CAPTURE_DRAW_ELEMENTS_BASE_VERTEX(GL_TRIANGLES, (GLsizei)mesh->index_count, GL_UNSIGNED_SHORT,
+                                         (const GLvoid*)((uintptr_t)mesh->first_index * sizeof(uint16_t)),
+                                         (GLint)mesh->first_vertex);
+    draw_elements_base_vertex(GL_TRIANGLES, (GLsizei)mesh->index_count, GL_UNSIGNED_SHORT,
+                              (const GLvoid*)((uintptr_t)mesh->first_index * sizeof(uint16_t)),
+                              (GLint)mesh->first_vertex);
+}
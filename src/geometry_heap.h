@@ -0,0 +1,103 @@
+#ifndef _GEOMETRY_HEAP_H
+#define _GEOMETRY_HEAP_H
+
+#include "loader.h"
+#include <GLES3/gl3.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Static meshes of one vertex layout packed into a single vertex buffer and
+// a single index buffer, drawn through one shared vertex array with
+// glDrawElementsBaseVertex, so switching meshes costs no binds. Where that
+// is missing the indices are rebased on upload and drawn with
+// glDrawElements, and a heap holds GEOMETRY_HEAP_REBASED_VERTICES at most. Space in
+// both buffers is handed out by a first-fit free list that coalesces
+// neighbouring blocks when a mesh is removed. Mesh data is written by the
+// loader thread; a mesh is drawable once geometry_heap_update has seen
+// both of its uploads land, and is dropped if either of them fails.
+
+#define GEOMETRY_HEAP_MAX_MESHES 256
+#define GEOMETRY_HEAP_INVALID UINT32_MAX
+#define GEOMETRY_HEAP_MAX_ATTRIBS 8
+#define GEOMETRY_HEAP_REBASED_VERTICES 65536
+
+struct attrib_pointer {
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    GLsizei stride;
+    const GLvoid* pointer;
+};
+
+struct geometry_block {
+    uint32_t offset;
+    uint32_t size;
+};
+
+// Units are vertices or indices, not bytes.
+struct geometry_allocator {
+    uint32_t capacity;
+    uint32_t used;
+    // sorted by offset, never adjacent
+    struct geometry_block free[GEOMETRY_HEAP_MAX_MESHES + 1];
+    uint32_t free_count;
+};
+
+struct geometry_mesh {
+    bool used;
+    bool ready;
+    uint32_t first_vertex;
+    uint32_t vertex_count;
+    uint32_t first_index;
+    uint32_t index_count;
+    // kept to queue the uploads again when the loader queue was full
+    const void* vertex_data;
+    const uint16_t* index_data;
+    struct load_request vertices;
+    struct load_request indices;
+};
+
+struct geometry_heap {
+    const char* owner;
+    uint32_t vertex_size;
+    GLuint vertex_array;
+    GLuint vertex_buffer;
+    GLuint index_buffer;
+    struct attrib_pointer attribs[GEOMETRY_HEAP_MAX_ATTRIBS];
+    uint32_t attrib_count;
+    // index_capacity indices, without glDrawElementsBaseVertex only
+    uint16_t* rebased_indices;
+    struct geometry_allocator vertex_space;
+    struct geometry_allocator index_space;
+    struct geometry_mesh meshes[GEOMETRY_HEAP_MAX_MESHES];
+    uint32_t pending;
+};
+
+// Attribute i of the layout goes to location i. Render thread only, as
+// are all the functions below.
+void geometry_heap_create(struct geometry_heap* heap, uint32_t vertex_size, uint32_t vertex_capacity,
+                          uint32_t index_capacity, const struct attrib_pointer* attribs, uint32_t attrib_count,
+                          const char* owner);
+
+// Returns the mesh id, or GEOMETRY_HEAP_INVALID when the heap is out of
+// meshes or space. The data has to stay valid until the mesh is ready or
+// has been dropped.
+uint32_t geometry_heap_add(struct geometry_heap* heap, struct loader* loader, const void* vertices,
+                           uint32_t vertex_count, const uint16_t* indices, uint32_t index_count);
+
+// Only meshes that are ready can be removed.
+void geometry_heap_remove(struct geometry_heap* heap, uint32_t mesh);
+
+// Poll the uploads of meshes that aren't ready yet, and queue again the ones
+// the loader had no room for.
+void geometry_heap_update(struct geometry_heap* heap, struct loader* loader);
+
+static inline bool geometry_heap_ready(const struct geometry_heap* heap, uint32_t mesh) {
+    return mesh < GEOMETRY_HEAP_MAX_MESHES && heap->meshes[mesh].ready;
+}
+
+// Binds the shared vertex array; meshes are then drawn without further binds.
+void geometry_heap_bind(const struct geometry_heap* heap);
+void geometry_heap_draw(const struct geometry_heap* heap, uint32_t mesh);
+
+#endif /* _GEOMETRY_HEAP_H */
@@ -0,0 +1,564 @@
+#define GL_CAPTURE_IMPLEMENTATION
+#include "gl_capture.h"
+
+#if ENABLE_GL_CAPTURE
+
+#include "log.h"
+#include <EGL/egl.h>
+#include <GLES3/gl31.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOGI(...) log_write(LOG_CATEGORY_GL, LOG_PRIORITY_INFO, __VA_ARGS__)
+#define LOGE(...) log_write(LOG_CATEGORY_GL, LOG_PRIORITY_ERROR, __VA_ARGS__)
+
+// objects of one kind a capture can refer to
+#define GL_CAPTURE_MAX_OBJECTS 256
+#define GL_CAPTURE_MAX_ATTRIBS 16
+#define GL_CAPTURE_MAX_NAME 256
+
+enum gl_capture_object {
+    GL_CAPTURE_OBJECT_PROGRAM,
+    GL_CAPTURE_OBJECT_BUFFER,
+    GL_CAPTURE_OBJECT_VERTEX_ARRAY,
+    GL_CAPTURE_OBJECT_TEXTURE,
+    GL_CAPTURE_OBJECT_FRAMEBUFFER,
+    GL_CAPTURE_OBJECT_END,
+};
+
+struct gl_capture {
+    char path[256];
+    uint32_t frame_count;
+    bool pending;
+    FILE* file;
+    uint32_t frames_left;
+    // payload of the record being written
+    uint32_t op;
+    uint32_t* words;
+    size_t word_count;
+    size_t word_capacity;
+    // objects already written to this capture
+    GLuint written[GL_CAPTURE_OBJECT_END][GL_CAPTURE_MAX_OBJECTS];
+    uint32_t written_count[GL_CAPTURE_OBJECT_END];
+    uint64_t records;
+    uint64_t bytes;
+};
+
+static struct gl_capture capture;
+
+// GLES 3.1, only needed to size captured textures
+static void (GL_APIENTRYP get_tex_level_parameteriv)(GLenum target, GLint level, GLenum pname,
+                                                     GLint* params) = NULL;
+
+static void gl_capture_begin(enum gl_capture_op op) {
+    capture.op = op;
+    capture.word_count = 0;
+}
+
+static void gl_capture_reserve(size_t count) {
+    if (capture.word_count + count <= capture.word_capacity) {
+        return;
+    }
+    size_t capacity = capture.word_capacity > 0 ? capture.word_capacity : 256;
+    while (capacity < capture.word_count + count) {
+        capacity *= 2;
+    }
+    uint32_t* words = realloc(capture.words, capacity * sizeof(uint32_t));
+    if (words == NULL) {
+        LOGE("out of memory for gl capture");
+        exit(EXIT_FAILURE);
+    }
+    capture.words = words;
+    capture.word_capacity = capacity;
+}
+
+static void gl_capture_word(uint32_t word) {
+    gl_capture_reserve(1);
+    capture.words[capture.word_count++] = word;
+}
+
+static void gl_capture_float(GLfloat value) {
+    uint32_t word;
+    memcpy(&word, &value, sizeof(word));
+    gl_capture_word(word);
+}
+
+static void gl_capture_bytes(const void* data, uint32_t size) {
+    size_t count = (size + 3) / 4;
+    gl_capture_word(size);
+    if (count == 0) {
+        return;
+    }
+    gl_capture_reserve(count);
+    capture.words[capture.word_count + count - 1] = 0;
+    memcpy(&capture.words[capture.word_count], data, size);
+    capture.word_count += count;
+}
+
+static void gl_capture_string(const char* string) {
+    gl_capture_bytes(string, (uint32_t)strlen(string));
+}
+
+static void gl_capture_end() {
+    if (capture.file == NULL) {
+        // stopped while the record was built
+        return;
+    }
+    struct gl_capture_header header = { capture.op, (uint32_t)(capture.word_count * sizeof(uint32_t)) };
+    if (fwrite(&header, sizeof(header), 1, capture.file) != 1 ||
+        fwrite(capture.words, sizeof(uint32_t), capture.word_count, capture.file) != capture.word_count) {
+        LOGE("can't write gl capture, capture stopped");
+        fclose(capture.file);
+        capture.file = NULL;
+        return;
+    }
+    capture.records++;
+    capture.bytes += sizeof(header) + header.size;
+}
+
+// Returns false the first time an object is seen by this capture.
+static bool gl_capture_written(enum gl_capture_object kind, GLuint name) {
+    if (name == 0) {
+        return true;
+    }
+    for (uint32_t i = 0; i < capture.written_count[kind]; i++) {
+        if (capture.written[kind][i] == name) {
+            return true;
+        }
+    }
+    if (capture.written_count[kind] == GL_CAPTURE_MAX_OBJECTS) {
+        LOGE("too many objects for gl capture, capture stopped");
+        gl_capture_stop();
+        return true;
+    }
+    capture.written[kind][capture.written_count[kind]++] = name;
+    return false;
+}
+
+static void gl_capture_write_buffer(GLuint buffer) {
+    if (gl_capture_written(GL_CAPTURE_OBJECT_BUFFER, buffer)) {
+        return;
+    }
+    GLint previous;
+    glGetIntegerv(GL_COPY_READ_BUFFER_BINDING, &previous);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    GLint size = 0;
+    glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+    const void* data = size > 0 ? glMapBufferRange(GL_COPY_READ_BUFFER, 0, size, GL_MAP_READ_BIT) : NULL;
+    gl_capture_begin(GL_CAPTURE_BUFFER);
+    gl_capture_word(buffer);
+    if (data != NULL) {
+        gl_capture_bytes(data, (uint32_t)size);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+    } else {
+        LOGE("can't read back buffer %u for gl capture", buffer);
+        gl_capture_word(0);
+    }
+    gl_capture_end();
+    glBindBuffer(GL_COPY_READ_BUFFER, (GLuint)previous);
+}
+
+static void gl_capture_write_texture(GLuint texture) {
+    if (gl_capture_written(GL_CAPTURE_OBJECT_TEXTURE, texture)) {
+        return;
+    }
+    GLint width = 0;
+    GLint height = 0;
+    GLint format = 0;
+    if (get_tex_level_parameteriv != NULL) {
+        GLint previous;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        get_tex_level_parameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+        get_tex_level_parameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+        get_tex_level_parameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+        glBindTexture(GL_TEXTURE_2D, (GLuint)previous);
+    }
+    gl_capture_begin(GL_CAPTURE_TEXTURE);
+    gl_capture_word(texture);
+    gl_capture_word((uint32_t)width);
+    gl_capture_word((uint32_t)height);
+    gl_capture_word((uint32_t)format);
+    gl_capture_end();
+}
+
+// The framebuffer has to be bound to target.
+static void gl_capture_write_framebuffer(GLenum target, GLuint framebuffer) {
+    if (gl_capture_written(GL_CAPTURE_OBJECT_FRAMEBUFFER, framebuffer)) {
+        return;
+    }
+    static const GLenum ATTACHMENTS[] = { GL_COLOR_ATTACHMENT0, GL_DEPTH_ATTACHMENT, GL_STENCIL_ATTACHMENT };
+    GLuint textures[3] = { 0 };
+    for (int i = 0; i < 3; i++) {
+        GLint type = GL_NONE;
+        glGetFramebufferAttachmentParameteriv(target, ATTACHMENTS[i], GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+        if (type == GL_TEXTURE) {
+            GLint name;
+            glGetFramebufferAttachmentParameteriv(target, ATTACHMENTS[i], GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME,
+                                                  &name);
+            textures[i] = (GLuint)name;
+            gl_capture_write_texture(textures[i]);
+        } else if (type != GL_NONE) {
+            LOGE("gl capture only replays texture attachments, framebuffer %u has another", framebuffer);
+        }
+    }
+    gl_capture_begin(GL_CAPTURE_FRAMEBUFFER);
+    gl_capture_word(framebuffer);
+    for (int i = 0; i < 3; i++) {
+        gl_capture_word(textures[i]);
+    }
+    gl_capture_end();
+}
+
+// Writes (location, name) for every active attribute or uniform.
+static void gl_capture_write_locations(GLuint program, GLenum count_name, bool uniforms) {
+    GLint count = 0;
+    glGetProgramiv(program, count_name, &count);
+    gl_capture_word((uint32_t)count);
+    for (GLint i = 0; i < count; i++) {
+        char name[GL_CAPTURE_MAX_NAME];
+        GLint size;
+        GLenum type;
+        GLint location;
+        if (uniforms) {
+            glGetActiveUniform(program, (GLuint)i, sizeof(name), NULL, &size, &type, name);
+            location = glGetUniformLocation(program, name);
+        } else {
+            glGetActiveAttrib(program, (GLuint)i, sizeof(name), NULL, &size, &type, name);
+            location = glGetAttribLocation(program, name);
+        }
+        gl_capture_word((uint32_t)location);
+        gl_capture_string(name);
+    }
+}
+
+static void gl_capture_write_program(GLuint program) {
+    if (gl_capture_written(GL_CAPTURE_OBJECT_PROGRAM, program)) {
+        return;
+    }
+    GLuint shaders[2];
+    GLsizei shader_count = 0;
+    glGetAttachedShaders(program, 2, &shader_count, shaders);
+    char* sources[2] = { NULL, NULL };
+    for (GLsizei i = 0; i < shader_count; i++) {
+        GLint type;
+        GLint length = 0;
+        glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type);
+        glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length);
+        int slot = type == GL_VERTEX_SHADER ? 0 : 1;
+        free(sources[slot]);
+        sources[slot] = calloc(1, (size_t)length + 1);
+        glGetShaderSource(shaders[i], length + 1, NULL, sources[slot]);
+    }
+    gl_capture_begin(GL_CAPTURE_PROGRAM);
+    gl_capture_word(program);
+    for (int i = 0; i < 2; i++) {
+        gl_capture_string(sources[i] != NULL ? sources[i] : "");
+        free(sources[i]);
+    }
+    gl_capture_write_locations(program, GL_ACTIVE_ATTRIBUTES, false);
+    gl_capture_write_locations(program, GL_ACTIVE_UNIFORMS, true);
+    gl_capture_end();
+}
+
+// The vertex array has to be bound.
+static void gl_capture_write_vertex_array(GLuint array) {
+    if (gl_capture_written(GL_CAPTURE_OBJECT_VERTEX_ARRAY, array)) {
+        return;
+    }
+    GLint max_attribs;
+    glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &max_attribs);
+    if (max_attribs > GL_CAPTURE_MAX_ATTRIBS) {
+        max_attribs = GL_CAPTURE_MAX_ATTRIBS;
+    }
+    GLint element_buffer;
+    glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &element_buffer);
+    gl_capture_write_buffer((GLuint)element_buffer);
+
+    // buffers go first, the record is built after
+    GLint attribs[GL_CAPTURE_MAX_ATTRIBS][6];
+    void* pointers[GL_CAPTURE_MAX_ATTRIBS];
+    uint32_t attrib_count = 0;
+    for (GLint i = 0; i < max_attribs; i++) {
+        GLint enabled = GL_FALSE;
+        glGetVertexAttribiv((GLuint)i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+        if (!enabled) {
+            continue;
+        }
+        GLint* attrib = attribs[attrib_count];
+        attrib[0] = i;
+        glGetVertexAttribiv((GLuint)i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &attrib[1]);
+        glGetVertexAttribiv((GLuint)i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &attrib[2]);
+        glGetVertexAttribiv((GLuint)i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &attrib[3]);
+        glGetVertexAttribiv((GLuint)i, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &attrib[4]);
+        glGetVertexAttribiv((GLuint)i, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &attrib[5]);
+        glGetVertexAttribPointerv((GLuint)i, GL_VERTEX_ATTRIB_ARRAY_POINTER, &pointers[attrib_count]);
+        gl_capture_write_buffer((GLuint)attrib[5]);
+        attrib_count++;
+    }
+
+    gl_capture_begin(GL_CAPTURE_VERTEX_ARRAY);
+    gl_capture_word(array);
+    gl_capture_word((uint32_t)element_buffer);
+    gl_capture_word(attrib_count);
+    for (uint32_t i = 0; i < attrib_count; i++) {
+        for (int j = 0; j < 6; j++) {
+            gl_capture_word((uint32_t)attribs[i][j]);
+        }
+        gl_capture_word((uint32_t)(uintptr_t)pointers[i]);
+    }
+    gl_capture_end();
+}
+
+static void gl_capture_open() {
+    capture.pending = false;
+    capture.file = fopen(capture.path, "wb");
+    if (capture.file == NULL) {
+        LOGE("can't open gl capture %s", capture.path);
+        return;
+    }
+    struct gl_capture_file_header header = { GL_CAPTURE_MAGIC, GL_CAPTURE_VERSION };
+    fwrite(&header, sizeof(header), 1, capture.file);
+    capture.frames_left = capture.frame_count;
+    memset(capture.written_count, 0, sizeof(capture.written_count));
+    capture.records = 0;
+    capture.bytes = sizeof(header);
+    if (get_tex_level_parameteriv == NULL) {
+        get_tex_level_parameteriv = (void (GL_APIENTRYP)(GLenum, GLint, GLenum, GLint*))
+                eglGetProcAddress("glGetTexLevelParameteriv");
+        if (get_tex_level_parameteriv == NULL) {
+            LOGE("no glGetTexLevelParameteriv, captured textures have no size");
+        }
+    }
+    LOGI("gl capture: capturing %u frames to %s", capture.frame_count, capture.path);
+}
+
+void gl_capture_start(const char* path, uint32_t frame_count) {
+    if (frame_count == 0) {
+        return;
+    }
+    gl_capture_stop();
+    snprintf(capture.path, sizeof(capture.path), "%s", path);
+    capture.frame_count = frame_count;
+    capture.pending = true;
+}
+
+void gl_capture_stop() {
+    capture.pending = false;
+    if (capture.file == NULL) {
+        return;
+    }
+    fclose(capture.file);
+    capture.file = NULL;
+    LOGI("gl capture: %u frames, %llu records, %llu bytes written to %s",
+         capture.frame_count - capture.frames_left, (unsigned long long)capture.records,
+         (unsigned long long)capture.bytes, capture.path);
+    free(capture.words);
+    capture.words = NULL;
+    capture.word_capacity = 0;
+}
+
+void gl_capture_frame(uint64_t frame_index) {
+    if (capture.file != NULL && capture.frames_left == 0) {
+        gl_capture_stop();
+    }
+    if (capture.pending) {
+        gl_capture_open();
+    }
+    if (capture.file == NULL) {
+        return;
+    }
+    capture.frames_left--;
+    gl_capture_begin(GL_CAPTURE_FRAME);
+    gl_capture_word((uint32_t)frame_index);
+    gl_capture_word((uint32_t)(frame_index >> 32));
+    gl_capture_end();
+}
+
+void gl_capture_bind_framebuffer(GLenum target, GLuint framebuffer) {
+    glBindFramebuffer(target, framebuffer);
+    if (capture.file != NULL) {
+        gl_capture_write_framebuffer(target, framebuffer);
+        gl_capture_begin(GL_CAPTURE_BIND_FRAMEBUFFER);
+        gl_capture_word(target);
+        gl_capture_word(framebuffer);
+        gl_capture_end();
+    }
+}
+
+void gl_capture_framebuffer_texture_2d(GLenum target, GLenum attachment, GLenum textarget, GLuint texture,
+                                       GLint level) {
+    if (capture.file != NULL) {
+        gl_capture_write_texture(texture);
+        gl_capture_begin(GL_CAPTURE_FRAMEBUFFER_TEXTURE_2D);
+        gl_capture_word(target);
+        gl_capture_word(attachment);
+        gl_capture_word(textarget);
+        gl_capture_word(texture);
+        gl_capture_word((uint32_t)level);
+        gl_capture_end();
+    }
+    glFramebufferTexture2D(target, attachment, textarget, texture, level);
+}
+
+void gl_capture_enable(GLenum cap) {
+    if (capture.file != NULL) {
+        gl_capture_begin(GL_CAPTURE_ENABLE);
+        gl_capture_word(cap);
+        gl_capture_end();
+    }
+    glEnable(cap);
+}
+
+void gl_capture_disable(GLenum cap) {
+    if (capture.file != NULL) {
+        gl_capture_begin(GL_CAPTURE_DISABLE);
+        gl_capture_word(cap);
+        gl_capture_end();
+    }
+    glDisable(cap);
+}
+
+void gl_capture_clear_color(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+    if (capture.file != NULL) {
+        gl_capture_begin(GL_CAPTURE_CLEAR_COLOR);
+        gl_capture_float(red);
+        gl_capture_float(green);
+        gl_capture_float(blue);
+        gl_capture_float(alpha);
+        gl_capture_end();
+    }
+    glClearColor(red, green, blue, alpha);
+}
+
+void gl_capture_clear(GLbitfield mask) {
+    if (capture.file != NULL) {
+        gl_capture_begin(GL_CAPTURE_CLEAR);
+        gl_capture_word(mask);
+        gl_capture_end();
+    }
+    glClear(mask);
+}
+
+static void gl_capture_rect(enum gl_capture_op op, GLint x, GLint y, GLsizei width, GLsizei height) {
+    gl_capture_begin(op);
+    gl_capture_word((uint32_t)x);
+    gl_capture_word((uint32_t)y);
+    gl_capture_word((uint32_t)width);
+    gl_capture_word((uint32_t)height);
+    gl_capture_end();
+}
+
+void gl_capture_viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    if (capture.file != NULL) {
+        gl_capture_rect(GL_CAPTURE_VIEWPORT, x, y, width, height);
+    }
+    glViewport(x, y, width, height);
+}
+
+void gl_capture_scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    if (capture.file != NULL) {
+        gl_capture_rect(GL_CAPTURE_SCISSOR, x, y, width, height);
+    }
+    glScissor(x, y, width, height);
+}
+
+void gl_capture_invalidate_framebuffer(GLenum target, GLsizei count, const GLenum* attachments) {
+    if (capture.file != NULL) {
+        gl_capture_begin(GL_CAPTURE_INVALIDATE_FRAMEBUFFER);
+        gl_capture_word(target);
+        gl_capture_word((uint32_t)count);
+        for (GLsizei i = 0; i < count; i++) {
+            gl_capture_word(attachments[i]);
+        }
+        gl_capture_end();
+    }
+    glInvalidateFramebuffer(target, count, attachments);
+}
+
+void gl_capture_blit_framebuffer(GLint src_x0, GLint src_y0, GLint src_x1, GLint src_y1,
+                                 GLint dst_x0, GLint dst_y0, GLint dst_x1, GLint dst_y1,
+                                 GLbitfield mask, GLenum filter) {
+    if (capture.file != NULL) {
+        const GLint args[] = { src_x0, src_y0, src_x1, src_y1, dst_x0, dst_y0, dst_x1, dst_y1 };
+        gl_capture_begin(GL_CAPTURE_BLIT_FRAMEBUFFER);
+        for (int i = 0; i < 8; i++) {
+            gl_capture_word((uint32_t)args[i]);
+        }
+        gl_capture_word(mask);
+        gl_capture_word(filter);
+        gl_capture_end();
+    }
+    glBlitFramebuffer(src_x0, src_y0, src_x1, src_y1, dst_x0, dst_y0, dst_x1, dst_y1, mask, filter);
+}
+
+void gl_capture_use_program(GLuint program) {
+    if (capture.file != NULL) {
+        gl_capture_write_program(program);
+        gl_capture_begin(GL_CAPTURE_USE_PROGRAM);
+        gl_capture_word(program);
+        gl_capture_end();
+    }
+    glUseProgram(program);
+}
+
+void gl_capture_uniform_matrix_4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+    if (capture.file != NULL) {
+        gl_capture_begin(GL_CAPTURE_UNIFORM_MATRIX_4FV);
+        gl_capture_word((uint32_t)location);
+        gl_capture_word((uint32_t)count);
+        gl_capture_word(transpose);
+        for (GLsizei i = 0; i < 16 * count; i++) {
+            gl_capture_float(value[i]);
+        }
+        gl_capture_end();
+    }
+    glUniformMatrix4fv(location, count, transpose, value);
+}
+
+void gl_capture_bind_vertex_array(GLuint array) {
+    glBindVertexArray(array);
+    if (capture.file != NULL) {
+        gl_capture_write_vertex_array(array);
+        gl_capture_begin(GL_CAPTURE_BIND_VERTEX_ARRAY);
+        gl_capture_word(array);
+        gl_capture_end();
+    }
+}
+
+void gl_capture_draw_elements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+    if (capture.file != NULL) {
+        gl_capture_begin(GL_CAPTURE_DRAW_ELEMENTS);
+        gl_capture_word(mode);
+        gl_capture_word((uint32_t)count);
+        gl_capture_word(type);
+        gl_capture_word((uint32_t)(uintptr_t)indices);
+        gl_capture_end();
+    }
+    glDrawElements(mode, count, type, indices);
+}
+
+void gl_capture_record_draw_elements_base_vertex(GLenum mode, GLsizei count, GLenum type, const void* indices,
+                                                 GLint base_vertex) {
+    if (capture.file != NULL) {
+        gl_capture_begin(GL_CAPTURE_DRAW_ELEMENTS_BASE_VERTEX);
+        gl_capture_word(mode);
+        gl_capture_word((uint32_t)count);
+        gl_capture_word(type);
+        gl_capture_word((uint32_t)(uintptr_t)indices);
+        gl_capture_word((uint32_t)base_vertex);
+        gl_capture_end();
+    }
+}
+
+void gl_capture_flush() {
+    if (capture.file != NULL) {
+        gl_capture_begin(GL_CAPTURE_FLUSH);
+        gl_capture_end();
+    }
+    glFlush();
+}
+
+#endif // ENABLE_GL_CAPTURE
@@ -0,0 +1,147 @@
+#ifndef _GL_CAPTURE_H
+#define _GL_CAPTURE_H
+
+#include <GLES3/gl3.h>
+#include <stdint.h>
+
+// Captures the GL calls of the render path, with the data they use, to a
+// compact file for a number of frames, so tools/gl_replay.c can re-execute
+// them on a host GL and time every call. Files that include this header
+// have their render path calls redirected to the capture wrappers below;
+// calls from other files, and the loader thread, are not captured.
+//
+// Objects are written the first time a captured call uses them: programs
+// with their shader sources and attribute and uniform locations, vertex
+// arrays with their attribute layout, buffers with their contents at that
+// point, and textures and framebuffers with their size and attachments.
+//
+// Build with -DENABLE_GL_CAPTURE=1 to compile it in; it defaults to off,
+// and then every call goes straight to GL.
+
+#ifndef ENABLE_GL_CAPTURE
+#define ENABLE_GL_CAPTURE 0
+#endif
+
+#define GL_CAPTURE_MAGIC 0x4c475148u /* "HQGL" */
+#define GL_CAPTURE_VERSION 1
+
+// Every record is a header followed by size bytes of 32 bit words.
+// Strings and blobs are a byte length followed by the bytes, padded to a
+// word.
+enum gl_capture_op {
+    // frame index (low, high)
+    GL_CAPTURE_FRAME,
+    // program, vertex source, fragment source, attribute count,
+    // (location, name) per attribute, uniform count, (location, name) per
+    // uniform
+    GL_CAPTURE_PROGRAM,
+    // buffer, contents
+    GL_CAPTURE_BUFFER,
+    // vertex array, element buffer, attribute count, (index, size, type,
+    // normalized, stride, buffer, offset) per enabled attribute
+    GL_CAPTURE_VERTEX_ARRAY,
+    // texture, width, height, internal format
+    GL_CAPTURE_TEXTURE,
+    // framebuffer, color, depth and stencil texture
+    GL_CAPTURE_FRAMEBUFFER,
+    // the GL call of the same name, with its arguments in order
+    GL_CAPTURE_BIND_FRAMEBUFFER,
+    GL_CAPTURE_FRAMEBUFFER_TEXTURE_2D,
+    GL_CAPTURE_ENABLE,
+    GL_CAPTURE_DISABLE,
+    GL_CAPTURE_CLEAR_COLOR,
+    GL_CAPTURE_CLEAR,
+    GL_CAPTURE_VIEWPORT,
+    GL_CAPTURE_SCISSOR,
+    // target, count, attachments
+    GL_CAPTURE_INVALIDATE_FRAMEBUFFER,
+    GL_CAPTURE_BLIT_FRAMEBUFFER,
+    GL_CAPTURE_USE_PROGRAM,
+    // location, count, transpose, matrices
+    GL_CAPTURE_UNIFORM_MATRIX_4FV,
+    GL_CAPTURE_BIND_VERTEX_ARRAY,
+    // mode, count, type, offset into the element buffer
+    GL_CAPTURE_DRAW_ELEMENTS,
+    // mode, count, type, offset into the element buffer, base vertex
+    GL_CAPTURE_DRAW_ELEMENTS_BASE_VERTEX,
+    GL_CAPTURE_FLUSH,
+    GL_CAPTURE_OP_END,
+};
+
+struct gl_capture_file_header {
+    uint32_t magic;
+    uint32_t version;
+};
+
+struct gl_capture_header {
+    uint32_t op;
+    uint32_t size;
+};
+
+#if ENABLE_GL_CAPTURE
+
+// Starts writing to path at the next gl_capture_frame and stops by itself
+// after frame_count frames. GL thread only, as are all the functions below.
+void gl_capture_start(const char* path, uint32_t frame_count);
+void gl_capture_stop();
+// Once per frame, before any of its GL calls.
+void gl_capture_frame(uint64_t frame_index);
+
+void gl_capture_bind_framebuffer(GLenum target, GLuint framebuffer);
+void gl_capture_framebuffer_texture_2d(GLenum target, GLenum attachment, GLenum textarget, GLuint texture,
+                                       GLint level);
+void gl_capture_enable(GLenum cap);
+void gl_capture_disable(GLenum cap);
+void gl_capture_clear_color(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+void gl_capture_clear(GLbitfield mask);
+void gl_capture_viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void gl_capture_scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+void gl_capture_invalidate_framebuffer(GLenum target, GLsizei count, const GLenum* attachments);
+void gl_capture_blit_framebuffer(GLint src_x0, GLint src_y0, GLint src_x1, GLint src_y1,
+                                 GLint dst_x0, GLint dst_y0, GLint dst_x1, GLint dst_y1,
+                                 GLbitfield mask, GLenum filter);
+void gl_capture_use_program(GLuint program);
+void gl_capture_uniform_matrix_4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+void gl_capture_bind_vertex_array(GLuint array);
+void gl_capture_draw_elements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+void gl_capture_flush();
+
+// Only records the call; glDrawElementsBaseVertex is called through a
+// function pointer, which the redirection below can't reach.
+void gl_capture_record_draw_elements_base_vertex(GLenum mode, GLsizei count, GLenum type, const void* indices,
+                                                 GLint base_vertex);
+
+#define GL_CAPTURE_START(path, frame_count) gl_capture_start(path, frame_count)
+#define GL_CAPTURE_STOP() gl_capture_stop()
+#define GL_CAPTURE_FRAME(frame_index) gl_capture_frame(frame_index)
+#define GL_CAPTURE_DRAW_ELEMENTS_BASE_VERTEX(mode, count, type, indices, base_vertex) \
+    gl_capture_record_draw_elements_base_vertex(mode, count, type, indices, base_vertex)
+
+#ifndef GL_CAPTURE_IMPLEMENTATION
+#define glBindFramebuffer gl_capture_bind_framebuffer
+#define glFramebufferTexture2D gl_capture_framebuffer_texture_2d
+#define glEnable gl_capture_enable
+#define glDisable gl_capture_disable
+#define glClearColor gl_capture_clear_color
+#define glClear gl_capture_clear
+#define glViewport gl_capture_viewport
+#define glScissor gl_capture_scissor
+#define glInvalidateFramebuffer gl_capture_invalidate_framebuffer
+#define glBlitFramebuffer gl_capture_blit_framebuffer
+#define glUseProgram gl_capture_use_program
+#define glUniformMatrix4fv gl_capture_uniform_matrix_4fv
+#define glBindVertexArray gl_capture_bind_vertex_array
+#define glDrawElements gl_capture_draw_elements
+#define glFlush gl_capture_flush
+#endif
+
+#else
+
+#define GL_CAPTURE_START(path, frame_count) ((void)0)
+#define GL_CAPTURE_STOP() ((void)0)
+#define GL_CAPTURE_FRAME(frame_index) ((void)0)
+#define GL_CAPTURE_DRAW_ELEMENTS_BASE_VERTEX(mode, count, type, indices, base_vertex) ((void)0)
+
+#endif // ENABLE_GL_CAPTURE
+
+#endif /* _GL_CAPTURE_H */
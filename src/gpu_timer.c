@@ -0,0 +1,70 @@
+#include "gpu_timer.h"
+#include "log.h"
+#include "resources.h"
+#include <EGL/egl.h>
+#include <GLES2/gl2ext.h>
+#include <string.h>
+
+static PFNGLGETQUERYOBJECTUI64VEXTPROC ext_glGetQueryObjectui64vEXT = NULL;
+
+void gpu_timer_create(struct gpu_timer* timer, const char* owner) {
+    memset(timer, 0, sizeof(*timer));
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    if (extensions == NULL || strstr(extensions, "GL_EXT_disjoint_timer_query") == NULL) {
+        log_write(LOG_CATEGORY_GL, LOG_PRIORITY_INFO, "GL_EXT_disjoint_timer_query not supported, no GPU timing");
+        return;
+    }
+    ext_glGetQueryObjectui64vEXT =
+            (PFNGLGETQUERYOBJECTUI64VEXTPROC)eglGetProcAddress("glGetQueryObjectui64vEXT");
+    if (ext_glGetQueryObjectui64vEXT == NULL) {
+        return;
+    }
+    glGenQueries(GPU_TIMER_QUERIES, timer->queries);
+    for (int i = 0; i < GPU_TIMER_QUERIES; ++i) {
+        resources_track(RESOURCE_GL_QUERY, timer->queries[i], 0, owner);
+    }
+    timer->supported = true;
+}
+
+void gpu_timer_begin(struct gpu_timer* timer) {
+    if (!timer->supported || timer->pending[timer->next]) {
+        return;
+    }
+    glBeginQuery(GL_TIME_ELAPSED_EXT, timer->queries[timer->next]);
+    timer->active = true;
+}
+
+void gpu_timer_end(struct gpu_timer* timer) {
+    if (!timer->active) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED_EXT);
+    timer->pending[timer->next] = true;
+    timer->next = (timer->next + 1) % GPU_TIMER_QUERIES;
+    timer->active = false;
+}
+
+bool gpu_timer_collect(struct gpu_timer* timer, double* ms) {
+    if (!timer->supported || !timer->pending[timer->oldest]) {
+        return false;
+    }
+    GLuint query = timer->queries[timer->oldest];
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return false;
+    }
+    timer->pending[timer->oldest] = false;
+    timer->oldest = (timer->oldest + 1) % GPU_TIMER_QUERIES;
+
+    // a disjoint event (e.g. a clock change) makes results in flight meaningless
+    GLint disjoint = GL_FALSE;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    if (disjoint) {
+        return false;
+    }
+    GLuint64 elapsed = 0;
+    ext_glGetQueryObjectui64vEXT(query, GL_QUERY_RESULT, &elapsed);
+    *ms = elapsed / 1e6;
+    return true;
+}
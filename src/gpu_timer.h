@@ -0,0 +1,33 @@
+#ifndef _GPU_TIMER_H
+#define _GPU_TIMER_H
+
+#include <GLES3/gl3.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Measures GPU time with GL_EXT_disjoint_timer_query. Results become
+// available a few frames after the work was submitted, so the queries are
+// kept in a small ring and collected without ever stalling on the GPU.
+// Time-elapsed queries can't nest: use one timer per measured span.
+
+#define GPU_TIMER_QUERIES 4
+
+struct gpu_timer {
+    bool supported;
+    GLuint queries[GPU_TIMER_QUERIES];
+    bool pending[GPU_TIMER_QUERIES];
+    uint32_t next;
+    uint32_t oldest;
+    bool active;
+};
+
+void gpu_timer_create(struct gpu_timer* timer, const char* owner);
+
+// Does nothing if every query is still in flight; that frame goes unmeasured.
+void gpu_timer_begin(struct gpu_timer* timer);
+void gpu_timer_end(struct gpu_timer* timer);
+
+// Returns true and the GPU time of the oldest finished span, if any.
+bool gpu_timer_collect(struct gpu_timer* timer, double* ms);
+
+#endif /* _GPU_TIMER_H */
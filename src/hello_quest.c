@@ -1,6 +1,25 @@
 #include "android_native_app_glue.h"
-#include <android/log.h>
+#include "arena.h"
+#include "bench.h"
+#include "draw_list.h"
+#include "entities.h"
+#include "font.h"
+#include "foveation.h"
+#include "geometry_heap.h"
+#include "gl_capture.h"
+#include "gpu_timer.h"
+#include "jobs.h"
+#include "layers.h"
+#include "loader.h"
+#include "log.h"
+#include "pacing.h"
+#include "recorder.h"
+#include "resources.h"
+#include "trace.h"
+#include "transforms.h"
+#include "xr_linear.h"
 #include <android/window.h>
+#include <sys/system_properties.h>
 #define XR_USE_PLATFORM_ANDROID
 #define XR_USE_GRAPHICS_API_OPENGL_ES
 #include <EGL/egl.h>
@@ -15,15 +34,17 @@
 #include <unistd.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 
-static const char* TAG = "hello_quest";
-
-#define error(...) __android_log_print(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+#define error(...) log_write(LOG_CATEGORY_APP, LOG_PRIORITY_ERROR, __VA_ARGS__)
 
 #ifndef NDEBUG
-#define info(...) __android_log_print(ANDROID_LOG_VERBOSE, TAG, __VA_ARGS__)
+#define info(...) log_write(LOG_CATEGORY_APP, LOG_PRIORITY_VERBOSE, __VA_ARGS__)
+#else
+#define info(...) ((void)0)
 #endif // NDEBUG
 
 #define XRCMD(cmd) \
@@ -45,204 +66,6 @@ static const char* TAG = "hello_quest";
 
 //#define GL(stmt) #stmt
 
-typedef struct XrMatrix4x4f {
-    float m[16];
-} XrMatrix4x4f;
-
-inline static void XrMatrix4x4f_CreateProjection(XrMatrix4x4f* result, const float tanAngleLeft, const float tanAngleRight,
-                                                 const float tanAngleUp, float const tanAngleDown,
-                                                 const float nearZ, const float farZ) {
-    const float tanAngleWidth = tanAngleRight - tanAngleLeft;
-    const float tanAngleHeight = (tanAngleUp - tanAngleDown);
-    const float offsetZ = nearZ;
-
-    if (farZ <= nearZ) {
-        // place the far plane at infinity
-        result->m[0] = 2.0f / tanAngleWidth;
-        result->m[4] = 0.0f;
-        result->m[8] = (tanAngleRight + tanAngleLeft) / tanAngleWidth;
-        result->m[12] = 0.0f;
-
-        result->m[1] = 0.0f;
-        result->m[5] = 2.0f / tanAngleHeight;
-        result->m[9] = (tanAngleUp + tanAngleDown) / tanAngleHeight;
-        result->m[13] = 0.0f;
-
-        result->m[2] = 0.0f;
-        result->m[6] = 0.0f;
-        result->m[10] = -1.0f;
-        result->m[14] = -(nearZ + offsetZ);
-
-        result->m[3] = 0.0f;
-        result->m[7] = 0.0f;
-        result->m[11] = -1.0f;
-        result->m[15] = 0.0f;
-    } else {
-        // normal projection
-        result->m[0] = 2.0f / tanAngleWidth;
-        result->m[4] = 0.0f;
-        result->m[8] = (tanAngleRight + tanAngleLeft) / tanAngleWidth;
-        result->m[12] = 0.0f;
-
-        result->m[1] = 0.0f;
-        result->m[5] = 2.0f / tanAngleHeight;
-        result->m[9] = (tanAngleUp + tanAngleDown) / tanAngleHeight;
-        result->m[13] = 0.0f;
-
-        result->m[2] = 0.0f;
-        result->m[6] = 0.0f;
-        result->m[10] = -(farZ + offsetZ) / (farZ - nearZ);
-        result->m[14] = -(farZ * (nearZ + offsetZ)) / (farZ - nearZ);
-
-        result->m[3] = 0.0f;
-        result->m[7] = 0.0f;
-        result->m[11] = -1.0f;
-        result->m[15] = 0.0f;
-    }
-}
-
-inline static void XrMatrix4x4f_CreateProjectionFov(XrMatrix4x4f* result, const XrFovf fov, const float nearZ, const float farZ) {
-    const float tanLeft = tanf(fov.angleLeft);
-    const float tanRight = tanf(fov.angleRight);
-
-    const float tanDown = tanf(fov.angleDown);
-    const float tanUp = tanf(fov.angleUp);
-
-    XrMatrix4x4f_CreateProjection(result, tanLeft, tanRight, tanUp, tanDown, nearZ, farZ);
-}
-
-inline static void XrMatrix4x4f_CreateScale(XrMatrix4x4f* result, const float x, const float y, const float z) {
-    result->m[0] = x;
-    result->m[1] = 0.0f;
-    result->m[2] = 0.0f;
-    result->m[3] = 0.0f;
-    result->m[4] = 0.0f;
-    result->m[5] = y;
-    result->m[6] = 0.0f;
-    result->m[7] = 0.0f;
-    result->m[8] = 0.0f;
-    result->m[9] = 0.0f;
-    result->m[10] = z;
-    result->m[11] = 0.0f;
-    result->m[12] = 0.0f;
-    result->m[13] = 0.0f;
-    result->m[14] = 0.0f;
-    result->m[15] = 1.0f;
-}
-
-inline static void XrMatrix4x4f_CreateFromQuaternion(XrMatrix4x4f* result, const XrQuaternionf* quat) {
-    const float x2 = quat->x + quat->x;
-    const float y2 = quat->y + quat->y;
-    const float z2 = quat->z + quat->z;
-
-    const float xx2 = quat->x * x2;
-    const float yy2 = quat->y * y2;
-    const float zz2 = quat->z * z2;
-
-    const float yz2 = quat->y * z2;
-    const float wx2 = quat->w * x2;
-    const float xy2 = quat->x * y2;
-    const float wz2 = quat->w * z2;
-    const float xz2 = quat->x * z2;
-    const float wy2 = quat->w * y2;
-
-    result->m[0] = 1.0f - yy2 - zz2;
-    result->m[1] = xy2 + wz2;
-    result->m[2] = xz2 - wy2;
-    result->m[3] = 0.0f;
-
-    result->m[4] = xy2 - wz2;
-    result->m[5] = 1.0f - xx2 - zz2;
-    result->m[6] = yz2 + wx2;
-    result->m[7] = 0.0f;
-
-    result->m[8] = xz2 + wy2;
-    result->m[9] = yz2 - wx2;
-    result->m[10] = 1.0f - xx2 - yy2;
-    result->m[11] = 0.0f;
-
-    result->m[12] = 0.0f;
-    result->m[13] = 0.0f;
-    result->m[14] = 0.0f;
-    result->m[15] = 1.0f;
-}
-
-inline static void XrMatrix4x4f_CreateTranslation(XrMatrix4x4f* result, const float x, const float y, const float z) {
-    result->m[0] = 1.0f;
-    result->m[1] = 0.0f;
-    result->m[2] = 0.0f;
-    result->m[3] = 0.0f;
-    result->m[4] = 0.0f;
-    result->m[5] = 1.0f;
-    result->m[6] = 0.0f;
-    result->m[7] = 0.0f;
-    result->m[8] = 0.0f;
-    result->m[9] = 0.0f;
-    result->m[10] = 1.0f;
-    result->m[11] = 0.0f;
-    result->m[12] = x;
-    result->m[13] = y;
-    result->m[14] = z;
-    result->m[15] = 1.0f;
-}
-
-inline static void XrMatrix4x4f_Multiply(XrMatrix4x4f* result, const XrMatrix4x4f* a, const XrMatrix4x4f* b) {
-    result->m[0] = a->m[0] * b->m[0] + a->m[4] * b->m[1] + a->m[8] * b->m[2] + a->m[12] * b->m[3];
-    result->m[1] = a->m[1] * b->m[0] + a->m[5] * b->m[1] + a->m[9] * b->m[2] + a->m[13] * b->m[3];
-    result->m[2] = a->m[2] * b->m[0] + a->m[6] * b->m[1] + a->m[10] * b->m[2] + a->m[14] * b->m[3];
-    result->m[3] = a->m[3] * b->m[0] + a->m[7] * b->m[1] + a->m[11] * b->m[2] + a->m[15] * b->m[3];
-
-    result->m[4] = a->m[0] * b->m[4] + a->m[4] * b->m[5] + a->m[8] * b->m[6] + a->m[12] * b->m[7];
-    result->m[5] = a->m[1] * b->m[4] + a->m[5] * b->m[5] + a->m[9] * b->m[6] + a->m[13] * b->m[7];
-    result->m[6] = a->m[2] * b->m[4] + a->m[6] * b->m[5] + a->m[10] * b->m[6] + a->m[14] * b->m[7];
-    result->m[7] = a->m[3] * b->m[4] + a->m[7] * b->m[5] + a->m[11] * b->m[6] + a->m[15] * b->m[7];
-
-    result->m[8] = a->m[0] * b->m[8] + a->m[4] * b->m[9] + a->m[8] * b->m[10] + a->m[12] * b->m[11];
-    result->m[9] = a->m[1] * b->m[8] + a->m[5] * b->m[9] + a->m[9] * b->m[10] + a->m[13] * b->m[11];
-    result->m[10] = a->m[2] * b->m[8] + a->m[6] * b->m[9] + a->m[10] * b->m[10] + a->m[14] * b->m[11];
-    result->m[11] = a->m[3] * b->m[8] + a->m[7] * b->m[9] + a->m[11] * b->m[10] + a->m[15] * b->m[11];
-
-    result->m[12] = a->m[0] * b->m[12] + a->m[4] * b->m[13] + a->m[8] * b->m[14] + a->m[12] * b->m[15];
-    result->m[13] = a->m[1] * b->m[12] + a->m[5] * b->m[13] + a->m[9] * b->m[14] + a->m[13] * b->m[15];
-    result->m[14] = a->m[2] * b->m[12] + a->m[6] * b->m[13] + a->m[10] * b->m[14] + a->m[14] * b->m[15];
-    result->m[15] = a->m[3] * b->m[12] + a->m[7] * b->m[13] + a->m[11] * b->m[14] + a->m[15] * b->m[15];
-}
-
-inline static void XrMatrix4x4f_CreateTranslationRotationScale(XrMatrix4x4f* result, const XrVector3f* translation,
-                                                               const XrQuaternionf* rotation, const XrVector3f* scale) {
-    XrMatrix4x4f scaleMatrix;
-    XrMatrix4x4f_CreateScale(&scaleMatrix, scale->x, scale->y, scale->z);
-
-    XrMatrix4x4f rotationMatrix;
-    XrMatrix4x4f_CreateFromQuaternion(&rotationMatrix, rotation);
-
-    XrMatrix4x4f translationMatrix;
-    XrMatrix4x4f_CreateTranslation(&translationMatrix, translation->x, translation->y, translation->z);
-
-    XrMatrix4x4f combinedMatrix;
-    XrMatrix4x4f_Multiply(&combinedMatrix, &rotationMatrix, &scaleMatrix);
-    XrMatrix4x4f_Multiply(result, &translationMatrix, &combinedMatrix);
-}
-
-inline static void XrMatrix4x4f_InvertRigidBody(XrMatrix4x4f* result, const XrMatrix4x4f* src) {
-    result->m[0] = src->m[0];
-    result->m[1] = src->m[4];
-    result->m[2] = src->m[8];
-    result->m[3] = 0.0f;
-    result->m[4] = src->m[1];
-    result->m[5] = src->m[5];
-    result->m[6] = src->m[9];
-    result->m[7] = 0.0f;
-    result->m[8] = src->m[2];
-    result->m[9] = src->m[6];
-    result->m[10] = src->m[10];
-    result->m[11] = 0.0f;
-    result->m[12] = -(src->m[0] * src->m[12] + src->m[1] * src->m[13] + src->m[2] * src->m[14]);
-    result->m[13] = -(src->m[4] * src->m[12] + src->m[5] * src->m[13] + src->m[6] * src->m[14]);
-    result->m[14] = -(src->m[8] * src->m[12] + src->m[9] * src->m[13] + src->m[10] * src->m[14]);
-    result->m[15] = 1.0f;
-}
-
 static const char*
 egl_get_error_string(EGLint error)
 {
@@ -301,7 +124,8 @@ static const char* gl_get_framebuffer_status_string(GLenum status) {
 
 void gl_debug_message(GLenum source, GLenum type, GLuint id, GLenum severity,
                                  GLsizei length, const GLchar* message, const void* userParam) {
-    info("GL CALLBACK: type = 0x%x, severity = 0x%x, message = %s\n", type, severity, message);
+    log_write(LOG_CATEGORY_GL, LOG_PRIORITY_VERBOSE, "GL CALLBACK: type = 0x%x, severity = 0x%x, message = %s",
+              type, severity, message);
 }
 
 #define VIEW_COUNT 2
@@ -314,13 +138,42 @@ struct egl {
     EGLConfig config;
 };
 
+// Everything that forces a swapchain to be recreated when it changes.
+struct swapchain_params {
+    int64_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t sample_count;
+};
+
 struct framebuffer {
     XrSwapchain swapchain;
+    struct swapchain_params params;
     int swapchain_length;
     int width;
     int height;
+    // the swapchain is over-allocated, see DRS_MAX_SCALE; scale 1.0 renders this much
+    int recommended_width;
+    int recommended_height;
     XrSwapchainImageOpenGLESKHR* color_texture_swap_chain;
+    // depth swapchain submitted with XR_KHR_composition_layer_depth, or
+    // XR_NULL_HANDLE if depth_textures are private GL textures
+    XrSwapchain depth_swapchain;
+    XrSwapchainImageOpenGLESKHR* depth_swapchain_images;
+    GLuint* depth_textures;
     GLuint* framebuffers;
+    // which depth image is attached to each framebuffer
+    uint32_t* framebuffer_depth;
+    // reduced resolution target for the foveation fallback, 0 if unused
+    GLuint periphery_framebuffer;
+    int periphery_width;
+    int periphery_height;
+    // space warp motion vector and depth swapchains, XR_NULL_HANDLE if unused
+    XrSwapchain motion_swapchain;
+    XrSwapchain motion_depth_swapchain;
+    XrSwapchainImageOpenGLESKHR* motion_images;
+    XrSwapchainImageOpenGLESKHR* motion_depth_images;
+    GLuint motion_framebuffer;
 };
 
 enum attrib {
@@ -335,6 +188,9 @@ enum uniform {
     UNIFORM_MODEL_MATRIX = UNIFORM_BEGIN,
     UNIFORM_VIEW_MATRIX,
     UNIFORM_PROJECTION_MATRIX,
+    UNIFORM_PREV_MODEL_MATRIX,
+    UNIFORM_MVP_MATRIX,
+    UNIFORM_PREV_MVP_MATRIX,
     UNIFORM_END,
 };
 
@@ -348,54 +204,100 @@ static const char* ATTRIB_NAMES[ATTRIB_END] = {
 };
 
 static const char* UNIFORM_NAMES[UNIFORM_END] = {
-        "uModelMatrix", "uViewMatrix", "uProjectionMatrix",
+        "uModelMatrix", "uViewMatrix", "uProjectionMatrix", "uPrevModelMatrix",
+        "uModelViewProjectionMatrix", "uPrevModelViewProjectionMatrix",
+};
+
+// Shader variants: each feature is a #define compiled into its own program,
+// so features cost nothing in shaders that don't use them. Programs are
+// compiled on first use and cached by feature mask.
+//
+// CPU_MVP: the model-view-projection matrix comes premultiplied from the
+// draw list, one matrix-vector product per vertex instead of three.
+// MOTION_VECTORS: output object motion for space warp instead of color.
+// Only object motion, so both positions go through the current view and
+// projection; the runtime accounts for head motion itself.
+#define SHADER_FEATURE_CPU_MVP (1u << 0)
+#define SHADER_FEATURE_MOTION_VECTORS (1u << 1)
+#define SHADER_FEATURE_COUNT 2
+#define SHADER_VARIANTS (1u << SHADER_FEATURE_COUNT)
+#define SHADER_SOURCE_SIZE 4096
+
+static const char* SHADER_FEATURE_DEFINES[SHADER_FEATURE_COUNT] = {
+        "CPU_MVP", "MOTION_VECTORS",
+};
+
+#define SCENE_SHADER_FEATURES SHADER_FEATURE_CPU_MVP
+#define SPACE_WARP_SHADER_FEATURES (SCENE_SHADER_FEATURES | SHADER_FEATURE_MOTION_VECTORS)
+
+struct shaders {
+    struct program variants[SHADER_VARIANTS];
 };
 
 static const char VERTEX_SHADER[] =
-        "#version 300 es\n"
-        "\n"
         "in vec3 aPosition;\n"
         "in vec3 aColor;\n"
+        "#ifdef CPU_MVP\n"
+        "uniform mat4 uModelViewProjectionMatrix;\n"
+        "uniform mat4 uPrevModelViewProjectionMatrix;\n"
+        "#else\n"
         "uniform mat4 uModelMatrix;\n"
+        "uniform mat4 uPrevModelMatrix;\n"
         "uniform mat4 uViewMatrix;\n"
         "uniform mat4 uProjectionMatrix;\n"
+        "#endif\n"
         "\n"
+        "#ifdef MOTION_VECTORS\n"
+        "out vec4 vPosition;\n"
+        "out vec4 vPrevPosition;\n"
+        "#else\n"
         "out vec3 vColor;\n"
+        "#endif\n"
         "void main()\n"
         "{\n"
-        "	gl_Position = uProjectionMatrix * ( uViewMatrix * ( uModelMatrix * vec4( "
-        "aPosition * 0.1, 1.0 ) ) );\n"
+        "	vec4 position = vec4( aPosition, 1.0 );\n"
+        "#ifdef CPU_MVP\n"
+        "	gl_Position = uModelViewProjectionMatrix * position;\n"
+        "#else\n"
+        "	gl_Position = uProjectionMatrix * ( uViewMatrix * ( uModelMatrix * position ) );\n"
+        "#endif\n"
+        "#ifdef MOTION_VECTORS\n"
+        "	vPosition = gl_Position;\n"
+        "#ifdef CPU_MVP\n"
+        "	vPrevPosition = uPrevModelViewProjectionMatrix * position;\n"
+        "#else\n"
+        "	vPrevPosition = uProjectionMatrix * ( uViewMatrix * ( uPrevModelMatrix * position ) );\n"
+        "#endif\n"
+        "#else\n"
         "	vColor = aColor;\n"
+        "#endif\n"
         "}\n";
 
-static const char FRAGMENT_SHADER[] = "#version 300 es\n"
-                                      "\n"
-                                      "in lowp vec3 vColor;\n"
-                                      "out lowp vec4 outColor;\n"
-                                      "void main()\n"
-                                      "{\n"
-                                      "	outColor = vec4(vColor, 1.0);\n"
-                                      "}\n";
-
-struct attrib_pointer {
-    GLint size;
-    GLenum type;
-    GLboolean normalized;
-    GLsizei stride;
-    const GLvoid* pointer;
-};
+static const char FRAGMENT_SHADER[] =
+        "#ifdef MOTION_VECTORS\n"
+        "in highp vec4 vPosition;\n"
+        "in highp vec4 vPrevPosition;\n"
+        "out highp vec4 outMotion;\n"
+        "void main()\n"
+        "{\n"
+        "	highp vec3 ndc = vPosition.xyz / vPosition.w;\n"
+        "	highp vec3 prev = vPrevPosition.xyz / vPrevPosition.w;\n"
+        "	outMotion = vec4(ndc - prev, 0.0);\n"
+        "}\n"
+        "#else\n"
+        "in lowp vec3 vColor;\n"
+        "out lowp vec4 outColor;\n"
+        "void main()\n"
+        "{\n"
+        "	outColor = vec4(vColor, 1.0);\n"
+        "}\n"
+        "#endif\n";
 
 struct vertex {
     float position[4];
     float color[4];
 };
 
-struct geometry {
-    GLuint vertex_array;
-    GLuint vertex_buffer;
-    GLuint index_buffer;
-};
-
 static const struct attrib_pointer ATTRIB_POINTERS[ATTRIB_END] = {
         { 3, GL_FLOAT, GL_FALSE, sizeof(struct vertex),
                 (const GLvoid*)offsetof(struct vertex, position) },
@@ -425,14 +327,271 @@ static const unsigned short INDICES[] = {
 
 static const GLsizei NUM_INDICES = sizeof(INDICES) / sizeof(INDICES[0]);
 
+// Looper timeouts for when we are not paced by xrWaitFrame. Window and
+// lifecycle commands wake the looper through its fds, but xrPollEvent has
+// no fd to block on, so we still have to wake up periodically to see the
+// session become READY - just not continuously.
+#define LOOP_TIMEOUT_RESUMED_MS 10
+#define LOOP_TIMEOUT_PAUSED_MS 100
+#define LOOP_STATS_INTERVAL_NS 5000000000LL
+
+// mostly the CPU side images of the quad layers
+#define PERSISTENT_ARENA_SIZE (2 * 1024 * 1024)
+// mostly the draw lists of both views, commands and matrices for every entity
+#define FRAME_ARENA_SIZE (1536 * 1024)
+#define SWAPCHAIN_ARENA_SIZE (16 * 1024)
+
+// also handed to the runtime with submitted depth, see XR_KHR_composition_layer_depth
+#define PROJECTION_NEAR_Z 0.05f
+#define PROJECTION_FAR_Z 100.0f
+#define DEPTH_FORMAT GL_DEPTH_COMPONENT24
+
+// estimated GPU memory we allow ourselves, see resources_report
+#define RESOURCE_BUDGET_BYTES (256ull * 1024 * 1024)
+
+#define GEOMETRY_HEAP_VERTICES 65536
+#define GEOMETRY_HEAP_INDICES (3 * 65536)
+
+// "record" or "replay" a session trace in the app's external files directory
+#define RECORDER_PROPERTY "debug.hello_quest.recorder"
+#define RECORDER_FILE "session.trace"
+
+// number of frames of GL calls to capture at startup, in builds with
+// ENABLE_GL_CAPTURE; see tools/gl_replay.c
+#define GL_CAPTURE_PROPERTY "debug.hello_quest.glcapture"
+#define GL_CAPTURE_FILE "frames.glcapture"
+
+// benchmark spec, see bench_init; results go to bench-<name>.json in the
+// app's external files directory and the app exits when done
+#define BENCH_PROPERTY "debug.hello_quest.bench"
+// synthetic objects are laid out in layers of this size, the farthest
+// BENCH_SCENE_DISTANCE away and each following one BENCH_LAYER_SPACING closer
+#define BENCH_SCENE_SIZE 2.0f
+#define BENCH_SCENE_DISTANCE 3.0f
+#define BENCH_LAYER_SPACING 0.1f
+// quads per side of the synthetic mesh, at most
+#define BENCH_MAX_GRID 128
+
+#define ENTITY_CAPACITY 4096
+#define TRANSFORM_CAPACITY 4096
+#define ORBIT_SPEED 0.5f
+// size of the cubes, folded into their world matrices rather than applied per vertex
+#define CUBE_SCALE 0.1f
+// 0 starts one job thread per big core, the main thread included
+#define JOB_THREADS 0
+
+struct loop_stats {
+    int64_t report_time;
+    int64_t idle_ns;
+    int64_t wait_ns;
+    int64_t busy_ns;
+    uint32_t wakeups;
+    uint32_t frames;
+    uint64_t transform_updates;
+    uint64_t culled;
+};
+
+// The EGL context, programs and geometry are created once in app_create
+// and survive APP_CMD_PAUSE/RESUME and session STOPPING/READY cycles; only
+// the swapchains are recreated, and only when their parameters change.
+struct lifecycle {
+    // when we started waiting for the first frame after a resume, 0 if not
+    int64_t resume_time;
+    const char* resume_reason;
+    uint32_t session_begins;
+    uint32_t swapchain_recreations;
+};
+
+// Fixed foveated rendering. With XR_FB_foveation the runtime lowers the
+// shading rate towards the edges of each swapchain; without it gl_render
+// draws the whole view into a reduced resolution target, upscales that and
+// then redraws only a central inset at full resolution. Change the level at
+// runtime with `adb shell setprop debug.hello_quest.foveation
+// none|low|medium|high[,dynamic]`.
+#define FOVEATION_LEVEL XR_FOVEATION_LEVEL_HIGH_FB
+#define FOVEATION_DYNAMIC XR_FOVEATION_DYNAMIC_LEVEL_ENABLED_FB
+#define FOVEATION_PROPERTY "debug.hello_quest.foveation"
+#define FOVEATION_POLL_INTERVAL_NS 1000000000LL
+
+struct foveation_fallback {
+    // periphery resolution relative to the swapchain
+    float periphery_scale;
+    // size of the full resolution inset relative to the swapchain
+    float inset;
+};
+
+static const struct foveation_fallback FOVEATION_FALLBACK[] = {
+        [XR_FOVEATION_LEVEL_NONE_FB] = { 1.0f, 1.0f },
+        [XR_FOVEATION_LEVEL_LOW_FB] = { 0.75f, 0.6f },
+        [XR_FOVEATION_LEVEL_MEDIUM_FB] = { 0.5f, 0.5f },
+        [XR_FOVEATION_LEVEL_HIGH_FB] = { 0.5f, 0.4f },
+};
+
+// the periphery target is allocated once for the largest scale above
+#define FOVEATION_FALLBACK_MAX_SCALE 0.75f
+
+// Dynamic resolution: each frame renders into a sub rect of the swapchain,
+// centred so the runtime's foveation profile, which covers the whole
+// image, stays centred on what is rendered. It is sized by a PID
+// controller that keeps the slower of CPU and GPU frame time at
+// DRS_TARGET_LOAD of the display period. Scale only drops immediately;
+// raising it has to be justified for DRS_HOLD_FRAMES frames in a row so we
+// don't oscillate around a step boundary. The scale is kept as a whole
+// number of 1 / DRS_STEPS_PER_UNIT steps, so it always lands exactly on a
+// step, 1.0 included, and never drifts between them.
+#define DRS_STEPS_PER_UNIT 20
+#define DRS_MIN_STEP 12
+#define DRS_MAX_STEP 24
+#define DRS_MIN_SCALE ((float)DRS_MIN_STEP / DRS_STEPS_PER_UNIT)
+#define DRS_MAX_SCALE ((float)DRS_MAX_STEP / DRS_STEPS_PER_UNIT)
+#define DRS_TARGET_LOAD 0.85f
+#define DRS_KP 0.3f
+#define DRS_KI 0.05f
+#define DRS_KD 0.1f
+#define DRS_HOLD_FRAMES 30
+#define DRS_SMOOTHING 0.1f
+
+struct dynamic_resolution {
+    int step;
+    // step / DRS_STEPS_PER_UNIT
+    float scale;
+    float integral;
+    float prev_error;
+    uint32_t hold;
+    struct gpu_timer gpu_timer;
+    // exponentially smoothed, in ms
+    float cpu_ms;
+    float gpu_ms;
+    // the last unsmoothed GPU time, if one was collected this frame
+    bool gpu_collected;
+    float gpu_last_ms;
+    // measure, but leave the scale alone
+    bool fixed;
+    int64_t report_time;
+    uint32_t changes;
+};
+
+// Application SpaceWarp (XR_FB_space_warp): every projection view also
+// carries motion vectors and depth, and the runtime halves the rate it asks
+// us for frames, synthesizing the ones in between. On unless turned off
+// with `adb shell setprop debug.hello_quest.spacewarp 0`, read at launch
+// since it decides which swapchains and shaders are created.
+#define SPACE_WARP_PROPERTY "debug.hello_quest.spacewarp"
+#define SPACE_WARP_MOTION_FORMAT GL_RGBA16F
+#define SPACE_WARP_DEPTH_FORMAT DEPTH_FORMAT
+
+struct space_warp {
+    bool enabled;
+    uint32_t width;
+    uint32_t height;
+};
+
+// CPU/GPU clock governor (XR_EXT_performance_settings). Each domain runs at
+// the lowest sustained level that still holds frame rate: the GPU is raised
+// whenever dynamic resolution has to drop below 1.0 and lowered once its
+// load at scale 1.0 leaves room to spare, whatever supersampling dynamic
+// resolution spends that room on; the CPU follows its own frame time.
+// Thermal notifications cap the level, rendering notifications raise it.
+#define PERF_RAISE_LOAD 0.9f
+#define PERF_LOWER_LOAD 0.6f
+#define PERF_RAISE_FRAMES 15
+#define PERF_LOWER_FRAMES 300
+
+enum perf_domain_index {
+    PERF_DOMAIN_CPU,
+    PERF_DOMAIN_GPU,
+    PERF_DOMAIN_END,
+};
+
+// BOOST is for loading screens, not something to hold a session at
+static const XrPerfSettingsLevelEXT PERF_LEVELS[] = {
+        XR_PERF_SETTINGS_LEVEL_POWER_SAVINGS_EXT,
+        XR_PERF_SETTINGS_LEVEL_SUSTAINED_LOW_EXT,
+        XR_PERF_SETTINGS_LEVEL_SUSTAINED_HIGH_EXT,
+};
+
+#define PERF_LEVEL_COUNT (sizeof(PERF_LEVELS) / sizeof(PERF_LEVELS[0]))
+#define PERF_LEVEL_INITIAL 1
+
+struct perf_domain {
+    XrPerfSettingsDomainEXT domain;
+    const char* name;
+    uint32_t level;
+    // highest level allowed by the last thermal notification
+    uint32_t thermal_cap;
+    uint32_t raise_frames;
+    uint32_t lower_frames;
+};
+
+struct perf_governor {
+    bool enabled;
+    struct perf_domain domains[PERF_DOMAIN_END];
+};
+
+// Performance HUD in its own quad layer. The text is only re-rasterized and
+// uploaded every HUD_UPDATE_INTERVAL_NS; in between the compositor reuses
+// the last image. Toggle at runtime with
+// `adb shell setprop debug.hello_quest.hud 0|1`.
+#define HUD_WIDTH 256
+#define HUD_HEIGHT 128
+#define HUD_UPDATE_INTERVAL_NS 250000000LL
+#define HUD_TEXT_SIZE 256
+#define HUD_PROPERTY "debug.hello_quest.hud"
+
+struct hud {
+    bool enabled;
+    int quad;
+    int64_t update_time;
+    // accumulated since the last update
+    uint32_t frames;
+    uint32_t dropped;
+    float cpu_ms;
+    uint32_t draw_calls;
+};
+
 struct app {
     struct egl egl;
     bool resumed;
     ANativeWindow* window;
     uint64_t frame_index;
     struct framebuffer framebuffers[VIEW_COUNT];
-    struct program program;
-    struct geometry geometry;
+    struct shaders shaders;
+    // every static mesh, sharing one vertex array
+    struct geometry_heap geometry;
+    uint32_t cube_mesh;
+    struct loader loader;
+    struct entities entities;
+    struct transforms transforms;
+    struct jobs jobs;
+    // recorded on the job system each frame, replayed by gl_render
+    struct draw_list draw_lists[VIEW_COUNT];
+    struct job_counter draw_lists_recorded[VIEW_COUNT];
+    // rotates around the cube, carrying its child along
+    uint32_t orbit_node;
+    struct loop_stats loop_stats;
+    // init-time allocations that live as long as the app
+    struct arena persistent;
+    // per-frame scratch, reset every xrWaitFrame
+    struct frame_arena frame_arena;
+    // swapchain image and framebuffer arrays, reset whenever they are recreated
+    struct arena swapchain_arena;
+    struct lifecycle lifecycle;
+    struct foveation foveation;
+    int64_t foveation_poll_time;
+    struct dynamic_resolution resolution;
+    struct space_warp space_warp;
+    struct pacing pacing;
+    XrTime last_display_time;
+    struct perf_governor governor;
+    struct layers layers;
+    int title_quad;
+    struct hud hud;
+    struct recorder recorder;
+    // draw calls issued this frame
+    uint32_t draw_calls;
+    struct bench bench;
+    char bench_path[256];
+    bool exit_requested;
 };
 
 XrFormFactor app_config_form = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
@@ -449,11 +608,55 @@ XrEnvironmentBlendMode xr_blend = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;//standard VR
 XrView views[VIEW_COUNT];
 XrViewConfigurationView view_configs[VIEW_COUNT];
 XrDebugUtilsMessengerEXT xr_debug;
+int64_t xr_swapchain_format = GL_RGBA8;
+
+// Every extension the runtime offers is enabled at instance creation; these
+// record the ones we have specific code paths for.
+struct xr_extensions {
+    bool fb_foveation;
+    bool fb_foveation_configuration;
+    bool fb_swapchain_update_state;
+    bool fb_space_warp;
+    bool khr_composition_layer_depth;
+    bool fb_display_refresh_rate;
+    bool ext_performance_settings;
+};
+
+struct xr_extensions xr_ext = {};
 
 PFN_xrGetOpenGLESGraphicsRequirementsKHR ext_xrGetOpenGLESGraphicsRequirementsKHR = NULL;
 PFN_xrCreateDebugUtilsMessengerEXT ext_xrCreateDebugUtilsMessengerEXT = NULL;
+PFN_xrCreateFoveationProfileFB ext_xrCreateFoveationProfileFB = NULL;
+PFN_xrDestroyFoveationProfileFB ext_xrDestroyFoveationProfileFB = NULL;
+PFN_xrUpdateSwapchainFB ext_xrUpdateSwapchainFB = NULL;
+PFN_xrEnumerateDisplayRefreshRatesFB ext_xrEnumerateDisplayRefreshRatesFB = NULL;
+PFN_xrGetDisplayRefreshRateFB ext_xrGetDisplayRefreshRateFB = NULL;
+PFN_xrRequestDisplayRefreshRateFB ext_xrRequestDisplayRefreshRateFB = NULL;
+PFN_xrPerfSettingsSetPerformanceLevelEXT ext_xrPerfSettingsSetPerformanceLevelEXT = NULL;
+
+static int64_t time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void lifecycle_mark_resume(struct lifecycle* lifecycle, const char* reason) {
+    if (lifecycle->resume_time == 0) {
+        lifecycle->resume_time = time_ns();
+        lifecycle->resume_reason = reason;
+    }
+}
+
+static void lifecycle_first_frame(struct lifecycle* lifecycle) {
+    if (lifecycle->resume_time != 0) {
+        info("%s to first frame: %.1f ms (session begins %u, swapchain recreations %u)",
+             lifecycle->resume_reason, (time_ns() - lifecycle->resume_time) / 1e6,
+             lifecycle->session_begins, lifecycle->swapchain_recreations);
+        lifecycle->resume_time = 0;
+    }
+}
 
-static void egl_create(struct egl* egl) {
+static void egl_create(struct egl* egl, struct arena* arena) {
     info("get EGL display");
     egl->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
     if (egl->display == EGL_NO_DISPLAY) {
@@ -477,12 +680,8 @@ static void egl_create(struct egl* egl) {
     }
 
     info("allocate EGL configs");
-    EGLConfig* configs = malloc(num_configs * sizeof(EGLConfig));
-    if (configs == NULL) {
-        error("cant allocate EGL configs: %s",
-              egl_get_error_string(eglGetError()));
-        exit(EXIT_FAILURE);
-    }
+    size_t arena_mark_configs = arena_mark(arena);
+    EGLConfig* configs = arena_push_array(arena, EGLConfig, num_configs);
 
     info("get EGL configs");
     if (eglGetConfigs(egl->display, configs, num_configs, &num_configs) ==
@@ -557,7 +756,7 @@ static void egl_create(struct egl* egl) {
     egl->config = found_config;
 
     info("free EGL configs");
-    free(configs);
+    arena_rewind(arena, arena_mark_configs);
 
     info("create EGL context");
     static const EGLint CONTEXT_ATTRIBS[] = { EGL_CONTEXT_CLIENT_VERSION, 3,
@@ -608,30 +807,11 @@ static void egl_destroy(struct egl* egl) {
     eglTerminate(egl->display);
 }
 
-static void geometry_create(struct geometry* geometry) {
-    glGenVertexArrays(1, &geometry->vertex_array);
-    glBindVertexArray(geometry->vertex_array);
-    glGenBuffers(1, &geometry->vertex_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, geometry->vertex_buffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(VERTICES), VERTICES, GL_STATIC_DRAW);
-    for (enum attrib attrib = ATTRIB_BEGIN; attrib != ATTRIB_END; ++attrib) {
-        struct attrib_pointer attrib_pointer = ATTRIB_POINTERS[attrib];
-        glEnableVertexAttribArray(attrib);
-        glVertexAttribPointer(attrib, attrib_pointer.size, attrib_pointer.type,
-                              attrib_pointer.normalized, attrib_pointer.stride,
-                              attrib_pointer.pointer);
-    }
-    glGenBuffers(1, &geometry->index_buffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry->index_buffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(INDICES), INDICES,
-                 GL_STATIC_DRAW);
-    glBindVertexArray(0);
-}
-
-static void geometry_destroy(struct geometry* geometry) {
-    glDeleteBuffers(1, &geometry->index_buffer);
-    glDeleteBuffers(1, &geometry->vertex_buffer);
-    glDeleteVertexArrays(1, &geometry->vertex_array);
+static void geometry_create(struct app* app) {
+    geometry_heap_create(&app->geometry, sizeof(struct vertex), GEOMETRY_HEAP_VERTICES, GEOMETRY_HEAP_INDICES,
+                         ATTRIB_POINTERS, ATTRIB_END, "geometry");
+    app->cube_mesh = geometry_heap_add(&app->geometry, &app->loader, VERTICES,
+                                       sizeof(VERTICES) / sizeof(VERTICES[0]), INDICES, NUM_INDICES);
 }
 
 static GLuint compile_shader(GLenum type, const char* string) {
@@ -646,16 +826,18 @@ static GLuint compile_shader(GLenum type, const char* string) {
         char* log = malloc(length);
         glGetShaderInfoLog(shader, length, NULL, log);
         error("can't compile shader: %s", log);
+        free(log);
         exit(EXIT_FAILURE);
     }
     return shader;
 }
 
-static void program_create(struct program* program) {
+static void program_create(struct program* program, const char* vertex_source, const char* fragment_source) {
     program->program = glCreateProgram();
-    GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, VERTEX_SHADER);
+    resources_track(RESOURCE_GL_PROGRAM, program->program, 0, "program");
+    GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_source);
     glAttachShader(program->program, vertex_shader);
-    GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, FRAGMENT_SHADER);
+    GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
     glAttachShader(program->program, fragment_shader);
     for (enum attrib attrib = ATTRIB_BEGIN; attrib != ATTRIB_END; ++attrib) {
         glBindAttribLocation(program->program, attrib, ATTRIB_NAMES[attrib]);
@@ -669,16 +851,40 @@ static void program_create(struct program* program) {
         char* log = malloc(length);
         glGetProgramInfoLog(program->program, length, NULL, log);
         error("can't link program: %s", log);
+        free(log);
         exit(EXIT_FAILURE);
     }
+    // the program keeps the compiled code alive
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
     for (enum uniform uniform = UNIFORM_BEGIN; uniform != UNIFORM_END; ++uniform) {
         program->uniform_locations[uniform] =
                 glGetUniformLocation(program->program, UNIFORM_NAMES[uniform]);
     }
 }
 
-static void program_destroy(struct program* program) {
-    glDeleteProgram(program->program);
+// Compile and link the variant on first use; call it at init for every
+// variant a frame needs, compiling mid-session is a hitch.
+static const struct program* shaders_get(struct shaders* shaders, uint32_t features) {
+    struct program* program = &shaders->variants[features];
+    if (program->program != 0) {
+        return program;
+    }
+    char vertex_source[SHADER_SOURCE_SIZE];
+    char fragment_source[SHADER_SOURCE_SIZE];
+    char defines[256] = "#version 300 es\n";
+    for (int i = 0; i < SHADER_FEATURE_COUNT; i++) {
+        if (features & (1u << i)) {
+            strcat(defines, "#define ");
+            strcat(defines, SHADER_FEATURE_DEFINES[i]);
+            strcat(defines, "\n");
+        }
+    }
+    snprintf(vertex_source, sizeof(vertex_source), "%s%s", defines, VERTEX_SHADER);
+    snprintf(fragment_source, sizeof(fragment_source), "%s%s", defines, FRAGMENT_SHADER);
+    program_create(program, vertex_source, fragment_source);
+    info("shader variant %x compiled", features);
+    return program;
 }
 
 static void app_on_cmd(struct android_app* android_app, int32_t cmd) {
@@ -690,6 +896,7 @@ static void app_on_cmd(struct android_app* android_app, int32_t cmd) {
         case APP_CMD_RESUME:
             info("onResume()");
             app->resumed = true;
+            lifecycle_mark_resume(&app->lifecycle, "resume");
             break;
         case APP_CMD_PAUSE:
             info("onPause()");
@@ -715,56 +922,32 @@ static void app_on_cmd(struct android_app* android_app, int32_t cmd) {
     }
 }
 
-void openxr_poll_events() {
-    XrEventDataBuffer event_buffer = { XR_TYPE_EVENT_DATA_BUFFER };
-
-    while (xrPollEvent(xr_instance, &event_buffer) == XR_SUCCESS) {
-        if (event_buffer.type == XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED) {
-            info("XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED");
-            XrEventDataSessionStateChanged *changed = (XrEventDataSessionStateChanged*)&event_buffer;
-            xr_session_state = changed->state;
-
-            switch (xr_session_state) {
-                case XR_SESSION_STATE_READY:
-                    info("XR_SESSION_STATE_READY");
-                    XrSessionBeginInfo begin_info = {XR_TYPE_SESSION_BEGIN_INFO};
-                    begin_info.primaryViewConfigurationType = app_config_view;
-                    xrBeginSession(xr_session, &begin_info);
-                    xr_running = true;
-                    break;
-                case XR_SESSION_STATE_STOPPING:
-                    info("XR_SESSION_STATE_STOPPING");
-                    xr_running = false;
-                    xrEndSession(xr_session);
-                    break;
-                case XR_SESSION_STATE_EXITING:
-                    info("XR_SESSION_STATE_EXITING");
-                    //exit = true;
-                    break;
-                case XR_SESSION_STATE_LOSS_PENDING:
-                    info("XR_SESSION_STATE_LOSS_PENDING");
-                    //exit = true;
-                    break;
-                default:
-                    info("DEFAULT");
-                    break;
-            }
-        } else if (event_buffer.type == XR_TYPE_EVENT_DATA_INSTANCE_LOSS_PENDING) {
-            info("XR_TYPE_EVENT_DATA_INSTANCE_LOSS_PENDING");
-        }
-
-        event_buffer = (XrEventDataBuffer) { XR_TYPE_EVENT_DATA_BUFFER };
-    }
-}
-
 PFN_xrDebugUtilsMessengerCallbackEXT openxr_debug_message(XrDebugUtilsMessageSeverityFlagsEXT severity,
                                                           XrDebugUtilsMessageTypeFlagsEXT types,
                                                           const XrDebugUtilsMessengerCallbackDataEXT* msg,
                                                           void* userData) {
-    info("%s: %s\n", msg->functionName, msg->message);
+    log_write(LOG_CATEGORY_XR, LOG_PRIORITY_VERBOSE, "%s: %s", msg->functionName, msg->message);
     return XR_FALSE;
 }
 
+static void openxr_detect_extension(const char* name) {
+    if (strcmp(name, XR_FB_FOVEATION_EXTENSION_NAME) == 0) {
+        xr_ext.fb_foveation = true;
+    } else if (strcmp(name, XR_FB_FOVEATION_CONFIGURATION_EXTENSION_NAME) == 0) {
+        xr_ext.fb_foveation_configuration = true;
+    } else if (strcmp(name, XR_FB_SWAPCHAIN_UPDATE_STATE_EXTENSION_NAME) == 0) {
+        xr_ext.fb_swapchain_update_state = true;
+    } else if (strcmp(name, XR_FB_SPACE_WARP_EXTENSION_NAME) == 0) {
+        xr_ext.fb_space_warp = true;
+    } else if (strcmp(name, XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME) == 0) {
+        xr_ext.khr_composition_layer_depth = true;
+    } else if (strcmp(name, XR_FB_DISPLAY_REFRESH_RATE_EXTENSION_NAME) == 0) {
+        xr_ext.fb_display_refresh_rate = true;
+    } else if (strcmp(name, XR_EXT_PERFORMANCE_SETTINGS_EXTENSION_NAME) == 0) {
+        xr_ext.ext_performance_settings = true;
+    }
+}
+
 void openxr_init(struct android_app *android_app, struct app *app) {
     PFN_xrInitializeLoaderKHR initializeLoader = NULL;
     XRCMD(xrGetInstanceProcAddr(XR_NULL_HANDLE, "xrInitializeLoaderKHR", (PFN_xrVoidFunction*)(&initializeLoader)));
@@ -777,11 +960,18 @@ void openxr_init(struct android_app *android_app, struct app *app) {
     loaderInitInfoAndroid.applicationContext = android_app->activity->clazz;
     initializeLoader((const XrLoaderInitInfoBaseHeaderKHR*)&loaderInitInfoAndroid);
 
+    // enumeration results are only needed until the instance exists
+    struct arena* arena = &app->persistent;
+    size_t arena_mark_instance = arena_mark(arena);
+
     uint32_t apilayer_count = 0;
     xrEnumerateApiLayerProperties(0, &apilayer_count, NULL);
     info("api layers %u", apilayer_count);
 
-    XrApiLayerProperties apilayer_properties[apilayer_count];
+    XrApiLayerProperties* apilayer_properties = arena_push_array(arena, XrApiLayerProperties, apilayer_count);
+    for (int i = 0; i < apilayer_count; i++) {
+        apilayer_properties[i].type = XR_TYPE_API_LAYER_PROPERTIES;
+    }
     xrEnumerateApiLayerProperties(apilayer_count, &apilayer_count, &apilayer_properties[0]);
     for (int i = 0; i < apilayer_count; i++) {
         XrApiLayerProperties *apilayer_prop = &apilayer_properties[i];
@@ -790,8 +980,8 @@ void openxr_init(struct android_app *android_app, struct app *app) {
 
     uint32_t ext_count = 0;
     xrEnumerateInstanceExtensionProperties(NULL, 0, &ext_count, NULL);
-    XrExtensionProperties exts[ext_count];
-    char *ext_names[ext_count];
+    XrExtensionProperties* exts = arena_push_array(arena, XrExtensionProperties, ext_count);
+    const char** ext_names = arena_push_array(arena, const char*, ext_count);
     for (int i = 0; i < ext_count; i++) {
         XrExtensionProperties* ext_prop = &exts[i];
         ext_prop->type = XR_TYPE_EXTENSION_PROPERTIES;
@@ -805,6 +995,7 @@ void openxr_init(struct android_app *android_app, struct app *app) {
     for (size_t i = 0; i < ext_count; i++) {
         info("- %s\n", exts[i].extensionName);
         ext_names[i] = exts[i].extensionName;
+        openxr_detect_extension(exts[i].extensionName);
     }
 
     XrInstanceCreateInfoAndroidKHR createInfoAndroid = { XR_TYPE_INSTANCE_CREATE_INFO_ANDROID_KHR };
@@ -818,9 +1009,24 @@ void openxr_init(struct android_app *android_app, struct app *app) {
     createInfo.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
     strcpy(createInfo.applicationInfo.applicationName, "hello_quest_openxr");
     XRCMD(xrCreateInstance(&createInfo, &xr_instance));
+    resources_track(RESOURCE_XR_INSTANCE, RESOURCE_HANDLE(xr_instance), 0, "openxr");
+    arena_rewind(arena, arena_mark_instance);
 
     XRCMD(xrGetInstanceProcAddr(xr_instance, "xrGetOpenGLESGraphicsRequirementsKHR", (PFN_xrVoidFunction *)(&ext_xrGetOpenGLESGraphicsRequirementsKHR)));
     XRCMD(xrGetInstanceProcAddr(xr_instance, "xrCreateDebugUtilsMessengerEXT", (PFN_xrVoidFunction *)(&ext_xrCreateDebugUtilsMessengerEXT)));
+    if (xr_ext.fb_foveation && xr_ext.fb_foveation_configuration && xr_ext.fb_swapchain_update_state) {
+        XRCMD(xrGetInstanceProcAddr(xr_instance, "xrCreateFoveationProfileFB", (PFN_xrVoidFunction *)(&ext_xrCreateFoveationProfileFB)));
+        XRCMD(xrGetInstanceProcAddr(xr_instance, "xrDestroyFoveationProfileFB", (PFN_xrVoidFunction *)(&ext_xrDestroyFoveationProfileFB)));
+        XRCMD(xrGetInstanceProcAddr(xr_instance, "xrUpdateSwapchainFB", (PFN_xrVoidFunction *)(&ext_xrUpdateSwapchainFB)));
+    }
+    if (xr_ext.fb_display_refresh_rate) {
+        XRCMD(xrGetInstanceProcAddr(xr_instance, "xrEnumerateDisplayRefreshRatesFB", (PFN_xrVoidFunction *)(&ext_xrEnumerateDisplayRefreshRatesFB)));
+        XRCMD(xrGetInstanceProcAddr(xr_instance, "xrGetDisplayRefreshRateFB", (PFN_xrVoidFunction *)(&ext_xrGetDisplayRefreshRateFB)));
+        XRCMD(xrGetInstanceProcAddr(xr_instance, "xrRequestDisplayRefreshRateFB", (PFN_xrVoidFunction *)(&ext_xrRequestDisplayRefreshRateFB)));
+    }
+    if (xr_ext.ext_performance_settings) {
+        XRCMD(xrGetInstanceProcAddr(xr_instance, "xrPerfSettingsSetPerformanceLevelEXT", (PFN_xrVoidFunction *)(&ext_xrPerfSettingsSetPerformanceLevelEXT)));
+    }
 
     XrDebugUtilsMessengerCreateInfoEXT debug_info = { XR_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT };
     debug_info.messageTypes =
@@ -838,6 +1044,7 @@ void openxr_init(struct android_app *android_app, struct app *app) {
     if (ext_xrCreateDebugUtilsMessengerEXT) {
         info("openxr debug messenger ON");
         ext_xrCreateDebugUtilsMessengerEXT(xr_instance, &debug_info, &xr_debug);
+        resources_track(RESOURCE_XR_DEBUG_MESSENGER, RESOURCE_HANDLE(xr_debug), 0, "openxr");
     } else {
         info("openxr debug messenger OFF");
     }
@@ -862,59 +1069,272 @@ void openxr_init(struct android_app *android_app, struct app *app) {
     session_info.next = &binding;
     session_info.systemId = xr_system_id;
     XRCMD(xrCreateSession(xr_instance, &session_info, &xr_session));
+    resources_track(RESOURCE_XR_SESSION, RESOURCE_HANDLE(xr_session), 0, "openxr");
 
     XrReferenceSpaceCreateInfo ref_space = { XR_TYPE_REFERENCE_SPACE_CREATE_INFO };
     ref_space.poseInReferenceSpace = xr_pose_identity;
     ref_space.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_LOCAL;
     XRCMD(xrCreateReferenceSpace(xr_session, &ref_space, &xr_app_space));
+    resources_track(RESOURCE_XR_SPACE, RESOURCE_HANDLE(xr_app_space), 0, "openxr");
 
-    uint32_t view_count = 0;
-    XRCMD(xrEnumerateViewConfigurationViews(xr_instance, xr_system_id, app_config_view, VIEW_COUNT, &view_count, &view_configs[0]));
-
+    size_t arena_mark_formats = arena_mark(arena);
     uint32_t swapchain_format_count;
     XRCMD(xrEnumerateSwapchainFormats(xr_session, 0, &swapchain_format_count, NULL));
-    int64_t swapchain_formats[swapchain_format_count];
+    int64_t* swapchain_formats = arena_push_array(arena, int64_t, swapchain_format_count);
     XRCMD(xrEnumerateSwapchainFormats(xr_session, swapchain_format_count, &swapchain_format_count,
                                       &swapchain_formats[0]));
     info("num swapchain formats %i", swapchain_format_count);
+    arena_rewind(arena, arena_mark_formats);
 
     // openxr swapchain formats are in order of priority but we will be explicit=
-    GLint swapchain_format = GL_RGBA8;
+    xr_swapchain_format = GL_RGBA8;
+}
+
+static const char* FRAMEBUFFER_OWNER = "framebuffer";
+
+static struct swapchain_params framebuffer_params(const XrViewConfigurationView* view) {
+    struct swapchain_params params;
+    params.format = xr_swapchain_format;
+    params.width = (uint32_t)(view->recommendedImageRectWidth * DRS_MAX_SCALE);
+    params.height = (uint32_t)(view->recommendedImageRectHeight * DRS_MAX_SCALE);
+    if (params.width > view->maxImageRectWidth) {
+        params.width = view->maxImageRectWidth;
+    }
+    if (params.height > view->maxImageRectHeight) {
+        params.height = view->maxImageRectHeight;
+    }
+    params.sample_count = view->recommendedSwapchainSampleCount;
+    return params;
+}
+
+static bool foveation_property(XrFoveationLevelFB* level, XrFoveationDynamicFB* dynamic) {
+    char value[PROP_VALUE_MAX];
+    if (__system_property_get(FOVEATION_PROPERTY, value) <= 0) {
+        return false;
+    }
+    if (!foveation_parse(value, level, dynamic)) {
+        error("foveation: can't parse %s \"%s\"", FOVEATION_PROPERTY, value);
+        return false;
+    }
+    return true;
+}
+
+static void foveation_start(struct app* app) {
+    XrFoveationLevelFB level = FOVEATION_LEVEL;
+    XrFoveationDynamicFB dynamic = FOVEATION_DYNAMIC;
+    foveation_property(&level, &dynamic);
+    foveation_init(&app->foveation, level, dynamic, ext_xrCreateFoveationProfileFB,
+                   ext_xrDestroyFoveationProfileFB, ext_xrUpdateSwapchainFB);
+    app->foveation_poll_time = time_ns();
+}
+
+// Picks up changes of the property; swapchains are updated in place.
+static void foveation_update(struct app* app) {
+    int64_t now = time_ns();
+    if (now - app->foveation_poll_time < FOVEATION_POLL_INTERVAL_NS) {
+        return;
+    }
+    app->foveation_poll_time = now;
+    XrFoveationLevelFB level = app->foveation.level;
+    XrFoveationDynamicFB dynamic = app->foveation.dynamic;
+    if (!foveation_property(&level, &dynamic) ||
+        (level == app->foveation.level && dynamic == app->foveation.dynamic)) {
+        return;
+    }
+    info("foveation: level %d, dynamic %d", level, dynamic);
+    app->foveation.level = level;
+    app->foveation.dynamic = dynamic;
+    for (int i = 0; i < VIEW_COUNT; i++) {
+        if (app->framebuffers[i].swapchain != XR_NULL_HANDLE) {
+            foveation_apply(&app->foveation, xr_session, app->framebuffers[i].swapchain);
+        }
+    }
+}
+
+static void space_warp_init(struct space_warp* space_warp) {
+    *space_warp = (struct space_warp) { 0 };
+    char value[PROP_VALUE_MAX];
+    if (__system_property_get(SPACE_WARP_PROPERTY, value) > 0 && strcmp(value, "0") == 0) {
+        info("space warp off, disabled by %s", SPACE_WARP_PROPERTY);
+        return;
+    }
+    if (!xr_ext.fb_space_warp) {
+        info("space warp off");
+        return;
+    }
+    XrSystemSpaceWarpPropertiesFB space_warp_properties = { XR_TYPE_SYSTEM_SPACE_WARP_PROPERTIES_FB };
+    XrSystemProperties system_properties = { XR_TYPE_SYSTEM_PROPERTIES };
+    system_properties.next = &space_warp_properties;
+    XRCMD(xrGetSystemProperties(xr_instance, xr_system_id, &system_properties));
+    space_warp->width = space_warp_properties.recommendedMotionVectorImageRectWidth;
+    space_warp->height = space_warp_properties.recommendedMotionVectorImageRectHeight;
+    if (space_warp->width == 0 || space_warp->height == 0) {
+        info("space warp off, no recommended motion vector size");
+        return;
+    }
+    space_warp->enabled = true;
+    info("space warp on, motion vectors (%u %u)", space_warp->width, space_warp->height);
+}
+
+static XrSwapchain space_warp_create_swapchain(const struct space_warp* space_warp, struct arena* arena,
+                                               int64_t format, XrSwapchainUsageFlags usage, uint32_t bytes_per_pixel,
+                                               XrSwapchainImageOpenGLESKHR** images) {
+    XrSwapchainCreateInfo swapchain_info = { XR_TYPE_SWAPCHAIN_CREATE_INFO };
+    swapchain_info.arraySize = 1;
+    swapchain_info.mipCount = 1;
+    swapchain_info.faceCount = 1;
+    swapchain_info.format = format;
+    swapchain_info.width = space_warp->width;
+    swapchain_info.height = space_warp->height;
+    swapchain_info.sampleCount = 1;
+    swapchain_info.usageFlags = XR_SWAPCHAIN_USAGE_SAMPLED_BIT | usage;
+    XrSwapchain swapchain;
+    XRCMD(xrCreateSwapchain(xr_session, &swapchain_info, &swapchain));
+
+    uint32_t length = 0;
+    XRCMD(xrEnumerateSwapchainImages(swapchain, 0, &length, NULL));
+    resources_track(RESOURCE_XR_SWAPCHAIN, RESOURCE_HANDLE(swapchain),
+                    (uint64_t)length * swapchain_info.width * swapchain_info.height * bytes_per_pixel,
+                    FRAMEBUFFER_OWNER);
+    *images = arena_push_array(arena, XrSwapchainImageOpenGLESKHR, length);
+    for (uint32_t i = 0; i < length; i++) {
+        (*images)[i] = (XrSwapchainImageOpenGLESKHR) { XR_TYPE_SWAPCHAIN_IMAGE_OPENGL_ES_KHR };
+    }
+    XRCMD(xrEnumerateSwapchainImages(swapchain, length, &length, (XrSwapchainImageBaseHeader*)*images));
+    return swapchain;
+}
+
+static void framebuffer_create_motion(const struct space_warp* space_warp, struct arena* arena,
+                                      struct framebuffer* framebuffer) {
+    info("create motion vector swapchains (%u %u)", space_warp->width, space_warp->height);
+    framebuffer->motion_swapchain = space_warp_create_swapchain(
+            space_warp, arena, SPACE_WARP_MOTION_FORMAT, XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT, 8,
+            &framebuffer->motion_images);
+    framebuffer->motion_depth_swapchain = space_warp_create_swapchain(
+            space_warp, arena, SPACE_WARP_DEPTH_FORMAT, XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 4,
+            &framebuffer->motion_depth_images);
+    // the two swapchains advance independently, so their images are attached per frame
+    GL(glGenFramebuffers(1, &framebuffer->motion_framebuffer));
+    resources_track(RESOURCE_GL_FRAMEBUFFER, framebuffer->motion_framebuffer, 0, FRAMEBUFFER_OWNER);
+}
+
+static void framebuffer_create_depth_swapchain(struct arena* arena, const XrSwapchainCreateInfo* color_info,
+                                               struct framebuffer* framebuffer) {
+    XrSwapchainCreateInfo swapchain_info = *color_info;
+    swapchain_info.next = NULL;
+    swapchain_info.format = DEPTH_FORMAT;
+    swapchain_info.usageFlags = XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    XRCMD(xrCreateSwapchain(xr_session, &swapchain_info, &framebuffer->depth_swapchain));
+
+    uint32_t length = 0;
+    XRCMD(xrEnumerateSwapchainImages(framebuffer->depth_swapchain, 0, &length, NULL));
+    if (length < (uint32_t)framebuffer->swapchain_length) {
+        error("depth swapchain shorter than color swapchain (%u < %d)", length, framebuffer->swapchain_length);
+        exit(EXIT_FAILURE);
+    }
+    info("create depth swapchain, length %u", length);
+    resources_track(RESOURCE_XR_SWAPCHAIN, RESOURCE_HANDLE(framebuffer->depth_swapchain),
+                    (uint64_t)length * swapchain_info.width * swapchain_info.height * 4 * swapchain_info.sampleCount,
+                    FRAMEBUFFER_OWNER);
+    framebuffer->depth_swapchain_images = arena_push_array(arena, XrSwapchainImageOpenGLESKHR, length);
+    for (uint32_t i = 0; i < length; i++) {
+        framebuffer->depth_swapchain_images[i] = (XrSwapchainImageOpenGLESKHR) { XR_TYPE_SWAPCHAIN_IMAGE_OPENGL_ES_KHR };
+    }
+    XRCMD(xrEnumerateSwapchainImages(framebuffer->depth_swapchain, length, &length,
+                                     (XrSwapchainImageBaseHeader*)framebuffer->depth_swapchain_images));
+}
+
+static void framebuffer_create_periphery(struct framebuffer* framebuffer) {
+    framebuffer->periphery_width = (int)(framebuffer->width * FOVEATION_FALLBACK_MAX_SCALE);
+    framebuffer->periphery_height = (int)(framebuffer->height * FOVEATION_FALLBACK_MAX_SCALE);
+    info("create periphery target (%d %d)", framebuffer->periphery_width, framebuffer->periphery_height);
+
+    GLuint textures[2];
+    GL(glGenTextures(2, textures));
+    GL(glBindTexture(GL_TEXTURE_2D, textures[0]));
+    GL(glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, framebuffer->periphery_width, framebuffer->periphery_height));
+    GL(glBindTexture(GL_TEXTURE_2D, textures[1]));
+    // the format of the target's depth, so it can be blitted over
+    GL(glTexStorage2D(GL_TEXTURE_2D, 1, DEPTH_FORMAT, framebuffer->periphery_width, framebuffer->periphery_height));
+    GL(glBindTexture(GL_TEXTURE_2D, 0));
+    uint64_t bytes = (uint64_t)framebuffer->periphery_width * framebuffer->periphery_height * 4;
+    resources_track(RESOURCE_GL_TEXTURE, textures[0], bytes, FRAMEBUFFER_OWNER);
+    resources_track(RESOURCE_GL_TEXTURE, textures[1], bytes, FRAMEBUFFER_OWNER);
+
+    GL(glGenFramebuffers(1, &framebuffer->periphery_framebuffer));
+    resources_track(RESOURCE_GL_FRAMEBUFFER, framebuffer->periphery_framebuffer, 0, FRAMEBUFFER_OWNER);
+    GL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer->periphery_framebuffer));
+    GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[0], 0));
+    GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[1], 0));
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        error("can't create periphery framebuffer, %s", gl_get_framebuffer_status_string(status));
+        exit(EXIT_FAILURE);
+    }
+    GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+}
+
+static bool swapchain_params_equal(const struct swapchain_params* a, const struct swapchain_params* b) {
+    return a->format == b->format && a->width == b->width && a->height == b->height &&
+           a->sample_count == b->sample_count;
+}
+
+static void framebuffers_create(struct app* app) {
+    struct arena* arena = &app->swapchain_arena;
+    arena_reset(arena);
 
     for (int i = 0; i < VIEW_COUNT; i++) {
         XrViewConfigurationView view = view_configs[i];
-        info("make view %i (%u %u)", i, view.recommendedImageRectWidth, view.recommendedImageRectHeight);
+        struct swapchain_params params = framebuffer_params(&view);
+        info("make view %i (%u %u)", i, params.width, params.height);
 
         XrSwapchainCreateInfo swapchain_info = { XR_TYPE_SWAPCHAIN_CREATE_INFO };
         XrSwapchain swapchain;
         swapchain_info.arraySize = 1;
         swapchain_info.mipCount = 1;
         swapchain_info.faceCount = 1;
-        swapchain_info.format = swapchain_format;
-        swapchain_info.width = view.recommendedImageRectWidth;
-        swapchain_info.height = view.recommendedImageRectHeight;
-        swapchain_info.sampleCount = view.recommendedSwapchainSampleCount;
+        swapchain_info.format = params.format;
+        swapchain_info.width = params.width;
+        swapchain_info.height = params.height;
+        swapchain_info.sampleCount = params.sample_count;
         swapchain_info.usageFlags = XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+        XrSwapchainCreateInfoFoveationFB foveation_info = { XR_TYPE_SWAPCHAIN_CREATE_INFO_FOVEATION_FB };
+        if (app->foveation.runtime) {
+            foveation_info.flags = XR_SWAPCHAIN_CREATE_FOVEATION_SCALED_BIN_BIT_FB;
+            swapchain_info.next = &foveation_info;
+        }
         XRCMD(xrCreateSwapchain(xr_session, &swapchain_info, &swapchain));
-        info("create swapchain (sample count %i)", view.recommendedSwapchainSampleCount);
+        info("create swapchain (sample count %i)", params.sample_count);
 
         uint32_t swapchain_length = 0;
         XRCMD(xrEnumerateSwapchainImages(swapchain, 0, &swapchain_length, NULL));
         info("swapchain length %i", swapchain_length);
+        resources_track(RESOURCE_XR_SWAPCHAIN, RESOURCE_HANDLE(swapchain),
+                        (uint64_t)swapchain_length * swapchain_info.width * swapchain_info.height * 4 *
+                        swapchain_info.sampleCount, FRAMEBUFFER_OWNER);
 
         struct framebuffer framebuffer = {};
         framebuffer.swapchain = swapchain;
+        framebuffer.params = params;
         framebuffer.swapchain_length = swapchain_length;
         framebuffer.width = swapchain_info.width;
         framebuffer.height = swapchain_info.height;
+        framebuffer.recommended_width = view.recommendedImageRectWidth;
+        framebuffer.recommended_height = view.recommendedImageRectHeight;
 
-        framebuffer.color_texture_swap_chain = malloc(sizeof(XrSwapchainImageOpenGLESKHR) * swapchain_length);
+        framebuffer.color_texture_swap_chain = arena_push_array(arena, XrSwapchainImageOpenGLESKHR, swapchain_length);
         for (int j = 0; j < swapchain_length; j++) {
             framebuffer.color_texture_swap_chain[j] = (XrSwapchainImageOpenGLESKHR) { XR_TYPE_SWAPCHAIN_IMAGE_OPENGL_ES_KHR };
         }
         XRCMD(xrEnumerateSwapchainImages(swapchain, swapchain_length, &swapchain_length, (XrSwapchainImageBaseHeader*)framebuffer.color_texture_swap_chain));
 
-        framebuffer.framebuffers = malloc(framebuffer.swapchain_length * sizeof(GLuint));
+        if (xr_ext.khr_composition_layer_depth) {
+            framebuffer_create_depth_swapchain(arena, &swapchain_info, &framebuffer);
+        }
+
+        framebuffer.depth_textures = arena_push_array(arena, GLuint, framebuffer.swapchain_length);
+        framebuffer.framebuffers = arena_push_array(arena, GLuint, framebuffer.swapchain_length);
+        framebuffer.framebuffer_depth = arena_push_array(arena, uint32_t, framebuffer.swapchain_length);
         GL(glGenFramebuffers(framebuffer.swapchain_length, framebuffer.framebuffers));
         for (int i = 0; i < framebuffer.swapchain_length; ++i) {
             GLuint color_texture = framebuffer.color_texture_swap_chain[i].image;
@@ -926,17 +1346,27 @@ void openxr_init(struct android_app *android_app, struct app *app) {
             GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
             GL(glBindTexture(GL_TEXTURE_2D, 0));
 
-            info("create depth texture %d", i);
             GLuint depth_texture;
-            GL(glGenTextures(1, &depth_texture));
-            GL(glBindTexture(GL_TEXTURE_2D, depth_texture));
-            GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
-            GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
-            GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-            GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-            GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, framebuffer.width, framebuffer.height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 0));
+            if (framebuffer.depth_swapchain != XR_NULL_HANDLE) {
+                // starts out paired with the color image of the same index
+                depth_texture = framebuffer.depth_swapchain_images[i].image;
+            } else {
+                info("create depth texture %d", i);
+                GL(glGenTextures(1, &depth_texture));
+                GL(glBindTexture(GL_TEXTURE_2D, depth_texture));
+                GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+                GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+                GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+                GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+                GL(glTexImage2D(GL_TEXTURE_2D, 0, DEPTH_FORMAT, framebuffer.width, framebuffer.height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 0));
+                resources_track(RESOURCE_GL_TEXTURE, depth_texture, (uint64_t)framebuffer.width * framebuffer.height * 4,
+                                FRAMEBUFFER_OWNER);
+            }
+            framebuffer.depth_textures[i] = depth_texture;
+            framebuffer.framebuffer_depth[i] = i;
 
             info("create framebuffer %d", i);
+            resources_track(RESOURCE_GL_FRAMEBUFFER, framebuffer.framebuffers[i], 0, FRAMEBUFFER_OWNER);
             GL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.framebuffers[i]));
             GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_texture, 0));
             GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth_texture, 0));
@@ -948,24 +1378,406 @@ void openxr_init(struct android_app *android_app, struct app *app) {
             GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
         }
 
+        if (app->foveation.runtime) {
+            foveation_apply(&app->foveation, xr_session, framebuffer.swapchain);
+        } else if (params.sample_count == 1) {
+            // glBlitFramebuffer can't upscale into a multisampled target
+            framebuffer_create_periphery(&framebuffer);
+        }
+        if (app->space_warp.enabled) {
+            framebuffer_create_motion(&app->space_warp, arena, &framebuffer);
+        }
+
         app->framebuffers[i] = framebuffer;
     }
 }
 
-static void framebuffer_destroy(struct framebuffer* framebuffer) {
+static void framebuffers_destroy(struct app* app) {
     info("destroy framebuffers");
-    glDeleteFramebuffers(framebuffer->swapchain_length,
-                         framebuffer->framebuffers);
+    resources_release_owner(FRAMEBUFFER_OWNER);
+    memset(app->framebuffers, 0, sizeof(app->framebuffers));
+}
+
+// Recreate the swapchains only if the runtime now recommends something
+// different from what we have; otherwise everything is reused as is.
+static void framebuffers_ensure(struct app* app) {
+    uint32_t view_count = 0;
+    for (int i = 0; i < VIEW_COUNT; i++) {
+        view_configs[i] = (XrViewConfigurationView) { XR_TYPE_VIEW_CONFIGURATION_VIEW };
+    }
+    XRCMD(xrEnumerateViewConfigurationViews(xr_instance, xr_system_id, app_config_view, VIEW_COUNT, &view_count, &view_configs[0]));
+
+    bool changed = false;
+    for (int i = 0; i < VIEW_COUNT; i++) {
+        struct swapchain_params params = framebuffer_params(&view_configs[i]);
+        if (app->framebuffers[i].swapchain == XR_NULL_HANDLE ||
+            !swapchain_params_equal(&params, &app->framebuffers[i].params)) {
+            changed = true;
+        }
+    }
+    if (!changed) {
+        info("swapchain parameters unchanged, keeping swapchains");
+        return;
+    }
+    if (app->framebuffers[0].swapchain != XR_NULL_HANDLE) {
+        app->lifecycle.swapchain_recreations++;
+        framebuffers_destroy(app);
+    }
+    framebuffers_create(app);
+}
+
+static void perf_domain_set(struct perf_domain* domain, uint32_t level, const char* reason) {
+    if (level > domain->thermal_cap) {
+        level = domain->thermal_cap;
+    }
+    domain->raise_frames = 0;
+    domain->lower_frames = 0;
+    if (level == domain->level) {
+        return;
+    }
+    info("%s performance level %d -> %d (%s)", domain->name, PERF_LEVELS[domain->level], PERF_LEVELS[level], reason);
+    domain->level = level;
+    XRCMD(ext_xrPerfSettingsSetPerformanceLevelEXT(xr_session, domain->domain, PERF_LEVELS[level]));
+}
 
-    info("free framebuffers");
-    free(framebuffer->framebuffers);
+static void perf_governor_init(struct perf_governor* governor) {
+    *governor = (struct perf_governor) { 0 };
+    governor->enabled = ext_xrPerfSettingsSetPerformanceLevelEXT != NULL;
+    if (!governor->enabled) {
+        info("performance settings not supported, no clock governor");
+        return;
+    }
+    governor->domains[PERF_DOMAIN_CPU].domain = XR_PERF_SETTINGS_DOMAIN_CPU_EXT;
+    governor->domains[PERF_DOMAIN_CPU].name = "cpu";
+    governor->domains[PERF_DOMAIN_GPU].domain = XR_PERF_SETTINGS_DOMAIN_GPU_EXT;
+    governor->domains[PERF_DOMAIN_GPU].name = "gpu";
+    for (int i = 0; i < PERF_DOMAIN_END; i++) {
+        struct perf_domain* domain = &governor->domains[i];
+        domain->thermal_cap = PERF_LEVEL_COUNT - 1;
+        domain->level = PERF_LEVEL_INITIAL;
+        XRCMD(ext_xrPerfSettingsSetPerformanceLevelEXT(xr_session, domain->domain, PERF_LEVELS[domain->level]));
+    }
 }
 
-void gl_render(struct app *app, struct framebuffer *framebuffer, XrCompositionLayerProjectionView layer_view,
-               uint32_t swapchain_image_index) {
+static void perf_governor_notify(struct perf_governor* governor, const XrEventDataPerfSettingsEXT* event) {
+    info("perf settings notification: domain %d, sub domain %d, %d -> %d", event->domain, event->subDomain,
+         event->fromLevel, event->toLevel);
+    if (!governor->enabled) {
+        return;
+    }
+    struct perf_domain* domain = &governor->domains[
+            event->domain == XR_PERF_SETTINGS_DOMAIN_CPU_EXT ? PERF_DOMAIN_CPU : PERF_DOMAIN_GPU];
+    switch (event->subDomain) {
+        case XR_PERF_SETTINGS_SUB_DOMAIN_THERMAL_EXT:
+            // back off before the runtime throttles us
+            if (event->toLevel == XR_PERF_SETTINGS_NOTIF_LEVEL_IMPAIRED_EXT) {
+                domain->thermal_cap = 0;
+            } else if (event->toLevel == XR_PERF_SETTINGS_NOTIF_LEVEL_WARNING_EXT) {
+                domain->thermal_cap = PERF_LEVEL_INITIAL;
+            } else {
+                domain->thermal_cap = PERF_LEVEL_COUNT - 1;
+            }
+            perf_domain_set(domain, domain->level, "thermal");
+            break;
+        case XR_PERF_SETTINGS_SUB_DOMAIN_COMPOSITING_EXT:
+        case XR_PERF_SETTINGS_SUB_DOMAIN_RENDERING_EXT:
+            if (event->toLevel != XR_PERF_SETTINGS_NOTIF_LEVEL_NORMAL_EXT && domain->level + 1 < PERF_LEVEL_COUNT) {
+                perf_domain_set(domain, domain->level + 1, "runtime notification");
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void perf_domain_update(struct perf_domain* domain, bool raise, bool lower) {
+    domain->raise_frames = raise ? domain->raise_frames + 1 : 0;
+    domain->lower_frames = lower ? domain->lower_frames + 1 : 0;
+    if (domain->raise_frames >= PERF_RAISE_FRAMES && domain->level + 1 < PERF_LEVEL_COUNT) {
+        perf_domain_set(domain, domain->level + 1, "frame time");
+    } else if (domain->lower_frames >= PERF_LOWER_FRAMES && domain->level > 0) {
+        perf_domain_set(domain, domain->level - 1, "headroom");
+    }
+}
+
+void openxr_poll_events(struct app* app) {
+    TRACE_SCOPE("openxr_poll_events");
+    XrEventDataBuffer event_buffer = { XR_TYPE_EVENT_DATA_BUFFER };
+
+    while (xrPollEvent(xr_instance, &event_buffer) == XR_SUCCESS) {
+        if (event_buffer.type == XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED) {
+            info("XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED");
+            XrEventDataSessionStateChanged *changed = (XrEventDataSessionStateChanged*)&event_buffer;
+            xr_session_state = changed->state;
+            recorder_session_state(&app->recorder, changed->state, changed->time);
+
+            switch (xr_session_state) {
+                case XR_SESSION_STATE_READY:
+                    info("XR_SESSION_STATE_READY");
+                    lifecycle_mark_resume(&app->lifecycle, "session ready");
+                    framebuffers_ensure(app);
+                    XrSessionBeginInfo begin_info = {XR_TYPE_SESSION_BEGIN_INFO};
+                    begin_info.primaryViewConfigurationType = app_config_view;
+                    xrBeginSession(xr_session, &begin_info);
+                    xr_running = true;
+                    app->lifecycle.session_begins++;
+                    break;
+                case XR_SESSION_STATE_STOPPING:
+                    info("XR_SESSION_STATE_STOPPING");
+                    xr_running = false;
+                    xrEndSession(xr_session);
+                    resources_report(false);
+                    break;
+                case XR_SESSION_STATE_EXITING:
+                    info("XR_SESSION_STATE_EXITING");
+                    //exit = true;
+                    break;
+                case XR_SESSION_STATE_LOSS_PENDING:
+                    info("XR_SESSION_STATE_LOSS_PENDING");
+                    //exit = true;
+                    break;
+                default:
+                    info("DEFAULT");
+                    break;
+            }
+        } else if (event_buffer.type == XR_TYPE_EVENT_DATA_DISPLAY_REFRESH_RATE_CHANGED_FB) {
+            XrEventDataDisplayRefreshRateChangedFB *changed = (XrEventDataDisplayRefreshRateChangedFB*)&event_buffer;
+            info("display refresh rate %.0f -> %.0f Hz", changed->fromDisplayRefreshRate, changed->toDisplayRefreshRate);
+            pacing_rate_changed(&app->pacing, changed->toDisplayRefreshRate);
+        } else if (event_buffer.type == XR_TYPE_EVENT_DATA_PERF_SETTINGS_EXT) {
+            perf_governor_notify(&app->governor, (XrEventDataPerfSettingsEXT*)&event_buffer);
+        } else if (event_buffer.type == XR_TYPE_EVENT_DATA_INSTANCE_LOSS_PENDING) {
+            info("XR_TYPE_EVENT_DATA_INSTANCE_LOSS_PENDING");
+        }
+
+        event_buffer = (XrEventDataBuffer) { XR_TYPE_EVENT_DATA_BUFFER };
+    }
+}
+
+// A flat grid facing +z over -1..1 with the requested number of triangles
+// rounded up to a square grid, BENCH_MAX_GRID quads a side at most. The
+// count is updated to what was built; returns the mesh id.
+static uint32_t bench_mesh_create(struct app* app, uint32_t* triangles) {
+    uint32_t grid = (uint32_t)ceilf(sqrtf(*triangles / 2.0f));
+    grid = grid < 1 ? 1 : grid > BENCH_MAX_GRID ? BENCH_MAX_GRID : grid;
+    *triangles = 2 * grid * grid;
+    uint32_t vertex_count = (grid + 1) * (grid + 1);
+    uint32_t index_count = 6 * grid * grid;
+    struct vertex* vertices = arena_alloc(&app->bench.arena, vertex_count * sizeof(struct vertex), 16);
+    uint16_t* indices = arena_alloc(&app->bench.arena, index_count * sizeof(uint16_t), sizeof(uint16_t));
+    for (uint32_t y = 0; y <= grid; y++) {
+        for (uint32_t x = 0; x <= grid; x++) {
+            float u = (float)x / grid;
+            float v = (float)y / grid;
+            vertices[y * (grid + 1) + x] = (struct vertex) { { 2.f * u - 1.f, 2.f * v - 1.f, 0.f },
+                                                             { u, v, 1.f - u } };
+        }
+    }
+    uint16_t* index = indices;
+    for (uint32_t y = 0; y < grid; y++) {
+        for (uint32_t x = 0; x < grid; x++) {
+            uint16_t a = (uint16_t)(y * (grid + 1) + x);
+            uint16_t b = (uint16_t)(a + grid + 1);
+            // counter-clockwise seen from +z
+            *index++ = a;
+            *index++ = (uint16_t)(a + 1);
+            *index++ = (uint16_t)(b + 1);
+            *index++ = (uint16_t)(b + 1);
+            *index++ = b;
+            *index++ = a;
+        }
+    }
+    return geometry_heap_add(&app->geometry, &app->loader, vertices, vertex_count, indices, index_count);
+}
+
+// Tiles BENCH_SCENE_SIZE squares in front of the viewer with the benchmark's
+// objects, one square per overdraw layer, created far to near so every layer
+// passes the depth test over the ones before it.
+static void scene_create_bench(struct app* app) {
+    struct bench_config* config = &app->bench.config;
+    struct entities* entities = &app->entities;
+    uint32_t mesh = bench_mesh_create(app, &config->triangles);
+    if (mesh == GEOMETRY_HEAP_INVALID) {
+        error("no room for the benchmark mesh in the geometry heap");
+        exit(EXIT_FAILURE);
+    }
+    uint32_t room = entities->capacity - entities->count;
+    if (config->objects > room) {
+        info("bench: %u objects asked for, room for %u", config->objects, room);
+        config->objects = room;
+    }
+    uint32_t per_layer = (config->objects + config->overdraw - 1) / config->overdraw;
+    uint32_t grid = (uint32_t)ceilf(sqrtf((float)per_layer));
+    float cell = BENCH_SCENE_SIZE / (grid > 0 ? grid : 1);
+    for (uint32_t i = 0; i < config->objects; i++) {
+        uint32_t layer = i / per_layer;
+        uint32_t slot = i % per_layer;
+        uint32_t index = entity_index(entities, entity_create(entities));
+        entities->positions[index] = (XrVector3f) {
+                -BENCH_SCENE_SIZE / 2 + (slot % grid + 0.5f) * cell,
+                -BENCH_SCENE_SIZE / 2 + (slot / grid + 0.5f) * cell,
+                -BENCH_SCENE_DISTANCE + layer * BENCH_LAYER_SPACING };
+        entities->scales[index] = (XrVector3f) { cell / 2, cell / 2, 1.f };
+        entities->meshes[index] = (uint16_t)mesh;
+        entities->bounds[index].extents = (XrVector3f) { 1.f, 1.f, 0.f };
+    }
+}
+
+static void scene_create(struct app* app) {
+    entities_create(&app->entities, ENTITY_CAPACITY);
+    transforms_create(&app->transforms, TRANSFORM_CAPACITY);
+    struct entities* entities = &app->entities;
+    for (int i = 0; i < VIEW_COUNT; i++) {
+        atomic_init(&app->draw_lists_recorded[i].pending, 0);
+    }
+
+    uint32_t cube = entity_create(entities);
+    uint32_t index = entity_index(entities, cube);
+    entities->positions[index] = (XrVector3f) { 0.f, 0.f, -1.f };
+    entities->meshes[index] = (uint16_t)app->cube_mesh;
+    // the cube mesh spans -1..1
+    entities->scales[index] = (XrVector3f) { CUBE_SCALE, CUBE_SCALE, CUBE_SCALE };
+    entities->bounds[index].extents = (XrVector3f) { 1.f, 1.f, 1.f };
+
+    // a smaller cube circling the first one through the hierarchy
+    XrMatrix4x4f local;
+    app->orbit_node = transforms_add(&app->transforms, TRANSFORM_ROOT);
+    XrMatrix4x4f_CreateTranslation(&local, 0.f, 0.f, -1.f);
+    transforms_set_local(&app->transforms, app->orbit_node, &local);
+    uint32_t moon_node = transforms_add(&app->transforms, app->orbit_node);
+    XrVector3f translation = { 0.25f, 0.f, 0.f };
+    XrQuaternionf rotation = { 0.f, 0.f, 0.f, 1.f };
+    XrVector3f scale = { 0.4f * CUBE_SCALE, 0.4f * CUBE_SCALE, 0.4f * CUBE_SCALE };
+    transforms_set_trs(&app->transforms, moon_node, &translation, &rotation, &scale);
+    uint32_t moon = entity_create(entities);
+    index = entity_index(entities, moon);
+    entities->nodes[index] = moon_node;
+    entities->meshes[index] = (uint16_t)app->cube_mesh;
+    entities->bounds[index].extents = (XrVector3f) { 1.f, 1.f, 1.f };
+
+    if (app->bench.enabled) {
+        scene_create_bench(app);
+    }
+
+    transforms_update(&app->transforms, &app->jobs);
+    entities_update_world(entities, &app->jobs);
+    for (uint32_t i = 0; i < entities->count; i++) {
+        if (entities->nodes[i] != ENTITY_NO_NODE) {
+            entities->world[i] = *transforms_world(&app->transforms, entities->nodes[i]);
+            entities->prev_world[i] = entities->world[i];
+        }
+    }
+}
+
+// Animated by display time rather than the clock, so a replayed session
+// reproduces the same scene.
+static void scene_update(struct app* app, XrTime time) {
+    TRACE_SCOPE("scene_update");
+    struct entities* entities = &app->entities;
+    // in double, then wrapped, so it neither loses precision nor jumps as uptime grows
+    float angle = (float)fmod(ORBIT_SPEED * (time / 1e9), 2.0 * M_PI);
+    XrVector3f translation = { 0.f, 0.f, -1.f };
+    XrQuaternionf rotation = { 0.f, sinf(angle / 2), 0.f, cosf(angle / 2) };
+    XrVector3f scale = { 1.f, 1.f, 1.f };
+    transforms_set_trs(&app->transforms, app->orbit_node, &translation, &rotation, &scale);
+    transforms_update(&app->transforms, &app->jobs);
+    app->loop_stats.transform_updates += app->transforms.stats.updated;
+
+    entities_update_world(entities, &app->jobs);
+    for (uint32_t i = 0; i < entities->count; i++) {
+        if (entities->nodes[i] != ENTITY_NO_NODE) {
+            entities->world[i] = *transforms_world(&app->transforms, entities->nodes[i]);
+        }
+    }
+}
+
+// Cull against each eye and start recording its draw list; gl_render waits
+// for the list of the view it draws.
+static void scene_cull(struct app* app, const XrView* views) {
+    TRACE_SCOPE("scene_cull");
+    XrMatrix4x4f view_projs[VIEW_COUNT];
+    for (int i = 0; i < VIEW_COUNT; i++) {
+        XrMatrix4x4f proj;
+        XrMatrix4x4f_CreateProjectionFov(&proj, views[i].fov, PROJECTION_NEAR_Z, PROJECTION_FAR_Z);
+        XrMatrix4x4f to_view;
+        XrVector3f scale = {1.f, 1.f, 1.f};
+        XrMatrix4x4f_CreateTranslationRotationScale(&to_view, &views[i].pose.position,
+                                                    &views[i].pose.orientation, &scale);
+        XrMatrix4x4f view;
+        XrMatrix4x4f_InvertRigidBody(&view, &to_view);
+        XrMatrix4x4f_Multiply(&view_projs[i], &proj, &view);
+    }
+    struct entities* entities = &app->entities;
+    entities_cull(entities, &app->jobs, view_projs, VIEW_COUNT);
+    for (uint32_t i = 0; i < entities->count; i++) {
+        app->loop_stats.culled += !entities->visible[i];
+    }
+    for (int i = 0; i < VIEW_COUNT; i++) {
+        draw_list_record(&app->draw_lists[i], app->frame_arena.current, entities, i, &view_projs[i], &app->jobs,
+                         &app->draw_lists_recorded[i]);
+    }
+}
+
+static void gl_draw_scene(struct app* app, const struct program* program, const struct draw_list* list,
+                          const XrMatrix4x4f* proj, const XrMatrix4x4f* view) {
+    const struct entities* entities = &app->entities;
+    // a variant only has the uniforms its features use
+    GLint model_location = program->uniform_locations[UNIFORM_MODEL_MATRIX];
+    GLint prev_model_location = program->uniform_locations[UNIFORM_PREV_MODEL_MATRIX];
+    GLint mvp_location = program->uniform_locations[UNIFORM_MVP_MATRIX];
+    GLint prev_mvp_location = program->uniform_locations[UNIFORM_PREV_MVP_MATRIX];
+    GL(glUseProgram(program->program));
+    if (program->uniform_locations[UNIFORM_VIEW_MATRIX] != -1) {
+        GL(glUniformMatrix4fv(
+                program->uniform_locations[UNIFORM_VIEW_MATRIX], 1,
+                GL_FALSE, (const GLfloat*)view));
+        GL(glUniformMatrix4fv(
+                program->uniform_locations[UNIFORM_PROJECTION_MATRIX], 1,
+                GL_FALSE, (const GLfloat*)proj));
+    }
+    GL(geometry_heap_bind(&app->geometry));
+    uint32_t mesh = GEOMETRY_HEAP_INVALID;
+    for (uint32_t s = 0; s < list->segment_count; s++) {
+        const struct draw_cmd* cmd = &list->cmds[list->segments[s].begin];
+        const struct draw_cmd* end = &list->cmds[list->segments[s].end];
+        for (; cmd < end; cmd++) {
+            if (cmd->op == DRAW_OP_MESH) {
+                // meshes still loading are skipped
+                mesh = geometry_heap_ready(&app->geometry, cmd->mesh) ? cmd->mesh : GEOMETRY_HEAP_INVALID;
+                continue;
+            }
+            if (mesh == GEOMETRY_HEAP_INVALID) {
+                continue;
+            }
+            if (mvp_location != -1) {
+                GL(glUniformMatrix4fv(mvp_location, 1, GL_FALSE, (const GLfloat*)&list->mvps[cmd->entity]));
+            }
+            if (prev_mvp_location != -1) {
+                GL(glUniformMatrix4fv(prev_mvp_location, 1, GL_FALSE,
+                                      (const GLfloat*)&list->prev_mvps[cmd->entity]));
+            }
+            if (model_location != -1) {
+                GL(glUniformMatrix4fv(model_location, 1, GL_FALSE, (const GLfloat*)&entities->world[cmd->entity]));
+            }
+            if (prev_model_location != -1) {
+                GL(glUniformMatrix4fv(prev_model_location, 1, GL_FALSE,
+                                      (const GLfloat*)&entities->prev_world[cmd->entity]));
+            }
+            GL(geometry_heap_draw(&app->geometry, mesh));
+            app->draw_calls++;
+        }
+    }
+    GL(glBindVertexArray(0));
+    GL(glUseProgram(0));
+}
+
+void gl_render(struct app *app, struct framebuffer *framebuffer, const struct draw_list* list,
+               XrCompositionLayerProjectionView layer_view, uint32_t swapchain_image_index,
+               uint32_t depth_image_index) {
+    TRACE_SCOPE("gl_render");
     XrPosef pose = layer_view.pose;
     XrMatrix4x4f proj;
-    XrMatrix4x4f_CreateProjectionFov(&proj, layer_view.fov, 0.05f, 100.0f);
+    XrMatrix4x4f_CreateProjectionFov(&proj, layer_view.fov, PROJECTION_NEAR_Z, PROJECTION_FAR_Z);
     XrMatrix4x4f toView;
     XrVector3f scale = {1.f, 1.f, 1.f};
     XrMatrix4x4f_CreateTranslationRotationScale(&toView, &pose.position, &pose.orientation, &scale);
@@ -975,69 +1787,431 @@ void gl_render(struct app *app, struct framebuffer *framebuffer, XrCompositionLa
     XrMatrix4x4f vp;
     XrMatrix4x4f_Multiply(&vp, &proj, &view);
 
-    XrMatrix4x4f model;
-    XrMatrix4x4f_CreateTranslation(&model, 0.f, 0.f, -1.f);
-
-    GL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer->framebuffers[swapchain_image_index]));
+    GLuint target = framebuffer->framebuffers[swapchain_image_index];
+    XrRect2Di rect = layer_view.subImage.imageRect;
+    if (framebuffer->depth_swapchain != XR_NULL_HANDLE &&
+        framebuffer->framebuffer_depth[swapchain_image_index] != depth_image_index) {
+        // the color and depth swapchains drifted apart, re-pair them
+        GL(glBindFramebuffer(GL_FRAMEBUFFER, target));
+        GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                                  framebuffer->depth_swapchain_images[depth_image_index].image, 0));
+        framebuffer->framebuffer_depth[swapchain_image_index] = depth_image_index;
+    }
 
     GL(glEnable(GL_CULL_FACE));
     GL(glEnable(GL_DEPTH_TEST));
     GL(glEnable(GL_SCISSOR_TEST));
-    GL(glViewport(layer_view.subImage.imageRect.offset.x,
-               layer_view.subImage.imageRect.offset.y,
-               layer_view.subImage.imageRect.extent.width,
-               layer_view.subImage.imageRect.extent.height));
-
-    GL(glScissor(0, 0, framebuffer->width, framebuffer->height));
     GL(glClearColor(1.0, 1.0, 1.0, 1.0));
 
-    GL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT));
-    GL(glUseProgram(app->program.program));
-    GL(glUniformMatrix4fv(
-            app->program.uniform_locations[UNIFORM_MODEL_MATRIX], 1,
-            GL_FALSE, (const GLfloat*)&model));
-    GL(glUniformMatrix4fv(
-            app->program.uniform_locations[UNIFORM_VIEW_MATRIX], 1,
-            GL_FALSE, (const GLfloat*)&view));
-    GL(glUniformMatrix4fv(
-            app->program.uniform_locations[UNIFORM_PROJECTION_MATRIX], 1,
-            GL_FALSE, (const GLfloat*)&proj));
-    GL(glBindVertexArray(app->geometry.vertex_array));
-    GL(glDrawElements(GL_TRIANGLES, NUM_INDICES, GL_UNSIGNED_SHORT, NULL));
-    GL(glBindVertexArray(0));
-    GL(glUseProgram(0));
+    struct foveation_fallback fallback = FOVEATION_FALLBACK[app->foveation.level];
+    if (framebuffer->periphery_framebuffer != 0 && fallback.periphery_scale < 1.0f) {
+        // draw the whole view at reduced resolution and upscale it...
+        int periphery_width = (int)(rect.extent.width * fallback.periphery_scale);
+        int periphery_height = (int)(rect.extent.height * fallback.periphery_scale);
+        GL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer->periphery_framebuffer));
+        GL(glViewport(0, 0, periphery_width, periphery_height));
+        GL(glScissor(0, 0, periphery_width, periphery_height));
+        GL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+        gl_draw_scene(app, shaders_get(&app->shaders, SCENE_SHADER_FEATURES), list, &proj, &view);
+        // submitted depth is reprojected by the compositor, so the periphery keeps its own
+        bool keep_depth = framebuffer->depth_swapchain != XR_NULL_HANDLE;
+        if (!keep_depth) {
+            static const GLenum PERIPHERY_ATTACHMENTS[] = { GL_DEPTH_ATTACHMENT };
+            GL(glInvalidateFramebuffer(GL_DRAW_FRAMEBUFFER, 1, PERIPHERY_ATTACHMENTS));
+        }
+
+        GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer->periphery_framebuffer));
+        GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target));
+        GL(glDisable(GL_SCISSOR_TEST));
+        GL(glBlitFramebuffer(0, 0, periphery_width, periphery_height,
+                             rect.offset.x, rect.offset.y,
+                             rect.offset.x + rect.extent.width, rect.offset.y + rect.extent.height,
+                             GL_COLOR_BUFFER_BIT, GL_LINEAR));
+        if (keep_depth) {
+            // depth can only be blitted unfiltered
+            GL(glBlitFramebuffer(0, 0, periphery_width, periphery_height,
+                                 rect.offset.x, rect.offset.y,
+                                 rect.offset.x + rect.extent.width, rect.offset.y + rect.extent.height,
+                                 GL_DEPTH_BUFFER_BIT, GL_NEAREST));
+        }
+        GL(glEnable(GL_SCISSOR_TEST));
+
+        // ...then redraw the center, where the lenses are sharp, at full resolution
+        int inset_width = (int)(rect.extent.width * fallback.inset);
+        int inset_height = (int)(rect.extent.height * fallback.inset);
+        GL(glBindFramebuffer(GL_FRAMEBUFFER, target));
+        GL(glViewport(rect.offset.x, rect.offset.y, rect.extent.width, rect.extent.height));
+        GL(glScissor(rect.offset.x + (rect.extent.width - inset_width) / 2,
+                     rect.offset.y + (rect.extent.height - inset_height) / 2,
+                     inset_width, inset_height));
+        GL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+        gl_draw_scene(app, shaders_get(&app->shaders, SCENE_SHADER_FEATURES), list, &proj, &view);
+    } else {
+        GL(glBindFramebuffer(GL_FRAMEBUFFER, target));
+        GL(glViewport(rect.offset.x, rect.offset.y, rect.extent.width, rect.extent.height));
+        GL(glScissor(rect.offset.x, rect.offset.y, rect.extent.width, rect.extent.height));
+        GL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT));
+        gl_draw_scene(app, shaders_get(&app->shaders, SCENE_SHADER_FEATURES), list, &proj, &view);
+    }
 
     glClearColor(0.0, 0.0, 0.0, 1.0);
-    glScissor(0, 0, 1, framebuffer->height);
+    int x = rect.offset.x;
+    int y = rect.offset.y;
+    int width = rect.extent.width;
+    int height = rect.extent.height;
+    glScissor(x, y, 1, height);
     glClear(GL_COLOR_BUFFER_BIT);
-    glScissor(framebuffer->width - 1, 0, 1, framebuffer->height);
+    glScissor(x + width - 1, y, 1, height);
     glClear(GL_COLOR_BUFFER_BIT);
-    glScissor(0, 0, framebuffer->width, 1);
+    glScissor(x, y, width, 1);
     glClear(GL_COLOR_BUFFER_BIT);
-    glScissor(0, framebuffer->height - 1, framebuffer->width, 1);
+    glScissor(x, y + height - 1, width, 1);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    static const GLenum ATTACHMENTS[] = { GL_DEPTH_ATTACHMENT };
-    static const GLsizei NUM_ATTACHMENTS =
-            sizeof(ATTACHMENTS) / sizeof(ATTACHMENTS[0]);
-    GL(glInvalidateFramebuffer(GL_DRAW_FRAMEBUFFER, NUM_ATTACHMENTS, ATTACHMENTS));
+    // submitted depth has to be resolved for the compositor, private depth doesn't
+    if (framebuffer->depth_swapchain == XR_NULL_HANDLE) {
+        static const GLenum ATTACHMENTS[] = { GL_DEPTH_ATTACHMENT };
+        static const GLsizei NUM_ATTACHMENTS =
+                sizeof(ATTACHMENTS) / sizeof(ATTACHMENTS[0]);
+        GL(glInvalidateFramebuffer(GL_DRAW_FRAMEBUFFER, NUM_ATTACHMENTS, ATTACHMENTS));
+    }
     GL(glFlush());
     GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
 }
 
+static uint32_t swapchain_acquire(XrSwapchain swapchain) {
+    uint32_t index;
+    XrSwapchainImageAcquireInfo acquire_info = { XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO };
+    XRCMD(xrAcquireSwapchainImage(swapchain, &acquire_info, &index));
+    XrSwapchainImageWaitInfo wait_info = { XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO };
+    wait_info.timeout = XR_INFINITE_DURATION;
+    TRACE_BEGIN("xrWaitSwapchainImage");
+    XRCMD(xrWaitSwapchainImage(swapchain, &wait_info));
+    TRACE_END("xrWaitSwapchainImage");
+    return index;
+}
+
+static void swapchain_release(XrSwapchain swapchain) {
+    XrSwapchainImageReleaseInfo release_info = { XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO };
+    XRCMD(xrReleaseSwapchainImage(swapchain, &release_info));
+}
+
+// Render motion vectors and depth for one view and fill in the space warp
+// info that gets chained to its projection view.
+static void gl_render_motion(struct app* app, struct framebuffer* framebuffer, const struct draw_list* list,
+                             const XrCompositionLayerProjectionView* layer_view,
+                             XrCompositionLayerSpaceWarpInfoFB* space_warp_info) {
+    TRACE_SCOPE("gl_render_motion");
+    const struct space_warp* space_warp = &app->space_warp;
+    uint32_t motion_index = swapchain_acquire(framebuffer->motion_swapchain);
+    uint32_t depth_index = swapchain_acquire(framebuffer->motion_depth_swapchain);
+
+    XrMatrix4x4f proj;
+    XrMatrix4x4f_CreateProjectionFov(&proj, layer_view->fov, PROJECTION_NEAR_Z, PROJECTION_FAR_Z);
+    XrMatrix4x4f to_view;
+    XrVector3f scale = {1.f, 1.f, 1.f};
+    XrMatrix4x4f_CreateTranslationRotationScale(&to_view, &layer_view->pose.position,
+                                                &layer_view->pose.orientation, &scale);
+    XrMatrix4x4f view;
+    XrMatrix4x4f_InvertRigidBody(&view, &to_view);
+
+    GL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer->motion_framebuffer));
+    GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                              framebuffer->motion_images[motion_index].image, 0));
+    GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                              framebuffer->motion_depth_images[depth_index].image, 0));
+    GL(glViewport(0, 0, space_warp->width, space_warp->height));
+    GL(glScissor(0, 0, space_warp->width, space_warp->height));
+    GL(glClearColor(0.0, 0.0, 0.0, 0.0));
+    GL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+    gl_draw_scene(app, shaders_get(&app->shaders, SPACE_WARP_SHADER_FEATURES), list, &proj, &view);
+    GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+    swapchain_release(framebuffer->motion_swapchain);
+    swapchain_release(framebuffer->motion_depth_swapchain);
+
+    XrRect2Di rect = { { 0, 0 }, { (int32_t)space_warp->width, (int32_t)space_warp->height } };
+    *space_warp_info = (XrCompositionLayerSpaceWarpInfoFB) { XR_TYPE_COMPOSITION_LAYER_SPACE_WARP_INFO_FB };
+    space_warp_info->motionVectorSubImage.swapchain = framebuffer->motion_swapchain;
+    space_warp_info->motionVectorSubImage.imageRect = rect;
+    space_warp_info->depthSubImage.swapchain = framebuffer->motion_depth_swapchain;
+    space_warp_info->depthSubImage.imageRect = rect;
+    // xr_app_space is a fixed LOCAL space, it never moves under the user
+    space_warp_info->appSpaceDeltaPose = xr_pose_identity;
+    space_warp_info->minDepth = 0.0f;
+    space_warp_info->maxDepth = 1.0f;
+    space_warp_info->nearZ = PROJECTION_NEAR_Z;
+    space_warp_info->farZ = PROJECTION_FAR_Z;
+}
+
+static void dynamic_resolution_init(struct dynamic_resolution* drs) {
+    *drs = (struct dynamic_resolution) { 0 };
+    drs->step = DRS_STEPS_PER_UNIT;
+    drs->scale = 1.0f;
+    drs->report_time = time_ns();
+    gpu_timer_create(&drs->gpu_timer, "dynamic resolution");
+}
+
+static XrRect2Di dynamic_resolution_rect(const struct dynamic_resolution* drs,
+                                         const struct framebuffer* framebuffer) {
+    XrRect2Di rect;
+    rect.extent.width = (int32_t)(framebuffer->recommended_width * drs->scale);
+    rect.extent.height = (int32_t)(framebuffer->recommended_height * drs->scale);
+    if (rect.extent.width > framebuffer->width) {
+        rect.extent.width = framebuffer->width;
+    }
+    if (rect.extent.height > framebuffer->height) {
+        rect.extent.height = framebuffer->height;
+    }
+    rect.offset.x = (framebuffer->width - rect.extent.width) / 2;
+    rect.offset.y = (framebuffer->height - rect.extent.height) / 2;
+    return rect;
+}
+
+static void dynamic_resolution_update(struct dynamic_resolution* drs, float cpu_ms, XrDuration period) {
+    double gpu_ms = 0.0;
+    drs->gpu_collected = false;
+    while (gpu_timer_collect(&drs->gpu_timer, &gpu_ms)) {
+        drs->gpu_ms += DRS_SMOOTHING * ((float)gpu_ms - drs->gpu_ms);
+        drs->gpu_collected = true;
+        drs->gpu_last_ms = (float)gpu_ms;
+    }
+    drs->cpu_ms += DRS_SMOOTHING * (cpu_ms - drs->cpu_ms);
+    if (period <= 0 || drs->fixed) {
+        return;
+    }
+
+    // pixel cost grows with the square of the scale, the controller works on load
+    float period_ms = period / 1e6f;
+    float load = fmaxf(drs->cpu_ms, drs->gpu_ms) / period_ms;
+    float error = DRS_TARGET_LOAD - load;
+    drs->integral = fminf(fmaxf(drs->integral + error, -1.0f), 1.0f);
+    float output = DRS_KP * error + DRS_KI * drs->integral + DRS_KD * (error - drs->prev_error);
+    drs->prev_error = error;
+
+    int target = (int)lroundf(drs->scale * (1.0f + output) * DRS_STEPS_PER_UNIT);
+    target = target < DRS_MIN_STEP ? DRS_MIN_STEP : target > DRS_MAX_STEP ? DRS_MAX_STEP : target;
+
+    if (target < drs->step) {
+        drs->hold = 0;
+    } else if (target > drs->step && ++drs->hold >= DRS_HOLD_FRAMES) {
+        drs->hold = 0;
+        // step up one notch at a time, dropping back is immediate anyway
+        target = drs->step + 1;
+    } else {
+        if (target == drs->step) {
+            drs->hold = 0;
+        }
+        target = drs->step;
+    }
+    if (target != drs->step) {
+        drs->step = target;
+        drs->scale = (float)target / DRS_STEPS_PER_UNIT;
+        drs->changes++;
+    }
+
+    int64_t now = time_ns();
+    if (now - drs->report_time >= LOOP_STATS_INTERVAL_NS) {
+        info("resolution scale %.2f (cpu %.2f ms, gpu %.2f ms%s, period %.2f ms, %u changes)",
+             drs->scale, drs->cpu_ms, drs->gpu_ms, drs->gpu_timer.supported ? "" : " n/a",
+             period_ms, drs->changes);
+        drs->report_time = now;
+        drs->changes = 0;
+    }
+}
+
+static void refresh_rate_init(struct app* app) {
+    struct arena* arena = &app->persistent;
+    size_t arena_mark_rates = arena_mark(arena);
+    float* rates = NULL;
+    uint32_t rate_count = 0;
+    float current = 0.0f;
+    if (ext_xrEnumerateDisplayRefreshRatesFB != NULL) {
+        XRCMD(ext_xrEnumerateDisplayRefreshRatesFB(xr_session, 0, &rate_count, NULL));
+        // the runtime wants room for all of them; pacing keeps the first PACING_MAX_RATES
+        rates = arena_push_array(arena, float, rate_count);
+        XrResult result = ext_xrEnumerateDisplayRefreshRatesFB(xr_session, rate_count, &rate_count, rates);
+        if (!XR_SUCCEEDED(result)) {
+            error("xrEnumerateDisplayRefreshRatesFB failed: %i", result);
+            rate_count = 0;
+        }
+        XRCMD(ext_xrGetDisplayRefreshRateFB(xr_session, &current));
+    }
+    pacing_init(&app->pacing, rates, rate_count, current, app->space_warp.enabled ? 2 : 1);
+    arena_rewind(arena, arena_mark_rates);
+    for (uint32_t i = 0; i < app->pacing.rate_count; i++) {
+        info("display refresh rate %.0f Hz%s", app->pacing.rates[i], i == app->pacing.current ? " (current)" : "");
+    }
+}
+
+static bool refresh_rate_update(struct app* app, const XrFrameState* frame_state, float cpu_ms) {
+    bool missed = pacing_missed(&app->pacing, app->last_display_time, frame_state->predictedDisplayTime,
+                                frame_state->predictedDisplayPeriod);
+    app->last_display_time = frame_state->predictedDisplayTime;
+
+    // judge by the GPU cost at full resolution, not whatever dynamic resolution settled on
+    if (bench_running(&app->bench)) {
+        return missed;
+    }
+    float scale = app->resolution.scale;
+    float frame_ms = fmaxf(cpu_ms, app->resolution.gpu_ms / (scale * scale));
+    float rate;
+    if (pacing_update(&app->pacing, frame_ms, missed, &rate)) {
+        info("request display refresh rate %.0f Hz (frame %.2f ms)", rate, app->pacing.frame_ms);
+        XRCMD(ext_xrRequestDisplayRefreshRateFB(xr_session, rate));
+    }
+    return missed;
+}
+
+static void perf_governor_update(struct app* app, float cpu_ms, XrDuration period) {
+    struct perf_governor* governor = &app->governor;
+    if (!governor->enabled || bench_running(&app->bench) || period <= 0) {
+        return;
+    }
+    float period_ms = period / 1e6f;
+    float cpu_load = cpu_ms / period_ms;
+    perf_domain_update(&governor->domains[PERF_DOMAIN_CPU],
+                       cpu_load > PERF_RAISE_LOAD, cpu_load < PERF_LOWER_LOAD);
+
+    // dynamic resolution absorbs GPU load, so its scale is the signal for
+    // raising; supersampling soaks up any headroom, so lowering judges the
+    // load the frame would have at scale 1.0, as refresh_rate_update does
+    const struct dynamic_resolution* drs = &app->resolution;
+    float gpu_load = drs->gpu_ms / period_ms;
+    float native_gpu_load = gpu_load / (drs->scale * drs->scale);
+    perf_domain_update(&governor->domains[PERF_DOMAIN_GPU],
+                       drs->step < DRS_STEPS_PER_UNIT || gpu_load > PERF_RAISE_LOAD,
+                       drs->step >= DRS_STEPS_PER_UNIT && native_gpu_load < PERF_LOWER_LOAD);
+}
+
+// A static title panel: drawn once, then left entirely to the compositor.
+#define TITLE_QUAD_WIDTH 512
+#define TITLE_QUAD_HEIGHT 128
+
+static void ui_create(struct app* app) {
+    layers_init(&app->layers, &app->persistent);
+    XrPosef pose = { {0, 0, 0, 1}, {0.0f, 0.45f, -1.5f} };
+    XrExtent2Df size = { 0.8f, 0.2f };
+    app->title_quad = layers_create_quad(&app->layers, xr_session, TITLE_QUAD_WIDTH, TITLE_QUAD_HEIGHT, pose, size);
+    uint32_t* pixels = layers_quad_pixels(&app->layers, app->title_quad);
+    font_fill_rect(pixels, TITLE_QUAD_WIDTH, TITLE_QUAD_HEIGHT, 0, 0, TITLE_QUAD_WIDTH, TITLE_QUAD_HEIGHT,
+                   FONT_RGBA(12, 12, 16, 192));
+    font_draw_text(pixels, TITLE_QUAD_WIDTH, TITLE_QUAD_HEIGHT, 24, 24, 6, FONT_RGBA(255, 255, 255, 255),
+                   "HELLO QUEST");
+    font_draw_text(pixels, TITLE_QUAD_WIDTH, TITLE_QUAD_HEIGHT, 24, 88, 2, FONT_RGBA(160, 160, 160, 255),
+                   "OPENXR + GLES3");
+    layers_quad_dirty(&app->layers, app->title_quad);
+}
+
+static bool hud_property_enabled(bool fallback) {
+    char value[PROP_VALUE_MAX];
+    if (__system_property_get(HUD_PROPERTY, value) <= 0) {
+        return fallback;
+    }
+    return strcmp(value, "0") != 0;
+}
+
+static void hud_init(struct app* app) {
+    struct hud* hud = &app->hud;
+    *hud = (struct hud) { 0 };
+#ifndef NDEBUG
+    hud->enabled = hud_property_enabled(true);
+#else
+    hud->enabled = hud_property_enabled(false);
+#endif // NDEBUG
+    hud->update_time = time_ns();
+    XrPosef pose = { {0, 0, 0, 1}, {-0.35f, -0.3f, -1.0f} };
+    XrExtent2Df size = { 0.3f, 0.15f };
+    hud->quad = layers_create_quad(&app->layers, xr_session, HUD_WIDTH, HUD_HEIGHT, pose, size);
+    layers_quad_visible(&app->layers, hud->quad, hud->enabled);
+}
+
+static void hud_update(struct app* app, float cpu_ms, bool missed) {
+    struct hud* hud = &app->hud;
+    hud->frames++;
+    hud->dropped += missed ? 1 : 0;
+    hud->cpu_ms += cpu_ms;
+    hud->draw_calls += app->draw_calls;
+
+    int64_t now = time_ns();
+    if (now - hud->update_time < HUD_UPDATE_INTERVAL_NS) {
+        return;
+    }
+    TRACE_SCOPE("hud_update");
+    float interval_s = (now - hud->update_time) / 1e9f;
+    bool enabled = hud_property_enabled(hud->enabled);
+    if (enabled != hud->enabled) {
+        info("hud %s", enabled ? "on" : "off");
+        hud->enabled = enabled;
+        layers_quad_visible(&app->layers, hud->quad, enabled);
+    }
+
+    if (hud->enabled) {
+        struct resource_stats stats;
+        resources_get_stats(&stats);
+        char* text = arena_alloc(app->frame_arena.current, HUD_TEXT_SIZE, 1);
+        snprintf(text, HUD_TEXT_SIZE,
+                 "FPS  %.1f (%.0fHZ)\n"
+                 "CPU  %.2f MS\n"
+                 "GPU  %.2f RES %.2f\n"
+                 "DROP %u  DRAWS %u\n"
+                 "MEM  %.1f MB",
+                 hud->frames / interval_s, pacing_rate(&app->pacing),
+                 hud->cpu_ms / hud->frames,
+                 app->resolution.gpu_ms, app->resolution.scale,
+                 hud->dropped, hud->draw_calls / hud->frames,
+                 stats.total_bytes / (1024.0 * 1024.0));
+        uint32_t* pixels = layers_quad_pixels(&app->layers, hud->quad);
+        font_fill_rect(pixels, HUD_WIDTH, HUD_HEIGHT, 0, 0, HUD_WIDTH, HUD_HEIGHT, FONT_RGBA(0, 0, 0, 160));
+        font_draw_text(pixels, HUD_WIDTH, HUD_HEIGHT, 8, 8, 2, FONT_RGBA(96, 255, 96, 255), text);
+        layers_quad_dirty(&app->layers, hud->quad);
+    }
+
+    hud->update_time = now;
+    hud->frames = 0;
+    hud->dropped = 0;
+    hud->cpu_ms = 0.0f;
+    hud->draw_calls = 0;
+}
+
 void openxr_render_frame(struct app *app) {
+    TRACE_SCOPE("openxr_render_frame");
     XrFrameState frame_state = { XR_TYPE_FRAME_STATE };
+    bench_frame_begin(&app->bench);
+    int64_t wait_start = time_ns();
+    TRACE_BEGIN("xrWaitFrame");
     XRCMD(xrWaitFrame(xr_session, NULL, &frame_state));
-
+    TRACE_END("xrWaitFrame");
+    bench_phase_end(&app->bench, BENCH_PHASE_WAIT);
+    app->loop_stats.wait_ns += time_ns() - wait_start;
+    app->loop_stats.frames++;
+    app->frame_index++;
+    TRACE_FRAME(app->frame_index);
+    GL_CAPTURE_FRAME(app->frame_index);
+    frame_arena_begin(&app->frame_arena, app->frame_index);
+    int64_t cpu_start = time_ns();
+    app->draw_calls = 0;
+    scene_update(app, recorder_frame(&app->recorder, &frame_state));
+    bench_phase_end(&app->bench, BENCH_PHASE_UPDATE);
+
+    TRACE_BEGIN("xrBeginFrame");
     XRCMD(xrBeginFrame(xr_session, NULL));
+    TRACE_END("xrBeginFrame");
+    bench_phase_end(&app->bench, BENCH_PHASE_BEGIN);
 
-    XrCompositionLayerBaseHeader *layers[1];
+    const XrCompositionLayerBaseHeader *layers[1 + LAYERS_MAX_QUADS];
+    // must outlive the block below, xrEndFrame reads it
+    XrCompositionLayerProjection layer_proj = { XR_TYPE_COMPOSITION_LAYER_PROJECTION };
 
     int num_rendered_layers = 0;
     XrCompositionLayerProjectionView proj_views[VIEW_COUNT];
+    XrCompositionLayerSpaceWarpInfoFB space_warp_infos[VIEW_COUNT];
+    XrCompositionLayerDepthInfoKHR depth_infos[VIEW_COUNT];
 
     if (frame_state.shouldRender) {
         num_rendered_layers++;
+        gpu_timer_begin(&app->resolution.gpu_timer);
+        geometry_heap_update(&app->geometry, &app->loader);
 
         XrViewLocateInfo view_locate_info = { XR_TYPE_VIEW_LOCATE_INFO };
         view_locate_info.viewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
@@ -1047,38 +2221,64 @@ void openxr_render_frame(struct app *app) {
         XrViewState view_state = { XR_TYPE_VIEW_STATE };
         XrView views[2] = { {XR_TYPE_VIEW}, {XR_TYPE_VIEW}};
         uint32_t viewCountOutput;
+        TRACE_BEGIN("xrLocateViews");
         XRCMD(xrLocateViews(xr_session, &view_locate_info, &view_state, VIEW_COUNT, &viewCountOutput, &views[0]));
+        TRACE_END("xrLocateViews");
+        recorder_views(&app->recorder, &view_state, views, VIEW_COUNT);
+        scene_cull(app, views);
+        bench_phase_end(&app->bench, BENCH_PHASE_CULL);
 
         for (int i = 0; i < VIEW_COUNT; i++) {
             struct framebuffer *framebuffer = &app->framebuffers[i];
 
-            uint32_t swapchain_image_index;
-            XrSwapchainImageAcquireInfo acquire_info = { XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO };
-            XRCMD(xrAcquireSwapchainImage(framebuffer->swapchain, &acquire_info, &swapchain_image_index));
-
-            XrSwapchainImageWaitInfo wait_info = { XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO };
-            wait_info.timeout = XR_INFINITE_DURATION;
-            XRCMD(xrWaitSwapchainImage(framebuffer->swapchain, &wait_info));
+            uint32_t swapchain_image_index = swapchain_acquire(framebuffer->swapchain);
+            uint32_t depth_image_index = 0;
+            if (framebuffer->depth_swapchain != XR_NULL_HANDLE) {
+                depth_image_index = swapchain_acquire(framebuffer->depth_swapchain);
+            }
 
             proj_views[i].type = XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW;
+            proj_views[i].next = NULL;
             proj_views[i].pose = views[i].pose;
             proj_views[i].fov = views[i].fov;
             proj_views[i].subImage.swapchain = framebuffer->swapchain;
-            proj_views[i].subImage.imageRect.offset = (XrOffset2Di) { 0, 0 };
-            proj_views[i].subImage.imageRect.extent = (XrExtent2Di) { framebuffer->width, framebuffer->height };
+            proj_views[i].subImage.imageRect = dynamic_resolution_rect(&app->resolution, framebuffer);
 
-            gl_render(app, framebuffer, proj_views[i], swapchain_image_index);
+            jobs_wait(&app->jobs, &app->draw_lists_recorded[i]);
+            gl_render(app, framebuffer, &app->draw_lists[i], proj_views[i], swapchain_image_index,
+                      depth_image_index);
+            swapchain_release(framebuffer->swapchain);
 
-            XrSwapchainImageReleaseInfo release_info = { XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO };
-            XRCMD(xrReleaseSwapchainImage(framebuffer->swapchain, &release_info));
+            const void* next = NULL;
+            if (framebuffer->motion_swapchain != XR_NULL_HANDLE) {
+                gl_render_motion(app, framebuffer, &app->draw_lists[i], &proj_views[i], &space_warp_infos[i]);
+                next = &space_warp_infos[i];
+            }
+            if (framebuffer->depth_swapchain != XR_NULL_HANDLE) {
+                swapchain_release(framebuffer->depth_swapchain);
+                depth_infos[i] = (XrCompositionLayerDepthInfoKHR) { XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR };
+                depth_infos[i].next = next;
+                depth_infos[i].subImage.swapchain = framebuffer->depth_swapchain;
+                depth_infos[i].subImage.imageRect = proj_views[i].subImage.imageRect;
+                depth_infos[i].minDepth = 0.0f;
+                depth_infos[i].maxDepth = 1.0f;
+                depth_infos[i].nearZ = PROJECTION_NEAR_Z;
+                depth_infos[i].farZ = PROJECTION_FAR_Z;
+                next = &depth_infos[i];
+            }
+            proj_views[i].next = next;
         }
+        gpu_timer_end(&app->resolution.gpu_timer);
+        bench_phase_end(&app->bench, BENCH_PHASE_RENDER);
 
-        XrCompositionLayerProjection layer_proj;
-        layer_proj.type = XR_TYPE_COMPOSITION_LAYER_PROJECTION;
         layer_proj.space = xr_app_space;
         layer_proj.viewCount = VIEW_COUNT;
         layer_proj.views = &proj_views[0];
         layers[0] = (XrCompositionLayerBaseHeader*) &layer_proj;
+
+        // quads after the projection so they are composited on top
+        layers_update(&app->layers);
+        num_rendered_layers += layers_submit(&app->layers, xr_app_space, &layers[1], LAYERS_MAX_QUADS);
     }
 
     XrFrameEndInfo end_info = { XR_TYPE_FRAME_END_INFO };
@@ -1086,30 +2286,169 @@ void openxr_render_frame(struct app *app) {
     end_info.environmentBlendMode = xr_blend;
     end_info.layerCount = num_rendered_layers;
     end_info.layers = (const XrCompositionLayerBaseHeader *const *)&layers[0];
+    float cpu_ms = (time_ns() - cpu_start) / 1e6f;
+    TRACE_BEGIN("xrEndFrame");
     XRCMD(xrEndFrame(xr_session, &end_info));
+    TRACE_END("xrEndFrame");
+    bench_phase_end(&app->bench, BENCH_PHASE_SUBMIT);
+
+    if (num_rendered_layers > 0) {
+        lifecycle_first_frame(&app->lifecycle);
+        dynamic_resolution_update(&app->resolution, cpu_ms, frame_state.predictedDisplayPeriod);
+        bool missed = refresh_rate_update(app, &frame_state, cpu_ms);
+        hud_update(app, cpu_ms, missed);
+        foveation_update(app);
+        perf_governor_update(app, cpu_ms, frame_state.predictedDisplayPeriod);
+        if (app->resolution.gpu_collected) {
+            bench_gpu(&app->bench, app->resolution.gpu_last_ms);
+        }
+        if (bench_frame_end(&app->bench, app->draw_calls, missed)) {
+            float refresh_rate = frame_state.predictedDisplayPeriod > 0 ?
+                                 1e9f / frame_state.predictedDisplayPeriod : 0.0f;
+            bench_write(&app->bench, app->bench_path, (const char*)glGetString(GL_RENDERER), refresh_rate);
+            app->exit_requested = true;
+        }
+    }
+}
+
+static void recorder_start(struct app* app, struct android_app* android_app) {
+    char value[PROP_VALUE_MAX];
+    enum recorder_mode mode = RECORDER_OFF;
+    if (__system_property_get(RECORDER_PROPERTY, value) > 0) {
+        if (strcmp(value, "record") == 0) {
+            mode = RECORDER_RECORD;
+        } else if (strcmp(value, "replay") == 0) {
+            mode = RECORDER_REPLAY;
+        }
+    }
+    const char* directory = android_app->activity->externalDataPath;
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", directory != NULL ? directory : ".", RECORDER_FILE);
+    recorder_init(&app->recorder, mode, path);
+}
+
+static void bench_start(struct app* app, struct android_app* android_app) {
+    char value[PROP_VALUE_MAX];
+    app->exit_requested = false;
+    memset(&app->bench, 0, sizeof(app->bench));
+    if (__system_property_get(BENCH_PROPERTY, value) <= 0) {
+        return;
+    }
+    bench_init(&app->bench, value);
+    if (!app->bench.enabled) {
+        return;
+    }
+    const char* directory = android_app->activity->externalDataPath;
+    snprintf(app->bench_path, sizeof(app->bench_path), "%s/bench-%s.json",
+             directory != NULL ? directory : ".", app->bench.config.name);
+    // every measured frame renders at the full recommended resolution
+    app->resolution.fixed = true;
+}
+
+static void gl_capture_start_from_property(struct android_app* android_app) {
+#if ENABLE_GL_CAPTURE
+    char value[PROP_VALUE_MAX];
+    if (__system_property_get(GL_CAPTURE_PROPERTY, value) <= 0) {
+        return;
+    }
+    const char* directory = android_app->activity->externalDataPath;
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", directory != NULL ? directory : ".", GL_CAPTURE_FILE);
+    GL_CAPTURE_START(path, (uint32_t)strtoul(value, NULL, 10));
+#endif // ENABLE_GL_CAPTURE
 }
 
 static void app_create(struct android_app* android_app, struct app* app) {
-    egl_create(&app->egl);
+    arena_create(&app->persistent, "persistent", PERSISTENT_ARENA_SIZE);
+    frame_arena_create(&app->frame_arena, FRAME_ARENA_SIZE);
+    arena_create(&app->swapchain_arena, "swapchain", SWAPCHAIN_ARENA_SIZE);
+    app->frame_index = 0;
+    resources_set_budget(RESOURCE_BUDGET_BYTES);
+    egl_create(&app->egl, &app->persistent);
+    loader_create(&app->loader, app->egl.display, app->egl.config, app->egl.context);
+    recorder_start(app, android_app);
+    gl_capture_start_from_property(android_app);
     openxr_init(android_app, app);
-    program_create(&app->program);
-    geometry_create(&app->geometry);
+    jobs_create(&app->jobs, JOB_THREADS);
+    foveation_start(app);
+    dynamic_resolution_init(&app->resolution);
+    space_warp_init(&app->space_warp);
+    bench_start(app, android_app);
+    refresh_rate_init(app);
+    perf_governor_init(&app->governor);
+    ui_create(app);
+    hud_init(app);
+    app->last_display_time = 0;
+    memset(app->framebuffers, 0, sizeof(app->framebuffers));
+    app->lifecycle = (struct lifecycle) { 0 };
+    lifecycle_mark_resume(&app->lifecycle, "launch");
+    framebuffers_ensure(app);
+    memset(&app->shaders, 0, sizeof(app->shaders));
+    shaders_get(&app->shaders, SCENE_SHADER_FEATURES);
+    if (app->space_warp.enabled) {
+        shaders_get(&app->shaders, SPACE_WARP_SHADER_FEATURES);
+    }
+    geometry_create(app);
+    scene_create(app);
     app->resumed = false;
+    app->loop_stats = (struct loop_stats) { time_ns() };
 }
 
 static void app_destroy(struct app* app) {
-    geometry_destroy(&app->geometry);
-    program_destroy(&app->program);
-    for (int i = 0; i < VIEW_COUNT; ++i) {
-        framebuffer_destroy(&app->framebuffers[i]);
-    }
+    GL_CAPTURE_STOP();
+    recorder_close(&app->recorder);
+    bench_destroy(&app->bench);
+    loader_destroy(&app->loader);
+    resources_report(true);
+    layers_destroy(&app->layers);
+    info("release resources");
+    resources_release_all();
+    xr_instance = XR_NULL_HANDLE;
+    xr_session = XR_NULL_HANDLE;
+    xr_app_space = XR_NULL_HANDLE;
     egl_destroy(&app->egl);
+    transforms_destroy(&app->transforms);
+    entities_destroy(&app->entities);
+    jobs_report(&app->jobs);
+    jobs_destroy(&app->jobs);
+
+    arena_report(&app->persistent);
+    info("frame arena high water %zu of %d bytes",
+         frame_arena_high_water(&app->frame_arena), FRAME_ARENA_SIZE);
+    frame_arena_destroy(&app->frame_arena);
+    arena_destroy(&app->swapchain_arena);
+    arena_destroy(&app->persistent);
+}
+
+static int loop_timeout(struct android_app* android_app, struct app* app) {
+    if (android_app->destroyRequested || xr_running) {
+        // xrWaitFrame blocks until the runtime wants the next frame, so the
+        // looper must not add latency on top of it.
+        return 0;
+    }
+    return app->resumed ? LOOP_TIMEOUT_RESUMED_MS : LOOP_TIMEOUT_PAUSED_MS;
+}
+
+static void loop_stats_report(struct loop_stats* stats, int64_t now) {
+    int64_t elapsed = now - stats->report_time;
+    if (elapsed < LOOP_STATS_INTERVAL_NS) {
+        return;
+    }
+    double frames = stats->frames > 0 ? stats->frames : 1.0;
+    info("loop: idle %.1f%% wait %.1f%% busy %.1f%% (%u wakeups, %u frames in %.1fs, %.1f transforms/frame, "
+         "%.1f culled/frame)",
+         100.0 * stats->idle_ns / elapsed, 100.0 * stats->wait_ns / elapsed,
+         100.0 * stats->busy_ns / elapsed, stats->wakeups, stats->frames, elapsed / 1e9,
+         stats->transform_updates / frames, stats->culled / frames);
+    *stats = (struct loop_stats) { now };
 }
 
 void android_main(struct android_app* android_app) {
     ANativeActivity_setWindowFlags(android_app->activity,
                                    AWINDOW_FLAG_KEEP_SCREEN_ON, 0);
 
+    log_init();
+    TRACE_INIT();
     info("hello");
 
     struct app app;
@@ -1119,25 +2458,47 @@ void android_main(struct android_app* android_app) {
     android_app->userData = &app;
     android_app->onAppCmd = app_on_cmd;
     while (!android_app->destroyRequested) {
+        int64_t loop_start = time_ns();
+        int64_t idle_ns = 0;
+        int timeout = loop_timeout(android_app, &app);
+        TRACE_BEGIN("looper");
         for (;;) {
             int events = 0;
             struct android_poll_source* source = NULL;
-            if (ALooper_pollAll(
-                    android_app->destroyRequested,
-                    NULL, &events, (void**)&source) < 0) {
+            int64_t poll_start = time_ns();
+            int ident = ALooper_pollAll(timeout, NULL, &events, (void**)&source);
+            idle_ns += time_ns() - poll_start;
+            if (ident < 0) {
                 break;
             }
+            app.loop_stats.wakeups++;
             if (source != NULL) {
                 source->process(android_app, source);
             }
+            // drain whatever else is pending, but only block once per iteration
+            timeout = 0;
         }
+        TRACE_END("looper");
 
-        openxr_poll_events();
+        openxr_poll_events(&app);
 
+        int64_t wait_ns = app.loop_stats.wait_ns;
         if (xr_running) {
             openxr_render_frame(&app);
         }
+        if (app.exit_requested) {
+            app.exit_requested = false;
+            ANativeActivity_finish(android_app->activity);
+        }
+        wait_ns = app.loop_stats.wait_ns - wait_ns;
+
+        int64_t loop_end = time_ns();
+        app.loop_stats.idle_ns += idle_ns;
+        app.loop_stats.busy_ns += loop_end - loop_start - idle_ns - wait_ns;
+        loop_stats_report(&app.loop_stats, loop_end);
     }
 
     app_destroy(&app);
+    TRACE_SHUTDOWN();
+    log_shutdown();
 }
@@ -0,0 +1,384 @@
+#define _GNU_SOURCE
+#include "jobs.h"
+#include "log.h"
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define LOGI(...) log_write(LOG_CATEGORY_APP, LOG_PRIORITY_INFO, __VA_ARGS__)
+#define LOGE(...) log_write(LOG_CATEGORY_APP, LOG_PRIORITY_ERROR, __VA_ARGS__)
+
+// failed steal rounds before a worker goes to sleep
+#define JOBS_SPIN_ROUNDS 64
+#define JOBS_MAX_CPUS 64
+
+static _Thread_local int thread_index = -1;
+
+int jobs_thread_index(void) {
+    return thread_index < 0 ? 0 : thread_index;
+}
+
+static void deque_init(struct job_deque* deque) {
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+    deque->jobs = calloc(JOBS_DEQUE_SIZE, sizeof(*deque->jobs));
+    if (deque->jobs == NULL) {
+        LOGE("can't allocate job deque");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// owner only
+static bool deque_push(struct job_deque* deque, struct job* job) {
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top >= JOBS_DEQUE_SIZE) {
+        return false;
+    }
+    atomic_store_explicit(&deque->jobs[bottom & (JOBS_DEQUE_SIZE - 1)], job, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+    return true;
+}
+
+// owner only
+static struct job* deque_pop(struct job_deque* deque) {
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+    struct job* job = atomic_load_explicit(&deque->jobs[bottom & (JOBS_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (top == bottom) {
+        // last job, race the thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst,
+                                                     memory_order_relaxed)) {
+            job = NULL;
+        }
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return job;
+}
+
+// any thread
+static struct job* deque_steal(struct job_deque* deque) {
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) {
+        return NULL;
+    }
+    struct job* job = atomic_load_explicit(&deque->jobs[top & (JOBS_DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return NULL;
+    }
+    return job;
+}
+
+static bool deque_empty(struct job_deque* deque) {
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    return top >= bottom;
+}
+
+static struct job_thread* jobs_self(struct jobs* jobs) {
+    return &jobs->threads[jobs_thread_index()];
+}
+
+static struct job* jobs_find(struct jobs* jobs, struct job_thread* self) {
+    struct job* job = deque_pop(&self->deque);
+    if (job != NULL) {
+        return job;
+    }
+    for (int i = 1; i < jobs->thread_count; i++) {
+        struct job_thread* victim = &jobs->threads[(self->index + i) % jobs->thread_count];
+        job = deque_steal(&victim->deque);
+        if (job != NULL) {
+            self->stolen++;
+            return job;
+        }
+    }
+    return NULL;
+}
+
+static void jobs_wake(struct jobs* jobs) {
+    // pairs with the fence in jobs_sleep: either the sleeper sees our job
+    // or we see the sleeper
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&jobs->sleepers, memory_order_relaxed) > 0) {
+        pthread_mutex_lock(&jobs->mutex);
+        pthread_cond_broadcast(&jobs->wake);
+        pthread_mutex_unlock(&jobs->mutex);
+    }
+}
+
+static void jobs_execute(struct jobs* jobs, struct job_thread* self, struct job* job);
+
+static void jobs_push(struct jobs* jobs, struct job_thread* self, struct job* job) {
+    while (!deque_push(&self->deque, job)) {
+        // full: make room by running something ourselves
+        struct job* other = jobs_find(jobs, self);
+        if (other != NULL) {
+            jobs_execute(jobs, self, other);
+        }
+    }
+    jobs_wake(jobs);
+}
+
+static void jobs_execute(struct jobs* jobs, struct job_thread* self, struct job* job) {
+    if (job->dependency != NULL) {
+        // helping here rather than putting the job back: anything it depends
+        // on may well be sitting underneath it in our own deque
+        jobs_wait(jobs, job->dependency);
+    }
+    job->fn(job->data);
+    self->executed++;
+    if (job->counter != NULL) {
+        atomic_fetch_sub_explicit(&job->counter->pending, 1, memory_order_release);
+    }
+}
+
+static void jobs_sleep(struct jobs* jobs) {
+    pthread_mutex_lock(&jobs->mutex);
+    atomic_fetch_add_explicit(&jobs->sleepers, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    bool work = false;
+    for (int i = 0; i < jobs->thread_count && !work; i++) {
+        work = !deque_empty(&jobs->threads[i].deque);
+    }
+    if (!work && !atomic_load(&jobs->stopping)) {
+        pthread_cond_wait(&jobs->wake, &jobs->mutex);
+    }
+    atomic_fetch_sub_explicit(&jobs->sleepers, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&jobs->mutex);
+}
+
+int jobs_select_big_cores(const long* max_freqs, int cpu_count, int* cores, int max_cores) {
+    long lowest = 0;
+    for (int cpu = 0; cpu < cpu_count; cpu++) {
+        if (max_freqs[cpu] > 0 && (lowest == 0 || max_freqs[cpu] < lowest)) {
+            lowest = max_freqs[cpu];
+        }
+    }
+    // a single cluster, or no cpufreq: every core is big
+    bool single = true;
+    for (int cpu = 0; cpu < cpu_count; cpu++) {
+        single &= max_freqs[cpu] == lowest || max_freqs[cpu] == 0;
+    }
+    int count = 0;
+    for (int cpu = 0; cpu < cpu_count && count < max_cores; cpu++) {
+        if (single || max_freqs[cpu] > lowest) {
+            cores[count++] = cpu;
+        }
+    }
+    return count;
+}
+
+static int jobs_big_cores(int* cores, int max_cores) {
+    long cpu_count = sysconf(_SC_NPROCESSORS_CONF);
+    if (cpu_count > JOBS_MAX_CPUS) {
+        cpu_count = JOBS_MAX_CPUS;
+    }
+    long max_freqs[JOBS_MAX_CPUS];
+    for (int cpu = 0; cpu < cpu_count; cpu++) {
+        char path[96];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+        FILE* file = fopen(path, "r");
+        max_freqs[cpu] = 0;
+        if (file != NULL) {
+            if (fscanf(file, "%ld", &max_freqs[cpu]) != 1) {
+                max_freqs[cpu] = 0;
+            }
+            fclose(file);
+        }
+    }
+    return jobs_select_big_cores(max_freqs, (int)cpu_count, cores, max_cores);
+}
+
+// Pinned to the big cluster rather than one core each, so the scheduler
+// still balances within it. Called by the worker itself.
+static void jobs_pin(const struct jobs* jobs) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < JOBS_MAX_CPUS; cpu++) {
+        if (jobs->core_mask & (1ULL << cpu)) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if (sched_setaffinity((pid_t)syscall(SYS_gettid), sizeof(set), &set) != 0) {
+        LOGI("can't set job worker affinity");
+    }
+#endif
+}
+
+static void* jobs_worker(void* arg) {
+    struct job_thread* self = arg;
+    struct jobs* jobs = self->jobs;
+    thread_index = self->index;
+    jobs_pin(jobs);
+    int idle = 0;
+    while (!atomic_load_explicit(&jobs->stopping, memory_order_acquire)) {
+        struct job* job = jobs_find(jobs, self);
+        if (job != NULL) {
+            jobs_execute(jobs, self, job);
+            idle = 0;
+        } else if (++idle >= JOBS_SPIN_ROUNDS) {
+            jobs_sleep(jobs);
+            idle = 0;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+void jobs_create(struct jobs* jobs, int thread_count) {
+    memset(jobs, 0, sizeof(*jobs));
+    int cores[JOBS_MAX_CPUS];
+    int core_count = jobs_big_cores(cores, JOBS_MAX_CPUS);
+    if (thread_count <= 0) {
+        thread_count = core_count;
+    }
+    if (thread_count > JOBS_MAX_THREADS) {
+        thread_count = JOBS_MAX_THREADS;
+    }
+    if (thread_count < 1) {
+        thread_count = 1;
+    }
+    jobs->thread_count = thread_count;
+    for (int i = 0; i < core_count; i++) {
+        jobs->core_mask |= 1ULL << cores[i];
+    }
+    atomic_init(&jobs->stopping, false);
+    atomic_init(&jobs->sleepers, 0);
+    pthread_mutex_init(&jobs->mutex, NULL);
+    pthread_cond_init(&jobs->wake, NULL);
+    thread_index = 0;
+
+    for (int i = 0; i < thread_count; i++) {
+        struct job_thread* thread = &jobs->threads[i];
+        thread->jobs = jobs;
+        thread->index = i;
+        deque_init(&thread->deque);
+        thread->pool = calloc(JOBS_POOL_SIZE, sizeof(*thread->pool));
+        if (thread->pool == NULL) {
+            LOGE("can't allocate job pool");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 1; i < thread_count; i++) {
+        struct job_thread* thread = &jobs->threads[i];
+        if (pthread_create(&thread->thread, NULL, jobs_worker, thread) != 0) {
+            LOGE("can't start job worker %d", i);
+            exit(EXIT_FAILURE);
+        }
+        char name[16];
+        snprintf(name, sizeof(name), "job worker %d", i);
+        pthread_setname_np(thread->thread, name);
+    }
+    LOGI("job system: %d threads, %d big cores", thread_count, core_count);
+}
+
+void jobs_destroy(struct jobs* jobs) {
+    pthread_mutex_lock(&jobs->mutex);
+    atomic_store(&jobs->stopping, true);
+    pthread_cond_broadcast(&jobs->wake);
+    pthread_mutex_unlock(&jobs->mutex);
+    for (int i = 1; i < jobs->thread_count; i++) {
+        pthread_join(jobs->threads[i].thread, NULL);
+    }
+    for (int i = 0; i < jobs->thread_count; i++) {
+        free(jobs->threads[i].deque.jobs);
+        free(jobs->threads[i].pool);
+    }
+    pthread_mutex_destroy(&jobs->mutex);
+    pthread_cond_destroy(&jobs->wake);
+}
+
+void jobs_run_after(struct jobs* jobs, void (*fn)(void* data), void* data, struct job_counter* counter,
+                    struct job_counter* dependency) {
+    struct job_thread* self = jobs_self(jobs);
+    struct job* job = &self->pool[self->pool_next++ & (JOBS_POOL_SIZE - 1)];
+    job->fn = fn;
+    job->data = data;
+    job->counter = counter;
+    job->dependency = dependency;
+    if (counter != NULL) {
+        atomic_fetch_add_explicit(&counter->pending, 1, memory_order_relaxed);
+    }
+    jobs_push(jobs, self, job);
+}
+
+void jobs_run(struct jobs* jobs, void (*fn)(void* data), void* data, struct job_counter* counter) {
+    jobs_run_after(jobs, fn, data, counter, NULL);
+}
+
+void jobs_wait(struct jobs* jobs, struct job_counter* counter) {
+    struct job_thread* self = jobs_self(jobs);
+    while (atomic_load_explicit(&counter->pending, memory_order_acquire) > 0) {
+        struct job* job = jobs_find(jobs, self);
+        if (job != NULL) {
+            jobs_execute(jobs, self, job);
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+struct parallel_for {
+    void (*fn)(void* data, uint32_t begin, uint32_t end);
+    void* data;
+    uint32_t begin;
+    uint32_t end;
+};
+
+static void parallel_for_job(void* data) {
+    struct parallel_for* range = data;
+    range->fn(range->data, range->begin, range->end);
+}
+
+#define JOBS_MAX_CHUNKS 256
+
+void jobs_parallel_for(struct jobs* jobs, uint32_t count, uint32_t grain,
+                       void (*fn)(void* data, uint32_t begin, uint32_t end), void* data) {
+    if (grain == 0) {
+        grain = 1;
+    }
+    uint32_t chunk_count = (count + grain - 1) / grain;
+    if (chunk_count > JOBS_MAX_CHUNKS) {
+        chunk_count = JOBS_MAX_CHUNKS;
+        grain = (count + chunk_count - 1) / chunk_count;
+        chunk_count = (count + grain - 1) / grain;
+    }
+    if (chunk_count <= 1 || jobs->thread_count == 1) {
+        if (count > 0) {
+            fn(data, 0, count);
+        }
+        return;
+    }
+    struct parallel_for ranges[JOBS_MAX_CHUNKS];
+    struct job_counter counter = { 0 };
+    // keep the first chunk for ourselves
+    for (uint32_t i = 1; i < chunk_count; i++) {
+        uint32_t begin = i * grain;
+        uint32_t end = begin + grain < count ? begin + grain : count;
+        ranges[i] = (struct parallel_for) { fn, data, begin, end };
+        jobs_run(jobs, parallel_for_job, &ranges[i], &counter);
+    }
+    fn(data, 0, grain < count ? grain : count);
+    jobs_wait(jobs, &counter);
+}
+
+void jobs_report(const struct jobs* jobs) {
+    for (int i = 0; i < jobs->thread_count; i++) {
+        LOGI("job thread %d: %llu executed, %llu stolen", i,
+             (unsigned long long)jobs->threads[i].executed, (unsigned long long)jobs->threads[i].stolen);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef _JOBS_H
+#define _JOBS_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Fixed pool of worker threads with one work-stealing (Chase-Lev) deque per
+// thread, including the thread that created the pool. A thread pushes and
+// pops its own jobs LIFO at the bottom of its deque; idle threads steal
+// FIFO from the top of the others. Completion is tracked with counters:
+// jobs_wait keeps running jobs until a counter drops to zero, and a job can
+// be held back until another counter has.
+//
+// Jobs may only be submitted from the creating thread or from inside jobs.
+
+// Must be powers of two.
+#define JOBS_DEQUE_SIZE 4096
+#define JOBS_POOL_SIZE 4096
+#define JOBS_MAX_THREADS 8
+
+struct job_counter {
+    atomic_int pending;
+};
+
+struct job {
+    void (*fn)(void* data);
+    void* data;
+    struct job_counter* counter;
+    // may not start before this one reaches zero, NULL if none
+    struct job_counter* dependency;
+};
+
+struct job_deque {
+    _Alignas(64) atomic_long top;
+    _Alignas(64) atomic_long bottom;
+    struct job* _Atomic* jobs;
+};
+
+struct job_thread {
+    struct jobs* jobs;
+    pthread_t thread;
+    int index;
+    struct job_deque deque;
+    // ring of job storage, reused after JOBS_POOL_SIZE submissions
+    struct job* pool;
+    uint32_t pool_next;
+    uint64_t executed;
+    uint64_t stolen;
+};
+
+struct jobs {
+    int thread_count;
+    // cpus the workers run on, see jobs_select_big_cores
+    uint64_t core_mask;
+    struct job_thread threads[JOBS_MAX_THREADS];
+    atomic_bool stopping;
+    atomic_int sleepers;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+};
+
+// Starts thread_count - 1 workers (0 picks one per big core); the calling
+// thread is thread 0.
+void jobs_create(struct jobs* jobs, int thread_count);
+void jobs_destroy(struct jobs* jobs);
+
+void jobs_run(struct jobs* jobs, void (*fn)(void* data), void* data, struct job_counter* counter);
+void jobs_run_after(struct jobs* jobs, void (*fn)(void* data), void* data, struct job_counter* counter,
+                    struct job_counter* dependency);
+
+// Runs jobs (ours or stolen) until counter reaches zero.
+void jobs_wait(struct jobs* jobs, struct job_counter* counter);
+
+// Calls fn(data, begin, end) over [0, count) in chunks of at most grain and
+// waits for all of them; runs inline when there is only one chunk.
+void jobs_parallel_for(struct jobs* jobs, uint32_t count, uint32_t grain,
+                       void (*fn)(void* data, uint32_t begin, uint32_t end), void* data);
+
+// Index of the calling thread in the pool, 0 for the creating thread.
+int jobs_thread_index(void);
+
+void jobs_report(const struct jobs* jobs);
+
+// Big cores are every core faster than the slowest cluster, by
+// cpuinfo_max_freq (0 where unknown): on the XR2 of a Quest 2, the three
+// performance cores and the prime core, leaving out the four efficiency
+// cores. With a single cluster, or no cpufreq at all, every core is big.
+// Returns how many were written to cores.
+int jobs_select_big_cores(const long* max_freqs, int cpu_count, int* cores, int max_cores);
+
+#endif /* _JOBS_H */
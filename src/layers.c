@@ -0,0 +1,160 @@
+#include "layers.h"
+#include "log.h"
+#include "resources.h"
+#include "trace.h"
+#include <GLES3/gl3.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOGI(...) log_write(LOG_CATEGORY_XR, LOG_PRIORITY_INFO, __VA_ARGS__)
+#define LOGE(...) log_write(LOG_CATEGORY_XR, LOG_PRIORITY_ERROR, __VA_ARGS__)
+
+#define XRCMD(cmd) \
+{                  \
+    XrResult code = cmd;               \
+    if (!XR_SUCCEEDED(code)) { \
+        LOGE("%s failed: %i", #cmd, code);               \
+    }              \
+}
+
+static const char* LAYERS_OWNER = "layers";
+
+void layers_init(struct layers* layers, struct arena* arena) {
+    memset(layers, 0, sizeof(*layers));
+    layers->arena = arena;
+}
+
+void layers_destroy(struct layers* layers) {
+    resources_release_owner(LAYERS_OWNER);
+    memset(layers, 0, sizeof(*layers));
+}
+
+int layers_create_quad(struct layers* layers, XrSession session, int width, int height, XrPosef pose,
+                       XrExtent2Df size) {
+    int id = 0;
+    while (id < LAYERS_MAX_QUADS && layers->quads[id].used) {
+        id++;
+    }
+    if (id == LAYERS_MAX_QUADS) {
+        LOGE("out of quad layers, can't create (%d %d)", width, height);
+        exit(EXIT_FAILURE);
+    }
+    struct quad_layer* quad = &layers->quads[id];
+
+    XrSwapchainCreateInfo swapchain_info = { XR_TYPE_SWAPCHAIN_CREATE_INFO };
+    swapchain_info.usageFlags = XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+    swapchain_info.format = GL_SRGB8_ALPHA8;
+    swapchain_info.sampleCount = 1;
+    swapchain_info.width = width;
+    swapchain_info.height = height;
+    swapchain_info.faceCount = 1;
+    swapchain_info.arraySize = 1;
+    swapchain_info.mipCount = 1;
+    XrResult result = xrCreateSwapchain(session, &swapchain_info, &quad->swapchain);
+    if (!XR_SUCCEEDED(result)) {
+        LOGE("can't create quad layer swapchain (%d %d): %d", width, height, result);
+        exit(EXIT_FAILURE);
+    }
+    quad->image_count = 0;
+    XRCMD(xrEnumerateSwapchainImages(quad->swapchain, 0, &quad->image_count, NULL));
+    if (quad->image_count == 0) {
+        LOGE("quad layer swapchain (%d %d) has no images", width, height);
+        exit(EXIT_FAILURE);
+    }
+    resources_track(RESOURCE_XR_SWAPCHAIN, RESOURCE_HANDLE(quad->swapchain),
+                    (uint64_t)quad->image_count * width * height * 4, LAYERS_OWNER);
+    // lives as long as the app, like the quad itself
+    quad->images = arena_push_array(layers->arena, XrSwapchainImageOpenGLESKHR, quad->image_count);
+    quad->pixels = arena_push_array(layers->arena, uint32_t, (size_t)width * height);
+    quad->upload = arena_push_array(layers->arena, uint32_t, (size_t)width * height);
+    for (uint32_t i = 0; i < quad->image_count; i++) {
+        quad->images[i] = (XrSwapchainImageOpenGLESKHR) { XR_TYPE_SWAPCHAIN_IMAGE_OPENGL_ES_KHR };
+    }
+    XRCMD(xrEnumerateSwapchainImages(quad->swapchain, quad->image_count, &quad->image_count,
+                                     (XrSwapchainImageBaseHeader*)quad->images));
+
+    quad->used = true;
+    quad->visible = true;
+    quad->dirty = true;
+    quad->width = width;
+    quad->height = height;
+    quad->pose = pose;
+    quad->size = size;
+    LOGI("quad layer %d (%d %d), %u images", id, width, height, quad->image_count);
+    return id;
+}
+
+uint32_t* layers_quad_pixels(struct layers* layers, int quad) {
+    return layers->quads[quad].pixels;
+}
+
+void layers_quad_dirty(struct layers* layers, int quad) {
+    layers->quads[quad].dirty = true;
+}
+
+void layers_quad_visible(struct layers* layers, int quad, bool visible) {
+    layers->quads[quad].visible = visible;
+}
+
+static void layers_upload(struct quad_layer* quad) {
+    // left as is when the acquire fails; the quad stays dirty and is tried again next frame
+    uint32_t index = quad->image_count;
+    XrSwapchainImageAcquireInfo acquire_info = { XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO };
+    XRCMD(xrAcquireSwapchainImage(quad->swapchain, &acquire_info, &index));
+    if (index >= quad->image_count) {
+        return;
+    }
+    XrSwapchainImageWaitInfo wait_info = { XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO };
+    wait_info.timeout = XR_INFINITE_DURATION;
+    XRCMD(xrWaitSwapchainImage(quad->swapchain, &wait_info));
+
+    // the image is top row first, textures are bottom row first
+    size_t row_bytes = (size_t)quad->width * sizeof(*quad->pixels);
+    for (int row = 0; row < quad->height; row++) {
+        memcpy(quad->upload + (size_t)(quad->height - 1 - row) * quad->width,
+               quad->pixels + (size_t)row * quad->width, row_bytes);
+    }
+    glBindTexture(GL_TEXTURE_2D, quad->images[index].image);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, quad->width, quad->height, GL_RGBA, GL_UNSIGNED_BYTE, quad->upload);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    XrSwapchainImageReleaseInfo release_info = { XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO };
+    XRCMD(xrReleaseSwapchainImage(quad->swapchain, &release_info));
+    quad->dirty = false;
+    quad->uploaded = true;
+    quad->uploads++;
+}
+
+void layers_update(struct layers* layers) {
+    TRACE_SCOPE("layers_update");
+    for (int i = 0; i < LAYERS_MAX_QUADS; i++) {
+        struct quad_layer* quad = &layers->quads[i];
+        if (quad->used && quad->visible && quad->dirty) {
+            layers_upload(quad);
+        }
+    }
+}
+
+uint32_t layers_submit(struct layers* layers, XrSpace space, const XrCompositionLayerBaseHeader** out,
+                       uint32_t capacity) {
+    uint32_t count = 0;
+    for (int i = 0; i < LAYERS_MAX_QUADS && count < capacity; i++) {
+        struct quad_layer* quad = &layers->quads[i];
+        if (!quad->used || !quad->visible || !quad->uploaded) {
+            continue;
+        }
+        XrCompositionLayerQuad* layer = &layers->submitted[i];
+        *layer = (XrCompositionLayerQuad) { XR_TYPE_COMPOSITION_LAYER_QUAD };
+        layer->layerFlags = XR_COMPOSITION_LAYER_BLEND_TEXTURE_SOURCE_ALPHA_BIT;
+        layer->space = space;
+        layer->eyeVisibility = XR_EYE_VISIBILITY_BOTH;
+        layer->subImage.swapchain = quad->swapchain;
+        layer->subImage.imageRect.offset = (XrOffset2Di) { 0, 0 };
+        layer->subImage.imageRect.extent = (XrExtent2Di) { quad->width, quad->height };
+        layer->pose = quad->pose;
+        layer->size = quad->size;
+        out[count++] = (const XrCompositionLayerBaseHeader*)layer;
+    }
+    return count;
+}
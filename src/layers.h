@@ -0,0 +1,68 @@
+#ifndef _LAYERS_H
+#define _LAYERS_H
+
+#include "arena.h"
+
+#define XR_USE_PLATFORM_ANDROID
+#define XR_USE_GRAPHICS_API_OPENGL_ES
+#include <EGL/egl.h>
+#include <openxr/openxr.h>
+#include <openxr/openxr_platform.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Compositor quad layers for UI panels. Each quad owns a small swapchain and
+// a CPU side RGBA8 image; the image is only uploaded when it was marked
+// dirty, otherwise the compositor keeps sampling the last released
+// swapchain image and the quad costs us nothing per frame.
+
+#define LAYERS_MAX_QUADS 4
+
+struct quad_layer {
+    bool used;
+    bool visible;
+    bool dirty;
+    // nothing may be submitted before the first upload
+    bool uploaded;
+    XrSwapchain swapchain;
+    XrSwapchainImageOpenGLESKHR* images;
+    uint32_t image_count;
+    int width;
+    int height;
+    // RGBA8 with premultiplied alpha, top row first
+    uint32_t* pixels;
+    // pixels flipped to bottom row first for glTexSubImage2D
+    uint32_t* upload;
+    XrPosef pose;
+    XrExtent2Df size;
+    uint32_t uploads;
+};
+
+struct layers {
+    // the images of every quad are allocated from here
+    struct arena* arena;
+    struct quad_layer quads[LAYERS_MAX_QUADS];
+    XrCompositionLayerQuad submitted[LAYERS_MAX_QUADS];
+};
+
+void layers_init(struct layers* layers, struct arena* arena);
+void layers_destroy(struct layers* layers);
+
+// Returns the quad id; pose is in the space later passed to layers_submit and
+// size is the quad's extent in meters.
+int layers_create_quad(struct layers* layers, XrSession session, int width, int height, XrPosef pose,
+                       XrExtent2Df size);
+
+// Pixels to draw into, call layers_quad_dirty afterwards.
+uint32_t* layers_quad_pixels(struct layers* layers, int quad);
+void layers_quad_dirty(struct layers* layers, int quad);
+void layers_quad_visible(struct layers* layers, int quad, bool visible);
+
+// Upload dirty quads; needs the GL context.
+void layers_update(struct layers* layers);
+
+// Append composition layers for visible quads, returns how many were added.
+uint32_t layers_submit(struct layers* layers, XrSpace space, const XrCompositionLayerBaseHeader** out,
+                       uint32_t capacity);
+
+#endif /* _LAYERS_H */
@@ -0,0 +1,211 @@
+#define _GNU_SOURCE
+#include "loader.h"
+#include "log.h"
+#include "resources.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOGI(...) log_write(LOG_CATEGORY_GL, LOG_PRIORITY_INFO, __VA_ARGS__)
+#define LOGE(...) log_write(LOG_CATEGORY_GL, LOG_PRIORITY_ERROR, __VA_ARGS__)
+
+// below the render thread, above the log drain
+#define LOADER_NICE 5
+
+static int64_t loader_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void loader_upload(struct load_request* request) {
+    if (request->type == LOAD_BUFFER) {
+        glGenBuffers(1, &request->object);
+        glBindBuffer(request->target, request->object);
+        glBufferData(request->target, (GLsizeiptr)request->size, request->data, GL_STATIC_DRAW);
+        glBindBuffer(request->target, 0);
+    } else if (request->type == LOAD_BUFFER_RANGE) {
+        glBindBuffer(request->target, request->object);
+        glBufferSubData(request->target, (GLintptr)request->offset, (GLsizeiptr)request->size, request->data);
+        glBindBuffer(request->target, 0);
+    } else {
+        glGenTextures(1, &request->object);
+        glBindTexture(GL_TEXTURE_2D, request->object);
+        glTexStorage2D(GL_TEXTURE_2D, 1, request->internal_format, request->width, request->height);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, request->width, request->height, request->format,
+                        request->data_type, request->data);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        // drain the rest, so the next upload only sees its own
+        while (glGetError() != GL_NO_ERROR) {
+        }
+        LOGE("loading %s for %s failed: %x", request->type == LOAD_TEXTURE ? "texture" : "buffer", request->owner,
+             error);
+        if (request->type == LOAD_BUFFER) {
+            glDeleteBuffers(1, &request->object);
+            request->object = 0;
+        } else if (request->type == LOAD_TEXTURE) {
+            glDeleteTextures(1, &request->object);
+            request->object = 0;
+        }
+        atomic_store_explicit(&request->state, LOAD_FAILED, memory_order_release);
+        return;
+    }
+    request->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // the fence has to reach the GPU before another context can wait on it
+    glFlush();
+    atomic_store_explicit(&request->state, LOAD_FENCED, memory_order_release);
+}
+
+static void* loader_main(void* param) {
+    struct loader* loader = param;
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), LOADER_NICE);
+    if (eglMakeCurrent(loader->display, loader->surface, loader->surface, loader->context) == EGL_FALSE) {
+        LOGE("can't make loader EGL context current: %x", eglGetError());
+        exit(EXIT_FAILURE);
+    }
+
+    pthread_mutex_lock(&loader->mutex);
+    while (!loader->stopping) {
+        if (loader->head == loader->tail) {
+            pthread_cond_wait(&loader->wake, &loader->mutex);
+            continue;
+        }
+        struct load_request* request = loader->queue[loader->tail++ & (LOADER_QUEUE_SIZE - 1)];
+        pthread_mutex_unlock(&loader->mutex);
+        loader_upload(request);
+        pthread_mutex_lock(&loader->mutex);
+    }
+    pthread_mutex_unlock(&loader->mutex);
+
+    eglMakeCurrent(loader->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    return NULL;
+}
+
+void loader_create(struct loader* loader, EGLDisplay display, EGLConfig config, EGLContext share_context) {
+    memset(loader, 0, sizeof(*loader));
+    loader->display = display;
+    static const EGLint CONTEXT_ATTRIBS[] = { EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE };
+    loader->context = eglCreateContext(display, config, share_context, CONTEXT_ATTRIBS);
+    if (loader->context == EGL_NO_CONTEXT) {
+        LOGE("can't create loader EGL context: %x", eglGetError());
+        exit(EXIT_FAILURE);
+    }
+    // a context needs a surface to be made current without EGL_KHR_surfaceless_context
+    static const EGLint SURFACE_ATTRIBS[] = { EGL_WIDTH, 16, EGL_HEIGHT, 16, EGL_NONE };
+    loader->surface = eglCreatePbufferSurface(display, config, SURFACE_ATTRIBS);
+    if (loader->surface == EGL_NO_SURFACE) {
+        LOGE("can't create loader EGL pixel buffer surface: %x", eglGetError());
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&loader->mutex, NULL);
+    pthread_cond_init(&loader->wake, NULL);
+    if (pthread_create(&loader->thread, NULL, loader_main, loader) != 0) {
+        LOGE("can't start loader thread");
+        exit(EXIT_FAILURE);
+    }
+    pthread_setname_np(loader->thread, "loader");
+}
+
+void loader_destroy(struct loader* loader) {
+    pthread_mutex_lock(&loader->mutex);
+    loader->stopping = true;
+    pthread_cond_broadcast(&loader->wake);
+    pthread_mutex_unlock(&loader->mutex);
+    pthread_join(loader->thread, NULL);
+    pthread_mutex_destroy(&loader->mutex);
+    pthread_cond_destroy(&loader->wake);
+    eglDestroySurface(loader->display, loader->surface);
+    eglDestroyContext(loader->display, loader->context);
+    LOGI("loader: %u uploads, %llu bytes", loader->completed, (unsigned long long)loader->completed_bytes);
+}
+
+static bool loader_enqueue(struct loader* loader, struct load_request* request) {
+    request->fence = NULL;
+    pthread_mutex_lock(&loader->mutex);
+    if (loader->head - loader->tail == LOADER_QUEUE_SIZE) {
+        pthread_mutex_unlock(&loader->mutex);
+        atomic_store_explicit(&request->state, LOAD_IDLE, memory_order_relaxed);
+        return false;
+    }
+    request->queue_time = loader_time_ns();
+    atomic_store_explicit(&request->state, LOAD_QUEUED, memory_order_relaxed);
+    loader->queue[loader->head++ & (LOADER_QUEUE_SIZE - 1)] = request;
+    pthread_cond_broadcast(&loader->wake);
+    pthread_mutex_unlock(&loader->mutex);
+    return true;
+}
+
+bool loader_upload_buffer(struct loader* loader, struct load_request* request, GLenum target,
+                          const void* data, size_t size, const char* owner) {
+    request->type = LOAD_BUFFER;
+    request->object = 0;
+    request->target = target;
+    request->data = data;
+    request->size = size;
+    request->owner = owner;
+    return loader_enqueue(loader, request);
+}
+
+bool loader_upload_buffer_range(struct loader* loader, struct load_request* request, GLenum target,
+                                GLuint buffer, size_t offset, const void* data, size_t size, const char* owner) {
+    request->type = LOAD_BUFFER_RANGE;
+    request->object = buffer;
+    request->target = target;
+    request->offset = offset;
+    request->data = data;
+    request->size = size;
+    request->owner = owner;
+    return loader_enqueue(loader, request);
+}
+
+bool loader_upload_texture(struct loader* loader, struct load_request* request, GLsizei width, GLsizei height,
+                           GLenum internal_format, GLenum format, GLenum data_type, const void* pixels,
+                           const char* owner) {
+    request->type = LOAD_TEXTURE;
+    request->object = 0;
+    request->width = width;
+    request->height = height;
+    request->internal_format = internal_format;
+    request->format = format;
+    request->data_type = data_type;
+    request->data = pixels;
+    // estimate, see resources_track
+    request->size = (size_t)width * height * 4;
+    request->owner = owner;
+    return loader_enqueue(loader, request);
+}
+
+bool loader_ready(struct loader* loader, struct load_request* request) {
+    int state = atomic_load_explicit(&request->state, memory_order_acquire);
+    if (state != LOAD_FENCED) {
+        return state == LOAD_READY;
+    }
+    // a zero timeout only polls
+    GLenum status = glClientWaitSync(request->fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return false;
+    }
+    glDeleteSync(request->fence);
+    request->fence = NULL;
+    if (request->type == LOAD_BUFFER) {
+        resources_track(RESOURCE_GL_BUFFER, request->object, request->size, request->owner);
+    } else if (request->type == LOAD_TEXTURE) {
+        resources_track(RESOURCE_GL_TEXTURE, request->object, request->size, request->owner);
+    }
+    atomic_store_explicit(&request->state, LOAD_READY, memory_order_relaxed);
+    loader->completed++;
+    loader->completed_bytes += request->size;
+    LOGI("loaded %s %u for %s in %.1f ms", request->type == LOAD_TEXTURE ? "texture" : "buffer", request->object,
+         request->owner, (loader_time_ns() - request->queue_time) / 1e6);
+    return true;
+}
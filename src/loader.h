@@ -0,0 +1,107 @@
+#ifndef _LOADER_H
+#define _LOADER_H
+
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Uploads buffers and textures on a background thread with its own EGL
+// context, shared with the render context so the objects it creates are
+// usable there. Every upload ends with a fence; the render thread polls it
+// with loader_ready, which never blocks, and only then starts using the
+// object. Container objects (vertex arrays, framebuffers) are not shared
+// between contexts and still have to be made on the render thread.
+//
+// Requests are owned by the caller and their data has to stay valid until
+// loader_ready returns true or the request has failed. Queueing never
+// blocks: when the queue is full the upload functions return false and
+// leave the request idle, to be tried again next frame.
+
+// Must be a power of two.
+#define LOADER_QUEUE_SIZE 64
+
+enum load_type {
+    LOAD_BUFFER,
+    // into part of an existing buffer, which is not registered again
+    LOAD_BUFFER_RANGE,
+    LOAD_TEXTURE,
+};
+
+enum load_state {
+    LOAD_IDLE,
+    LOAD_QUEUED,
+    // uploaded, waiting for the GPU to finish with it
+    LOAD_FENCED,
+    LOAD_READY,
+    // GL raised an error; the object was deleted and is never registered
+    LOAD_FAILED,
+};
+
+struct load_request {
+    enum load_type type;
+    const void* data;
+    const char* owner;
+    // LOAD_BUFFER, LOAD_BUFFER_RANGE
+    GLenum target;
+    size_t size;
+    // LOAD_BUFFER_RANGE
+    size_t offset;
+    // LOAD_TEXTURE, a single level
+    GLsizei width;
+    GLsizei height;
+    GLenum internal_format;
+    GLenum format;
+    GLenum data_type;
+
+    // valid once loader_ready returns true; the target buffer for LOAD_BUFFER_RANGE
+    GLuint object;
+    GLsync fence;
+    atomic_int state;
+    int64_t queue_time;
+};
+
+struct loader {
+    EGLDisplay display;
+    EGLContext context;
+    EGLSurface surface;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    struct load_request* queue[LOADER_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+    bool stopping;
+    // render thread only
+    uint32_t completed;
+    uint64_t completed_bytes;
+};
+
+void loader_create(struct loader* loader, EGLDisplay display, EGLConfig config, EGLContext share_context);
+
+// Uploads still in the queue are dropped; objects that were uploaded but
+// never collected go away with the contexts.
+void loader_destroy(struct loader* loader);
+
+bool loader_upload_buffer(struct loader* loader, struct load_request* request, GLenum target,
+                          const void* data, size_t size, const char* owner);
+// The buffer has to have been created, and the creating context flushed,
+// before the request is queued.
+bool loader_upload_buffer_range(struct loader* loader, struct load_request* request, GLenum target,
+                                GLuint buffer, size_t offset, const void* data, size_t size, const char* owner);
+bool loader_upload_texture(struct loader* loader, struct load_request* request, GLsizei width, GLsizei height,
+                           GLenum internal_format, GLenum format, GLenum data_type, const void* pixels,
+                           const char* owner);
+
+// Render thread only. True once the object can be used; registers it with
+// the resource registry the first time.
+bool loader_ready(struct loader* loader, struct load_request* request);
+
+static inline enum load_state loader_state(const struct load_request* request) {
+    return (enum load_state)atomic_load_explicit(&request->state, memory_order_acquire);
+}
+
+#endif /* _LOADER_H */
@@ -0,0 +1,267 @@
+#include "log.h"
+#ifdef __ANDROID__
+#include <android/log.h>
+#endif
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/futex.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char* TAG = "hello_quest";
+
+// Must be a power of two.
+#define LOG_RING_SIZE 256
+#define LOG_MESSAGE_SIZE 240
+#define LOG_DROP_REPORT_INTERVAL_NS 5000000000LL
+// nice value of the drain thread; it should never compete with the frame loop
+#define LOG_DRAIN_NICE 10
+
+// Per-category rate limit: a sustained rate of LOG_RATE_PER_SECOND messages
+// with bursts of up to LOG_RATE_BURST.
+#define LOG_RATE_PER_SECOND 200
+#define LOG_RATE_BURST 100
+
+static const char* CATEGORY_NAMES[LOG_CATEGORY_END] = {
+        "app", "gl", "xr",
+};
+
+struct log_slot {
+    // Vyukov bounded queue: equals the ring position when the slot is free
+    // for that position, position + 1 once the message has been published.
+    atomic_uint sequence;
+    uint8_t category;
+    uint8_t priority;
+    char text[LOG_MESSAGE_SIZE];
+};
+
+static struct log_slot ring[LOG_RING_SIZE];
+static atomic_uint ring_tail;
+static unsigned int ring_head;
+// published messages the drain thread has not taken yet; it sleeps on this
+// word while it is 0, and the producer that takes it from 0 wakes it
+static atomic_int pending;
+
+// theoretical arrival time of the next message per category (GCRA)
+static atomic_llong rate_tat[LOG_CATEGORY_END];
+
+static atomic_ullong written[LOG_CATEGORY_END];
+static atomic_ullong rate_limited[LOG_CATEGORY_END];
+static atomic_ullong overflowed[LOG_CATEGORY_END];
+
+static atomic_bool started;
+static atomic_bool stopping;
+static pthread_t drain_thread;
+
+static int64_t log_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void log_futex_wake(atomic_int* word) {
+    syscall(SYS_futex, (int*)word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+// Returns straight away if word is no longer expected.
+static void log_futex_wait(atomic_int* word, int expected, int64_t timeout_ns) {
+    struct timespec timeout = { timeout_ns / 1000000000LL, timeout_ns % 1000000000LL };
+    syscall(SYS_futex, (int*)word, FUTEX_WAIT_PRIVATE, expected, &timeout, NULL, 0);
+}
+
+static void log_output(uint8_t category, uint8_t priority, const char* text) {
+#ifdef __ANDROID__
+    static const int ANDROID_PRIORITIES[] = {
+            ANDROID_LOG_VERBOSE, ANDROID_LOG_INFO, ANDROID_LOG_WARN, ANDROID_LOG_ERROR,
+    };
+    if (category == LOG_CATEGORY_APP) {
+        __android_log_write(ANDROID_PRIORITIES[priority], TAG, text);
+    } else {
+        __android_log_print(ANDROID_PRIORITIES[priority], TAG, "[%s] %s", CATEGORY_NAMES[category], text);
+    }
+#else
+    static const char PRIORITY_LETTERS[] = { 'V', 'I', 'W', 'E' };
+    fprintf(stderr, "%c/%s: [%s] %s\n", PRIORITY_LETTERS[priority], TAG, CATEGORY_NAMES[category], text);
+#endif
+}
+
+static bool log_rate_allow(enum log_category category) {
+    static const int64_t INTERVAL = 1000000000LL / LOG_RATE_PER_SECOND;
+    static const int64_t TOLERANCE = INTERVAL * (LOG_RATE_BURST - 1);
+    int64_t now = log_time_ns();
+    long long tat = atomic_load_explicit(&rate_tat[category], memory_order_relaxed);
+    for (;;) {
+        int64_t base = tat > now ? tat : now;
+        if (base - now > TOLERANCE) {
+            return false;
+        }
+        if (atomic_compare_exchange_weak_explicit(&rate_tat[category], &tat, base + INTERVAL,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+static struct log_slot* log_claim() {
+    unsigned int pos = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    for (;;) {
+        struct log_slot* slot = &ring[pos & (LOG_RING_SIZE - 1)];
+        unsigned int sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int diff = (int)(sequence - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring_tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                return slot;
+            }
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+        }
+    }
+}
+
+void log_write(enum log_category category, enum log_priority priority, const char* format, ...) {
+    if (priority < LOG_PRIORITY_ERROR && !log_rate_allow(category)) {
+        atomic_fetch_add_explicit(&rate_limited[category], 1, memory_order_relaxed);
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    if (!atomic_load_explicit(&started, memory_order_acquire)) {
+        char text[LOG_MESSAGE_SIZE];
+        vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+        log_output(category, priority, text);
+        atomic_fetch_add_explicit(&written[category], 1, memory_order_relaxed);
+        return;
+    }
+
+    struct log_slot* slot = log_claim();
+    if (slot == NULL) {
+        va_end(args);
+        atomic_fetch_add_explicit(&overflowed[category], 1, memory_order_relaxed);
+        return;
+    }
+    slot->category = category;
+    slot->priority = priority;
+    vsnprintf(slot->text, sizeof(slot->text), format, args);
+    va_end(args);
+    unsigned int sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+    atomic_store_explicit(&slot->sequence, sequence + 1, memory_order_release);
+    atomic_fetch_add_explicit(&written[category], 1, memory_order_relaxed);
+    if (atomic_fetch_add_explicit(&pending, 1, memory_order_release) == 0) {
+        log_futex_wake(&pending);
+    }
+}
+
+static int log_drain() {
+    int count = 0;
+    for (;;) {
+        struct log_slot* slot = &ring[ring_head & (LOG_RING_SIZE - 1)];
+        unsigned int sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (sequence != ring_head + 1) {
+            // empty, or the next producer has not finished formatting yet
+            return count;
+        }
+        log_output(slot->category, slot->priority, slot->text);
+        atomic_store_explicit(&slot->sequence, ring_head + LOG_RING_SIZE, memory_order_release);
+        ring_head++;
+        count++;
+    }
+}
+
+static void log_report_drops(uint64_t reported[LOG_CATEGORY_END]) {
+    for (int category = 0; category < LOG_CATEGORY_END; ++category) {
+        uint64_t dropped = atomic_load_explicit(&rate_limited[category], memory_order_relaxed) +
+                           atomic_load_explicit(&overflowed[category], memory_order_relaxed);
+        if (dropped != reported[category]) {
+            char text[LOG_MESSAGE_SIZE];
+            snprintf(text, sizeof(text), "log: dropped %llu %s messages (%llu rate limited, %llu ring full)",
+                     (unsigned long long)(dropped - reported[category]), CATEGORY_NAMES[category],
+                     (unsigned long long)atomic_load(&rate_limited[category]),
+                     (unsigned long long)atomic_load(&overflowed[category]));
+            log_output(LOG_CATEGORY_APP, LOG_PRIORITY_WARN, text);
+            reported[category] = dropped;
+        }
+    }
+}
+
+static void* log_drain_main(void* param) {
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), LOG_DRAIN_NICE);
+
+    uint64_t reported[LOG_CATEGORY_END] = { 0 };
+    int64_t report_time = log_time_ns();
+    while (!atomic_load_explicit(&stopping, memory_order_acquire)) {
+        int count = log_drain();
+        if (count > 0) {
+            // may go below 0 for a moment, when a message is drained before
+            // its producer counts it
+            atomic_fetch_sub_explicit(&pending, count, memory_order_acquire);
+        } else {
+            // the timeout is only there for the drop report
+            int64_t wait = report_time + LOG_DROP_REPORT_INTERVAL_NS - log_time_ns();
+            if (wait > 0) {
+                log_futex_wait(&pending, 0, wait);
+            }
+        }
+        int64_t now = log_time_ns();
+        if (now - report_time >= LOG_DROP_REPORT_INTERVAL_NS) {
+            log_report_drops(reported);
+            report_time = now;
+        }
+    }
+    log_drain();
+    log_report_drops(reported);
+    return NULL;
+}
+
+void log_init() {
+    if (atomic_load(&started)) {
+        return;
+    }
+    for (unsigned int i = 0; i < LOG_RING_SIZE; ++i) {
+        atomic_init(&ring[i].sequence, i);
+    }
+    atomic_store(&ring_tail, 0);
+    ring_head = 0;
+    atomic_store(&pending, 0);
+    atomic_store(&stopping, false);
+    if (pthread_create(&drain_thread, NULL, log_drain_main, NULL) != 0) {
+        log_output(LOG_CATEGORY_APP, LOG_PRIORITY_ERROR, "log: can't create drain thread, logging synchronously");
+        return;
+    }
+    atomic_store_explicit(&started, true, memory_order_release);
+
+    static bool registered = false;
+    if (!registered) {
+        atexit(log_shutdown);
+        registered = true;
+    }
+}
+
+void log_shutdown() {
+    if (!atomic_exchange(&started, false)) {
+        return;
+    }
+    atomic_store_explicit(&stopping, true, memory_order_release);
+    atomic_fetch_add(&pending, 1);
+    log_futex_wake(&pending);
+    pthread_join(drain_thread, NULL);
+}
+
+void log_get_stats(struct log_stats* stats) {
+    for (int category = 0; category < LOG_CATEGORY_END; ++category) {
+        stats->written[category] = atomic_load_explicit(&written[category], memory_order_relaxed);
+        stats->rate_limited[category] = atomic_load_explicit(&rate_limited[category], memory_order_relaxed);
+        stats->overflowed[category] = atomic_load_explicit(&overflowed[category], memory_order_relaxed);
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef _LOG_H
+#define _LOG_H
+
+#include <stdint.h>
+
+// Asynchronous logging. log_write formats the message straight into a slot
+// of a lock-free multi-producer ring and returns; a low-priority thread
+// drains the ring to logcat (stderr when not built for Android). Messages
+// are rate limited per category, and anything that is rate limited or does
+// not fit in the ring is counted instead of blocking the caller.
+
+enum log_category {
+    LOG_CATEGORY_APP,
+    LOG_CATEGORY_GL,
+    LOG_CATEGORY_XR,
+    LOG_CATEGORY_END,
+};
+
+enum log_priority {
+    LOG_PRIORITY_VERBOSE,
+    LOG_PRIORITY_INFO,
+    LOG_PRIORITY_WARN,
+    // errors are never rate limited
+    LOG_PRIORITY_ERROR,
+};
+
+struct log_stats {
+    uint64_t written[LOG_CATEGORY_END];
+    uint64_t rate_limited[LOG_CATEGORY_END];
+    uint64_t overflowed[LOG_CATEGORY_END];
+};
+
+// Start the drain thread. Messages logged before this are written
+// synchronously. Also registers log_shutdown with atexit, so an
+// error(...); exit(EXIT_FAILURE); sequence still gets its message out.
+void log_init();
+
+// Drain everything still queued and stop the drain thread.
+void log_shutdown();
+
+void log_write(enum log_category category, enum log_priority priority, const char* format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+void log_get_stats(struct log_stats* stats);
+
+#endif /* _LOG_H */
@@ -0,0 +1,116 @@
+#include "pacing.h"
+#include <math.h>
+#include <string.h>
+
+// step down when more than PACING_MISS_LIMIT of PACING_WINDOW frames miss
+#define PACING_WINDOW 90
+#define PACING_MISS_LIMIT 4
+// step up after PACING_UPGRADE_FRAMES frames within PACING_HEADROOM of the
+// next rate's period
+#define PACING_UPGRADE_FRAMES 600
+#define PACING_HEADROOM 0.8f
+#define PACING_SETTLE_FRAMES 30
+#define PACING_SMOOTHING 0.05f
+
+static uint32_t pacing_find(const struct pacing* pacing, float rate) {
+    uint32_t best = 0;
+    for (uint32_t i = 0; i < pacing->rate_count; i++) {
+        if (fabsf(pacing->rates[i] - rate) < fabsf(pacing->rates[best] - rate)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+static void pacing_reset(struct pacing* pacing) {
+    pacing->window_frames = 0;
+    pacing->window_misses = 0;
+    pacing->headroom_frames = 0;
+    pacing->settle_frames = PACING_SETTLE_FRAMES;
+}
+
+void pacing_init(struct pacing* pacing, const float* rates, uint32_t rate_count, float current_rate,
+                 uint32_t interval) {
+    memset(pacing, 0, sizeof(*pacing));
+    if (rate_count > PACING_MAX_RATES) {
+        rate_count = PACING_MAX_RATES;
+    }
+    // insertion sort, runtimes don't promise an order
+    for (uint32_t i = 0; i < rate_count; i++) {
+        uint32_t j = i;
+        while (j > 0 && pacing->rates[j - 1] > rates[i]) {
+            pacing->rates[j] = pacing->rates[j - 1];
+            j--;
+        }
+        pacing->rates[j] = rates[i];
+    }
+    pacing->rate_count = rate_count;
+    pacing->interval = interval > 0 ? interval : 1;
+    if (rate_count > 0) {
+        pacing->current = pacing_find(pacing, current_rate);
+    }
+    pacing_reset(pacing);
+}
+
+float pacing_rate(const struct pacing* pacing) {
+    return pacing->rate_count > 0 ? pacing->rates[pacing->current] : 0.0f;
+}
+
+void pacing_rate_changed(struct pacing* pacing, float rate) {
+    if (pacing->rate_count > 0) {
+        pacing->current = pacing_find(pacing, rate);
+    }
+    pacing_reset(pacing);
+}
+
+static float pacing_budget_ms(const struct pacing* pacing, uint32_t index) {
+    return 1000.0f * pacing->interval / pacing->rates[index];
+}
+
+bool pacing_missed(const struct pacing* pacing, int64_t previous_display_time, int64_t display_time,
+                   int64_t display_period) {
+    if (previous_display_time == 0) {
+        return false;
+    }
+    // half a period of slack for jitter in the predicted times
+    return display_time - previous_display_time > display_period * pacing->interval + display_period / 2;
+}
+
+bool pacing_update(struct pacing* pacing, float frame_ms, bool missed, float* rate) {
+    if (pacing->rate_count < 2) {
+        return false;
+    }
+    if (pacing->settle_frames > 0) {
+        pacing->settle_frames--;
+        pacing->frame_ms = frame_ms;
+        return false;
+    }
+    pacing->frame_ms += PACING_SMOOTHING * (frame_ms - pacing->frame_ms);
+
+    pacing->window_misses += missed ? 1 : 0;
+    if (++pacing->window_frames == PACING_WINDOW) {
+        bool step_down = pacing->window_misses > PACING_MISS_LIMIT && pacing->current > 0;
+        pacing->window_frames = 0;
+        pacing->window_misses = 0;
+        if (step_down) {
+            pacing->current--;
+            pacing_reset(pacing);
+            *rate = pacing->rates[pacing->current];
+            return true;
+        }
+    }
+
+    uint32_t next = pacing->current + 1;
+    if (next < pacing->rate_count && !missed &&
+        pacing->frame_ms < PACING_HEADROOM * pacing_budget_ms(pacing, next)) {
+        if (++pacing->headroom_frames >= PACING_UPGRADE_FRAMES) {
+            pacing->current = next;
+            pacing_reset(pacing);
+            *rate = pacing->rates[pacing->current];
+            return true;
+        }
+    } else {
+        pacing->headroom_frames = 0;
+    }
+    return false;
+}
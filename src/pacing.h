@@ -0,0 +1,46 @@
+#ifndef _PACING_H
+#define _PACING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Display refresh rate policy. Runs at the highest rate the measured frame
+// time can sustain: steps down as soon as too many frames in a window miss
+// their deadline, and only steps up after a long stretch with enough
+// headroom to fit the next rate's period. Pure logic, no OpenXR calls.
+
+#define PACING_MAX_RATES 8
+
+struct pacing {
+    // supported rates in Hz, ascending
+    float rates[PACING_MAX_RATES];
+    uint32_t rate_count;
+    uint32_t current;
+    // display refreshes per app frame, 2 when space warp halves our rate
+    uint32_t interval;
+    uint32_t window_frames;
+    uint32_t window_misses;
+    uint32_t headroom_frames;
+    // frames to ignore after a change while the runtime settles
+    uint32_t settle_frames;
+    float frame_ms;
+};
+
+void pacing_init(struct pacing* pacing, const float* rates, uint32_t rate_count, float current_rate,
+                 uint32_t interval);
+
+// Whether a frame missed its display slot: the runtime skipped a display
+// period for it on top of the interval. previous is 0 for the first frame.
+bool pacing_missed(const struct pacing* pacing, int64_t previous_display_time, int64_t display_time,
+                   int64_t display_period);
+
+// Feed one frame's work time and whether it missed its display slot.
+// Returns true with the rate to request when the policy wants a change.
+bool pacing_update(struct pacing* pacing, float frame_ms, bool missed, float* rate);
+
+// The runtime may change the rate on its own, e.g. when the user does.
+void pacing_rate_changed(struct pacing* pacing, float rate);
+
+float pacing_rate(const struct pacing* pacing);
+
+#endif /* _PACING_H */
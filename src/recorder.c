@@ -0,0 +1,200 @@
+#include "recorder.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LOGI(...) log_write(LOG_CATEGORY_APP, LOG_PRIORITY_INFO, __VA_ARGS__)
+#define LOGE(...) log_write(LOG_CATEGORY_APP, LOG_PRIORITY_ERROR, __VA_ARGS__)
+
+// a few seconds of frames; flushes come sooner, see RECORDER_FLUSH_FRAMES
+#define RECORDER_BUFFER_SIZE (64 * 1024)
+// about a second; the app is usually killed rather than closed, and
+// whatever is still buffered then is lost
+#define RECORDER_FLUSH_FRAMES 72
+
+struct recorder_file_header {
+    uint32_t magic;
+    uint32_t version;
+};
+
+static void recorder_fail(struct recorder* recorder) {
+    LOGE("can't write trace, recording stopped");
+    fclose(recorder->file);
+    recorder->file = NULL;
+    recorder->mode = RECORDER_OFF;
+}
+
+static void recorder_write(struct recorder* recorder, enum record_type type, const void* payload, uint32_t size) {
+    struct record_header header = { type, size };
+    if (fwrite(&header, sizeof(header), 1, recorder->file) != 1 ||
+        fwrite(payload, size, 1, recorder->file) != 1) {
+        recorder_fail(recorder);
+    }
+}
+
+// Returns the payload of the next record, or NULL at the end of the trace.
+static const void* recorder_peek(const struct recorder* recorder, struct record_header* header) {
+    if (recorder->offset + sizeof(*header) > recorder->size) {
+        return NULL;
+    }
+    memcpy(header, recorder->data + recorder->offset, sizeof(*header));
+    if (recorder->offset + sizeof(*header) + header->size > recorder->size) {
+        return NULL;
+    }
+    return recorder->data + recorder->offset + sizeof(*header);
+}
+
+static void recorder_skip(struct recorder* recorder, const struct record_header* header) {
+    recorder->offset += sizeof(*header) + header->size;
+}
+
+// Report and step over session state changes up to the next frame or views.
+static void recorder_skip_events(struct recorder* recorder) {
+    struct record_header header;
+    const void* payload;
+    while ((payload = recorder_peek(recorder, &header)) != NULL && header.type == RECORD_SESSION_STATE) {
+        if (header.size == sizeof(struct record_session_state)) {
+            const struct record_session_state* state = payload;
+            LOGI("trace: session state %u at frame %llu", state->state, (unsigned long long)recorder->frames);
+        }
+        recorder_skip(recorder, &header);
+    }
+}
+
+static bool recorder_load(struct recorder* recorder, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        LOGE("can't open trace %s", path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    struct recorder_file_header header;
+    if (size < (long)sizeof(header) || fread(&header, sizeof(header), 1, file) != 1 ||
+        header.magic != RECORDER_MAGIC || header.version != RECORDER_VERSION) {
+        LOGE("%s is not a version %d trace", path, RECORDER_VERSION);
+        fclose(file);
+        return false;
+    }
+    recorder->size = (size_t)size - sizeof(header);
+    recorder->data = malloc(recorder->size);
+    if (recorder->data == NULL || fread(recorder->data, 1, recorder->size, file) != recorder->size) {
+        LOGE("can't read trace %s", path);
+        free(recorder->data);
+        recorder->data = NULL;
+        fclose(file);
+        return false;
+    }
+    fclose(file);
+    return true;
+}
+
+void recorder_init(struct recorder* recorder, enum recorder_mode mode, const char* path) {
+    memset(recorder, 0, sizeof(*recorder));
+    if (mode == RECORDER_RECORD) {
+        recorder->file = fopen(path, "wb");
+        if (recorder->file == NULL) {
+            LOGE("can't create trace %s", path);
+            return;
+        }
+        setvbuf(recorder->file, NULL, _IOFBF, RECORDER_BUFFER_SIZE);
+        struct recorder_file_header header = { RECORDER_MAGIC, RECORDER_VERSION };
+        fwrite(&header, sizeof(header), 1, recorder->file);
+        LOGI("recording trace to %s", path);
+    } else if (mode == RECORDER_REPLAY) {
+        if (!recorder_load(recorder, path)) {
+            return;
+        }
+        LOGI("replaying trace %s (%zu bytes)", path, recorder->size);
+    }
+    recorder->mode = mode;
+}
+
+void recorder_close(struct recorder* recorder) {
+    if (recorder->mode == RECORDER_RECORD) {
+        fclose(recorder->file);
+        LOGI("trace recorded, %llu frames", (unsigned long long)recorder->frames);
+    }
+    free(recorder->data);
+    memset(recorder, 0, sizeof(*recorder));
+}
+
+XrTime recorder_frame(struct recorder* recorder, const XrFrameState* frame_state) {
+    if (recorder->mode == RECORDER_RECORD) {
+        struct record_frame frame = { frame_state->predictedDisplayTime, frame_state->predictedDisplayPeriod,
+                                      frame_state->shouldRender, 0 };
+        recorder_write(recorder, RECORD_FRAME, &frame, sizeof(frame));
+        recorder->frames++;
+        if (recorder->mode == RECORDER_RECORD && recorder->frames % RECORDER_FLUSH_FRAMES == 0 &&
+            fflush(recorder->file) != 0) {
+            recorder_fail(recorder);
+        }
+        return frame_state->predictedDisplayTime;
+    }
+    if (!recorder_replaying(recorder)) {
+        return frame_state->predictedDisplayTime;
+    }
+    struct record_header header;
+    const void* payload;
+    for (;;) {
+        recorder_skip_events(recorder);
+        payload = recorder_peek(recorder, &header);
+        if (payload == NULL || header.type == RECORD_FRAME) {
+            break;
+        }
+        // views of the previous frame that weren't asked for
+        recorder_skip(recorder, &header);
+    }
+    if (payload == NULL || header.size != sizeof(struct record_frame)) {
+        LOGI("trace replayed, %llu frames", (unsigned long long)recorder->frames);
+        recorder->finished = true;
+        return frame_state->predictedDisplayTime;
+    }
+    struct record_frame frame;
+    memcpy(&frame, payload, sizeof(frame));
+    recorder_skip(recorder, &header);
+    recorder->frames++;
+    return frame.display_time;
+}
+
+void recorder_views(struct recorder* recorder, XrViewState* view_state, XrView* views, uint32_t view_count) {
+    if (view_count > RECORDER_MAX_VIEWS) {
+        view_count = RECORDER_MAX_VIEWS;
+    }
+    if (recorder->mode == RECORDER_RECORD) {
+        struct record_views record = { view_state->viewStateFlags, view_count, 0 };
+        for (uint32_t i = 0; i < view_count; i++) {
+            record.poses[i] = views[i].pose;
+            record.fovs[i] = views[i].fov;
+        }
+        recorder_write(recorder, RECORD_VIEWS, &record, sizeof(record));
+        return;
+    }
+    if (!recorder_replaying(recorder)) {
+        return;
+    }
+    recorder_skip_events(recorder);
+    struct record_header header;
+    const void* payload = recorder_peek(recorder, &header);
+    if (payload == NULL || header.type != RECORD_VIEWS || header.size != sizeof(struct record_views)) {
+        // the recorded frame wasn't rendered, keep the live views
+        return;
+    }
+    struct record_views record;
+    memcpy(&record, payload, sizeof(record));
+    recorder_skip(recorder, &header);
+    view_state->viewStateFlags = record.view_state_flags;
+    for (uint32_t i = 0; i < view_count && i < record.view_count; i++) {
+        views[i].pose = record.poses[i];
+        views[i].fov = record.fovs[i];
+    }
+}
+
+void recorder_session_state(struct recorder* recorder, XrSessionState state, XrTime time) {
+    if (recorder->mode != RECORDER_RECORD) {
+        return;
+    }
+    struct record_session_state record = { time, (uint32_t)state, 0 };
+    recorder_write(recorder, RECORD_SESSION_STATE, &record, sizeof(record));
+}
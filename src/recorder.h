@@ -0,0 +1,89 @@
+#ifndef _RECORDER_H
+#define _RECORDER_H
+
+#include <openxr/openxr.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Records what the runtime told us each frame - frame timing, located
+// views and session state changes - to a compact binary trace, and plays
+// such a trace back so two builds can be measured against the same head
+// motion. Playback still runs the live session: xrWaitFrame paces the
+// loop and xrEndFrame gets the live display time, but the scene is
+// animated with the recorded time and rendered from the recorded views.
+// Recorded session state changes are reported at the frame they happened
+// and not applied; the live runtime owns the session.
+
+#define RECORDER_MAGIC 0x43525148u /* "HQRC" */
+#define RECORDER_VERSION 1
+#define RECORDER_MAX_VIEWS 2
+
+enum recorder_mode {
+    RECORDER_OFF,
+    RECORDER_RECORD,
+    RECORDER_REPLAY,
+};
+
+enum record_type {
+    RECORD_FRAME,
+    RECORD_VIEWS,
+    RECORD_SESSION_STATE,
+};
+
+struct record_header {
+    uint32_t type;
+    uint32_t size;
+};
+
+struct record_frame {
+    XrTime display_time;
+    XrDuration display_period;
+    uint32_t should_render;
+    uint32_t pad;
+};
+
+struct record_views {
+    XrViewStateFlags view_state_flags;
+    uint32_t view_count;
+    uint32_t pad;
+    XrPosef poses[RECORDER_MAX_VIEWS];
+    XrFovf fovs[RECORDER_MAX_VIEWS];
+};
+
+struct record_session_state {
+    XrTime time;
+    uint32_t state;
+    uint32_t pad;
+};
+
+struct recorder {
+    enum recorder_mode mode;
+    FILE* file;
+    // RECORDER_REPLAY: the whole trace
+    uint8_t* data;
+    size_t size;
+    size_t offset;
+    bool finished;
+    uint64_t frames;
+};
+
+// Falls back to RECORDER_OFF if the trace can't be opened.
+void recorder_init(struct recorder* recorder, enum recorder_mode mode, const char* path);
+void recorder_close(struct recorder* recorder);
+
+static inline bool recorder_replaying(const struct recorder* recorder) {
+    return recorder->mode == RECORDER_REPLAY && !recorder->finished;
+}
+
+// Once per xrWaitFrame. Returns the time the frame should be simulated at:
+// the live display time, or the recorded one while replaying.
+XrTime recorder_frame(struct recorder* recorder, const XrFrameState* frame_state);
+
+// After xrLocateViews; while replaying, replaces the views with the
+// recorded ones of this frame if it had any.
+void recorder_views(struct recorder* recorder, XrViewState* view_state, XrView* views, uint32_t view_count);
+
+void recorder_session_state(struct recorder* recorder, XrSessionState state, XrTime time);
+
+#endif /* _RECORDER_H */
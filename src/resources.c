@@ -0,0 +1,186 @@
+#include "resources.h"
+#include "log.h"
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+#include <openxr/openxr.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOGI(...) log_write(LOG_CATEGORY_APP, LOG_PRIORITY_INFO, __VA_ARGS__)
+#define LOGE(...) log_write(LOG_CATEGORY_APP, LOG_PRIORITY_ERROR, __VA_ARGS__)
+
+#define MAX_RESOURCES 1024
+
+static const char* TYPE_NAMES[RESOURCE_TYPE_END] = {
+        "gl framebuffer", "gl vertex array", "gl buffer", "gl texture", "gl query", "gl program",
+        "xr swapchain", "xr space", "xr session", "xr debug messenger", "xr instance",
+};
+
+struct resource {
+    enum resource_type type;
+    uint64_t handle;
+    uint64_t bytes;
+    const char* owner;
+};
+
+// kept in creation order, so walking backwards releases newest first
+static struct resource resources[MAX_RESOURCES];
+static int resource_count = 0;
+static struct resource_stats stats;
+
+static int resources_find(enum resource_type type, uint64_t handle) {
+    for (int i = resource_count - 1; i >= 0; --i) {
+        if (resources[i].type == type && resources[i].handle == handle) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static XrInstance resources_instance() {
+    for (int i = 0; i < resource_count; ++i) {
+        if (resources[i].type == RESOURCE_XR_INSTANCE) {
+            return (XrInstance)(uintptr_t)resources[i].handle;
+        }
+    }
+    return XR_NULL_HANDLE;
+}
+
+static void resource_destroy(const struct resource* resource) {
+    GLuint name = (GLuint)resource->handle;
+    switch (resource->type) {
+        case RESOURCE_GL_FRAMEBUFFER:
+            glDeleteFramebuffers(1, &name);
+            break;
+        case RESOURCE_GL_VERTEX_ARRAY:
+            glDeleteVertexArrays(1, &name);
+            break;
+        case RESOURCE_GL_BUFFER:
+            glDeleteBuffers(1, &name);
+            break;
+        case RESOURCE_GL_TEXTURE:
+            glDeleteTextures(1, &name);
+            break;
+        case RESOURCE_GL_QUERY:
+            glDeleteQueries(1, &name);
+            break;
+        case RESOURCE_GL_PROGRAM:
+            glDeleteProgram(name);
+            break;
+        case RESOURCE_XR_SWAPCHAIN:
+            xrDestroySwapchain((XrSwapchain)(uintptr_t)resource->handle);
+            break;
+        case RESOURCE_XR_SPACE:
+            xrDestroySpace((XrSpace)(uintptr_t)resource->handle);
+            break;
+        case RESOURCE_XR_SESSION:
+            xrDestroySession((XrSession)(uintptr_t)resource->handle);
+            break;
+        case RESOURCE_XR_DEBUG_MESSENGER: {
+            PFN_xrDestroyDebugUtilsMessengerEXT destroy_messenger = NULL;
+            xrGetInstanceProcAddr(resources_instance(), "xrDestroyDebugUtilsMessengerEXT",
+                                  (PFN_xrVoidFunction*)&destroy_messenger);
+            if (destroy_messenger != NULL) {
+                destroy_messenger((XrDebugUtilsMessengerEXT)(uintptr_t)resource->handle);
+            }
+            break;
+        }
+        case RESOURCE_XR_INSTANCE:
+            xrDestroyInstance((XrInstance)(uintptr_t)resource->handle);
+            break;
+        default:
+            abort();
+    }
+}
+
+static void resources_remove(int index) {
+    struct resource* resource = &resources[index];
+    stats.count[resource->type]--;
+    stats.bytes[resource->type] -= resource->bytes;
+    stats.total_count--;
+    stats.total_bytes -= resource->bytes;
+    memmove(&resources[index], &resources[index + 1], (resource_count - index - 1) * sizeof(struct resource));
+    resource_count--;
+}
+
+bool resources_track(enum resource_type type, uint64_t handle, uint64_t bytes, const char* owner) {
+    if (resource_count == MAX_RESOURCES) {
+        LOGE("resource registry full, can't track %s %llu (%s)", TYPE_NAMES[type],
+             (unsigned long long)handle, owner);
+        exit(EXIT_FAILURE);
+    }
+    resources[resource_count++] = (struct resource) { type, handle, bytes, owner };
+    stats.count[type]++;
+    stats.bytes[type] += bytes;
+    stats.total_count++;
+    stats.total_bytes += bytes;
+    if (stats.total_bytes > stats.peak_bytes) {
+        stats.peak_bytes = stats.total_bytes;
+    }
+    if (stats.budget_bytes != 0 && stats.total_bytes > stats.budget_bytes) {
+        LOGE("resource budget exceeded by %s %llu (%s): %llu of %llu bytes", TYPE_NAMES[type],
+             (unsigned long long)handle, owner, (unsigned long long)stats.total_bytes,
+             (unsigned long long)stats.budget_bytes);
+        return false;
+    }
+    return true;
+}
+
+void resources_release(enum resource_type type, uint64_t handle) {
+    int index = resources_find(type, handle);
+    if (index < 0) {
+        LOGE("releasing untracked %s %llu", TYPE_NAMES[type], (unsigned long long)handle);
+        return;
+    }
+    resource_destroy(&resources[index]);
+    resources_remove(index);
+}
+
+void resources_release_owner(const char* owner) {
+    for (enum resource_type type = 0; type != RESOURCE_TYPE_END; ++type) {
+        for (int i = resource_count - 1; i >= 0; --i) {
+            if (resources[i].type == type && strcmp(resources[i].owner, owner) == 0) {
+                resource_destroy(&resources[i]);
+                resources_remove(i);
+            }
+        }
+    }
+}
+
+void resources_release_all() {
+    for (enum resource_type type = 0; type != RESOURCE_TYPE_END; ++type) {
+        for (int i = resource_count - 1; i >= 0; --i) {
+            if (resources[i].type == type) {
+                resource_destroy(&resources[i]);
+                resources_remove(i);
+            }
+        }
+    }
+}
+
+void resources_set_budget(uint64_t bytes) {
+    stats.budget_bytes = bytes;
+}
+
+void resources_get_stats(struct resource_stats* out) {
+    *out = stats;
+}
+
+void resources_report(bool verbose) {
+    LOGI("resources: %u live, %.2f MiB (peak %.2f MiB, budget %.2f MiB)", stats.total_count,
+         stats.total_bytes / (1024.0 * 1024.0), stats.peak_bytes / (1024.0 * 1024.0),
+         stats.budget_bytes / (1024.0 * 1024.0));
+    for (enum resource_type type = 0; type != RESOURCE_TYPE_END; ++type) {
+        if (stats.count[type] != 0) {
+            LOGI("  %-18s %4u  %10llu bytes", TYPE_NAMES[type], stats.count[type],
+                 (unsigned long long)stats.bytes[type]);
+        }
+    }
+    if (verbose) {
+        for (int i = 0; i < resource_count; ++i) {
+            LOGI("  %s %llu: %llu bytes (%s)", TYPE_NAMES[resources[i].type],
+                 (unsigned long long)resources[i].handle, (unsigned long long)resources[i].bytes,
+                 resources[i].owner);
+        }
+    }
+}
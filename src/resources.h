@@ -0,0 +1,62 @@
+#ifndef _RESOURCES_H
+#define _RESOURCES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Central registry of every GL object and OpenXR handle the app creates,
+// with an estimated size and an owner tag. Resources are destroyed through
+// the registry, and resources_release_all tears everything down in a fixed
+// order: GL objects before the swapchains whose images they reference,
+// swapchains and spaces before the session, the session before the
+// instance.
+
+// Declared in release order.
+enum resource_type {
+    RESOURCE_GL_FRAMEBUFFER,
+    RESOURCE_GL_VERTEX_ARRAY,
+    RESOURCE_GL_BUFFER,
+    RESOURCE_GL_TEXTURE,
+    RESOURCE_GL_QUERY,
+    RESOURCE_GL_PROGRAM,
+    RESOURCE_XR_SWAPCHAIN,
+    RESOURCE_XR_SPACE,
+    RESOURCE_XR_SESSION,
+    RESOURCE_XR_DEBUG_MESSENGER,
+    RESOURCE_XR_INSTANCE,
+    RESOURCE_TYPE_END,
+};
+
+#define RESOURCE_HANDLE(handle) ((uint64_t)(uintptr_t)(handle))
+
+struct resource_stats {
+    uint32_t count[RESOURCE_TYPE_END];
+    uint64_t bytes[RESOURCE_TYPE_END];
+    uint32_t total_count;
+    uint64_t total_bytes;
+    uint64_t peak_bytes;
+    uint64_t budget_bytes;
+};
+
+// Returns false if tracking this resource pushed the total over the budget;
+// the resource is tracked either way.
+bool resources_track(enum resource_type type, uint64_t handle, uint64_t bytes, const char* owner);
+
+// Destroy a tracked resource and stop tracking it.
+void resources_release(enum resource_type type, uint64_t handle);
+
+// Destroy every resource tagged with owner, in release order.
+void resources_release_owner(const char* owner);
+
+// Destroy everything. GL objects need the context to still be current.
+void resources_release_all();
+
+// 0 disables the budget.
+void resources_set_budget(uint64_t bytes);
+
+void resources_get_stats(struct resource_stats* stats);
+
+// Log live totals per category; with verbose, also every live resource.
+void resources_report(bool verbose);
+
+#endif /* _RESOURCES_H */
@@ -0,0 +1,148 @@
+#include "trace.h"
+
+#if ENABLE_TRACE
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// nesting deeper than this is not traced
+#define TRACE_MAX_DEPTH 64
+
+static atomic_ullong trace_frame;
+
+// Per thread, one bit per open trace_begin, set if it opened a section.
+// Tracing can start or stop between a begin and its end, so the end only
+// closes what its begin opened.
+static __thread uint64_t trace_opened;
+static __thread uint32_t trace_depth;
+
+void trace_set_frame(uint64_t frame_index) {
+    atomic_store_explicit(&trace_frame, frame_index, memory_order_relaxed);
+}
+
+#ifdef __ANDROID__
+
+#include <android/trace.h>
+#include <stdio.h>
+
+void trace_init() {
+}
+
+void trace_shutdown() {
+}
+
+static bool trace_open(const char* name) {
+    if (!ATrace_isEnabled()) {
+        return false;
+    }
+    char section[128];
+    snprintf(section, sizeof(section), "%s #%llu", name,
+             (unsigned long long)atomic_load_explicit(&trace_frame, memory_order_relaxed));
+    ATrace_beginSection(section);
+    return true;
+}
+
+static void trace_close(const char* name) {
+    ATrace_endSection();
+}
+
+#else
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static FILE* trace_file = NULL;
+static bool trace_first_event = true;
+
+static double trace_time_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static bool trace_event(const char* name, char phase) {
+    if (trace_file == NULL) {
+        return false;
+    }
+    double ts = trace_time_us();
+    long tid = syscall(SYS_gettid);
+    unsigned long long frame = atomic_load_explicit(&trace_frame, memory_order_relaxed);
+    pthread_mutex_lock(&trace_mutex);
+    bool written = trace_file != NULL;
+    if (written) {
+        fprintf(trace_file, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%ld,"
+                            "\"args\":{\"frame\":%llu}}",
+                trace_first_event ? "" : ",", name, phase, ts, (int)getpid(), tid, frame);
+        trace_first_event = false;
+    }
+    pthread_mutex_unlock(&trace_mutex);
+    return written;
+}
+
+void trace_init() {
+    const char* path = getenv("HELLO_QUEST_TRACE_FILE");
+    if (path == NULL) {
+        path = "hello_quest_trace.json";
+    }
+    pthread_mutex_lock(&trace_mutex);
+    if (trace_file == NULL) {
+        trace_file = fopen(path, "w");
+        if (trace_file != NULL) {
+            fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", trace_file);
+            trace_first_event = true;
+        }
+    }
+    pthread_mutex_unlock(&trace_mutex);
+}
+
+void trace_shutdown() {
+    pthread_mutex_lock(&trace_mutex);
+    if (trace_file != NULL) {
+        fputs("\n]}\n", trace_file);
+        fclose(trace_file);
+        trace_file = NULL;
+    }
+    pthread_mutex_unlock(&trace_mutex);
+}
+
+static bool trace_open(const char* name) {
+    return trace_event(name, 'B');
+}
+
+static void trace_close(const char* name) {
+    trace_event(name, 'E');
+}
+
+#endif // __ANDROID__
+
+void trace_begin(const char* name) {
+    uint32_t depth = trace_depth++;
+    if (depth >= TRACE_MAX_DEPTH) {
+        return;
+    }
+    uint64_t bit = 1ULL << depth;
+    if (trace_open(name)) {
+        trace_opened |= bit;
+    } else {
+        trace_opened &= ~bit;
+    }
+}
+
+void trace_end(const char* name) {
+    if (trace_depth == 0) {
+        return;
+    }
+    uint32_t depth = --trace_depth;
+    if (depth < TRACE_MAX_DEPTH && (trace_opened & (1ULL << depth))) {
+        trace_opened &= ~(1ULL << depth);
+        trace_close(name);
+    }
+}
+
+#endif // ENABLE_TRACE
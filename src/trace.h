@@ -0,0 +1,62 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdint.h>
+
+// Scoped CPU trace markers. On device they go to ATrace, so they show up in
+// systrace/Perfetto next to the runtime's compositor tracks; elsewhere they
+// are written as a Chrome trace JSON file (chrome://tracing, ui.perfetto.dev).
+// Every begin is tagged with the current frame index.
+//
+// Build with -DENABLE_TRACE=0 to compile every marker out. Tracing defaults
+// to on for debug builds and off for NDEBUG builds.
+
+#ifndef ENABLE_TRACE
+#ifdef NDEBUG
+#define ENABLE_TRACE 0
+#else
+#define ENABLE_TRACE 1
+#endif
+#endif
+
+#if ENABLE_TRACE
+
+// Opens the host trace file ($HELLO_QUEST_TRACE_FILE, defaults to
+// hello_quest_trace.json); a no-op on Android.
+void trace_init();
+void trace_shutdown();
+void trace_set_frame(uint64_t frame_index);
+// trace_end only ends what the matching trace_begin opened, so tracing can
+// start or stop inside a scope.
+void trace_begin(const char* name);
+void trace_end(const char* name);
+
+static inline void trace_scope_end(const char** name) {
+    trace_end(*name);
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#define TRACE_INIT() trace_init()
+#define TRACE_SHUTDOWN() trace_shutdown()
+#define TRACE_FRAME(frame_index) trace_set_frame(frame_index)
+#define TRACE_BEGIN(name) trace_begin(name)
+#define TRACE_END(name) trace_end(name)
+// Ends when the enclosing block is left, including by return.
+#define TRACE_SCOPE(name)                                                          \
+    const char* TRACE_CONCAT(trace_scope_, __LINE__) __attribute__((cleanup(trace_scope_end))) = \
+        (trace_begin(name), (name))
+
+#else
+
+#define TRACE_INIT() ((void)0)
+#define TRACE_SHUTDOWN() ((void)0)
+#define TRACE_FRAME(frame_index) ((void)0)
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_SCOPE(name) ((void)0)
+
+#endif // ENABLE_TRACE
+
+#endif /* _TRACE_H */
@@ -0,0 +1,222 @@
+#include "transforms.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#define LOGI(...) log_write(LOG_CATEGORY_APP, LOG_PRIORITY_INFO, __VA_ARGS__)
+#define LOGE(...) log_write(LOG_CATEGORY_APP, LOG_PRIORITY_ERROR, __VA_ARGS__)
+
+void transforms_create(struct transforms* transforms, uint32_t capacity) {
+    memset(transforms, 0, sizeof(*transforms));
+    size_t per_node = sizeof(uint32_t) * 4 + sizeof(uint8_t) * 2 + sizeof(XrMatrix4x4f) * 2 +
+                      sizeof(void*) * 3;
+    // transforms_sort's temporary copies
+    size_t per_node_sort = sizeof(uint32_t) * 2 + sizeof(uint8_t) * 2 + sizeof(XrMatrix4x4f) * 2;
+    struct arena* arena = &transforms->arena;
+    arena_create(arena, "transforms", (per_node + per_node_sort) * capacity + 32 * 16);
+    transforms->capacity = capacity;
+    transforms->index_of = arena_push_array(arena, uint32_t, capacity);
+    transforms->ids = arena_push_array(arena, uint32_t, capacity);
+    transforms->parents = arena_push_array(arena, uint32_t, capacity);
+    transforms->depths = arena_push_array(arena, uint8_t, capacity);
+    transforms->dirty = arena_push_array(arena, uint8_t, capacity);
+    transforms->locals = arena_push_array(arena, XrMatrix4x4f, capacity);
+    transforms->worlds = arena_push_array(arena, XrMatrix4x4f, capacity);
+    transforms->batch = arena_push_array(arena, uint32_t, capacity);
+    transforms->batch_parents = arena_push_array(arena, const XrMatrix4x4f*, capacity);
+    transforms->batch_locals = arena_push_array(arena, const XrMatrix4x4f*, capacity);
+    transforms->batch_worlds = arena_push_array(arena, XrMatrix4x4f*, capacity);
+    transforms->sorted = true;
+}
+
+void transforms_destroy(struct transforms* transforms) {
+    arena_destroy(&transforms->arena);
+    memset(transforms, 0, sizeof(*transforms));
+}
+
+uint32_t transforms_add(struct transforms* transforms, uint32_t parent) {
+    if (transforms->count == transforms->capacity) {
+        LOGE("transform hierarchy full at %u nodes", transforms->capacity);
+        exit(EXIT_FAILURE);
+    }
+    uint32_t depth = 0;
+    uint32_t parent_index = TRANSFORM_ROOT;
+    if (parent != TRANSFORM_ROOT) {
+        parent_index = transforms->index_of[parent];
+        depth = transforms->depths[parent_index] + 1u;
+        if (depth >= TRANSFORMS_MAX_DEPTH) {
+            LOGE("transform hierarchy deeper than %d", TRANSFORMS_MAX_DEPTH);
+            exit(EXIT_FAILURE);
+        }
+    }
+    uint32_t id = transforms->count;
+    uint32_t index = transforms->count++;
+    // appending keeps the order as long as depth doesn't decrease
+    if (index > 0 && depth < transforms->depths[index - 1]) {
+        transforms->sorted = false;
+    }
+    transforms->index_of[id] = index;
+    transforms->ids[index] = id;
+    transforms->parents[index] = parent_index;
+    transforms->depths[index] = (uint8_t)depth;
+    transforms->dirty[index] = 1;
+    XrMatrix4x4f_CreateTranslation(&transforms->locals[index], 0.0f, 0.0f, 0.0f);
+    return id;
+}
+
+void transforms_set_local(struct transforms* transforms, uint32_t node, const XrMatrix4x4f* local) {
+    uint32_t index = transforms->index_of[node];
+    transforms->locals[index] = *local;
+    transforms->dirty[index] = 1;
+}
+
+void transforms_set_trs(struct transforms* transforms, uint32_t node, const XrVector3f* translation,
+                        const XrQuaternionf* rotation, const XrVector3f* scale) {
+    uint32_t index = transforms->index_of[node];
+    XrMatrix4x4f_CreateTranslationRotationScale(&transforms->locals[index], translation, rotation, scale);
+    transforms->dirty[index] = 1;
+}
+
+const XrMatrix4x4f* transforms_world(const struct transforms* transforms, uint32_t node) {
+    return &transforms->worlds[transforms->index_of[node]];
+}
+
+// Counting sort by depth into the scratch arrays, then copy back. Only runs
+// after a node was added above the deepest level so far.
+static void transforms_sort(struct transforms* transforms) {
+    uint32_t count = transforms->count;
+    uint32_t start[TRANSFORMS_MAX_DEPTH + 1] = { 0 };
+    for (uint32_t i = 0; i < count; i++) {
+        start[transforms->depths[i] + 1]++;
+    }
+    for (int d = 1; d <= TRANSFORMS_MAX_DEPTH; d++) {
+        start[d] += start[d - 1];
+    }
+    // batch[old index] = new index
+    for (uint32_t i = 0; i < count; i++) {
+        transforms->batch[i] = start[transforms->depths[i]]++;
+    }
+
+    struct arena* arena = &transforms->arena;
+    size_t mark = arena_mark(arena);
+    uint32_t* ids = arena_push_array(arena, uint32_t, count);
+    uint32_t* parents = arena_push_array(arena, uint32_t, count);
+    uint8_t* depths = arena_push_array(arena, uint8_t, count);
+    uint8_t* dirty = arena_push_array(arena, uint8_t, count);
+    XrMatrix4x4f* locals = arena_push_array(arena, XrMatrix4x4f, count);
+    XrMatrix4x4f* worlds = arena_push_array(arena, XrMatrix4x4f, count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t j = transforms->batch[i];
+        uint32_t parent = transforms->parents[i];
+        ids[j] = transforms->ids[i];
+        parents[j] = parent == TRANSFORM_ROOT ? TRANSFORM_ROOT : transforms->batch[parent];
+        depths[j] = transforms->depths[i];
+        dirty[j] = transforms->dirty[i];
+        locals[j] = transforms->locals[i];
+        worlds[j] = transforms->worlds[i];
+        transforms->index_of[ids[j]] = j;
+    }
+    memcpy(transforms->ids, ids, sizeof(*ids) * count);
+    memcpy(transforms->parents, parents, sizeof(*parents) * count);
+    memcpy(transforms->depths, depths, sizeof(*depths) * count);
+    memcpy(transforms->dirty, dirty, sizeof(*dirty) * count);
+    memcpy(transforms->locals, locals, sizeof(*locals) * count);
+    memcpy(transforms->worlds, worlds, sizeof(*worlds) * count);
+    arena_rewind(arena, mark);
+    transforms->sorted = true;
+}
+
+static void transforms_find_levels(struct transforms* transforms) {
+    uint32_t index = 0;
+    for (int d = 0; d <= TRANSFORMS_MAX_DEPTH; d++) {
+        transforms->level_start[d] = index;
+        while (index < transforms->count && transforms->depths[index] == d) {
+            index++;
+        }
+    }
+}
+
+#ifdef __ARM_NEON
+static inline void transforms_multiply(XrMatrix4x4f* result, const XrMatrix4x4f* a, const XrMatrix4x4f* b) {
+    float32x4_t a0 = vld1q_f32(&a->m[0]);
+    float32x4_t a1 = vld1q_f32(&a->m[4]);
+    float32x4_t a2 = vld1q_f32(&a->m[8]);
+    float32x4_t a3 = vld1q_f32(&a->m[12]);
+    for (int column = 0; column < 4; column++) {
+        float32x4_t b_column = vld1q_f32(&b->m[column * 4]);
+        float32x4_t r = vmulq_lane_f32(a0, vget_low_f32(b_column), 0);
+        r = vmlaq_lane_f32(r, a1, vget_low_f32(b_column), 1);
+        r = vmlaq_lane_f32(r, a2, vget_high_f32(b_column), 0);
+        r = vmlaq_lane_f32(r, a3, vget_high_f32(b_column), 1);
+        vst1q_f32(&result->m[column * 4], r);
+    }
+}
+#else
+static inline void transforms_multiply(XrMatrix4x4f* result, const XrMatrix4x4f* a, const XrMatrix4x4f* b) {
+    XrMatrix4x4f_Multiply(result, a, b);
+}
+#endif // __ARM_NEON
+
+void transforms_multiply_batch(XrMatrix4x4f* const* results, const XrMatrix4x4f* const* a,
+                               const XrMatrix4x4f* const* b, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        transforms_multiply(results[i], a[i], b[i]);
+    }
+}
+
+// nodes per job when a level is split across the job system
+#define TRANSFORMS_JOB_GRAIN 512
+
+static void transforms_multiply_range(void* data, uint32_t begin, uint32_t end) {
+    struct transforms* transforms = data;
+    transforms_multiply_batch(transforms->batch_worlds + begin, transforms->batch_parents + begin,
+                              transforms->batch_locals + begin, end - begin);
+}
+
+void transforms_update(struct transforms* transforms, struct jobs* jobs) {
+    if (!transforms->sorted) {
+        transforms_sort(transforms);
+    }
+    transforms_find_levels(transforms);
+    struct transforms_stats stats = { transforms->count, 0, 0 };
+    uint8_t* dirty = transforms->dirty;
+
+    // roots have no parent to multiply with
+    for (uint32_t i = 0; i < transforms->level_start[1]; i++) {
+        if (dirty[i]) {
+            transforms->worlds[i] = transforms->locals[i];
+            stats.updated++;
+        }
+    }
+    for (int d = 1; d < TRANSFORMS_MAX_DEPTH; d++) {
+        uint32_t begin = transforms->level_start[d];
+        uint32_t end = transforms->level_start[d + 1];
+        uint32_t batch_count = 0;
+        for (uint32_t i = begin; i < end; i++) {
+            uint32_t parent = transforms->parents[i];
+            // parents are still flagged, so dirtiness flows down a level at a time
+            dirty[i] |= dirty[parent];
+            if (dirty[i]) {
+                transforms->batch_parents[batch_count] = &transforms->worlds[parent];
+                transforms->batch_locals[batch_count] = &transforms->locals[i];
+                transforms->batch_worlds[batch_count] = &transforms->worlds[i];
+                batch_count++;
+            }
+        }
+        if (batch_count > 0) {
+            if (jobs != NULL) {
+                jobs_parallel_for(jobs, batch_count, TRANSFORMS_JOB_GRAIN, transforms_multiply_range, transforms);
+            } else {
+                transforms_multiply_batch(transforms->batch_worlds, transforms->batch_parents,
+                                          transforms->batch_locals, batch_count);
+            }
+            stats.updated += batch_count;
+            stats.batches++;
+        }
+    }
+    memset(dirty, 0, transforms->count);
+    transforms->stats = stats;
+}
@@ -0,0 +1,72 @@
+#ifndef _TRANSFORMS_H
+#define _TRANSFORMS_H
+
+#include "arena.h"
+#include "jobs.h"
+#include "xr_linear.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Parent/child transform hierarchy in flat arrays sorted by depth, so every
+// parent comes before its children and all nodes of one depth are
+// independent of each other. transforms_update walks the levels in order,
+// gathers the nodes that are dirty or have an updated parent, and
+// multiplies each level as one batch (NEON when available). Untouched
+// subtrees cost one flag test per node.
+
+#define TRANSFORM_ROOT UINT32_MAX
+#define TRANSFORMS_MAX_DEPTH 32
+
+struct transforms_stats {
+    uint32_t nodes;
+    uint32_t updated;
+    uint32_t batches;
+};
+
+struct transforms {
+    struct arena arena;
+    uint32_t capacity;
+    uint32_t count;
+    // node id -> index in the sorted arrays; ids never move
+    uint32_t* index_of;
+    // sorted by depth
+    uint32_t* ids;
+    uint32_t* parents;
+    uint8_t* depths;
+    uint8_t* dirty;
+    XrMatrix4x4f* locals;
+    XrMatrix4x4f* worlds;
+    // first index of each depth, valid while sorted
+    uint32_t level_start[TRANSFORMS_MAX_DEPTH + 1];
+    bool sorted;
+    // scratch for one level's batch
+    uint32_t* batch;
+    const XrMatrix4x4f** batch_parents;
+    const XrMatrix4x4f** batch_locals;
+    XrMatrix4x4f** batch_worlds;
+    struct transforms_stats stats;
+};
+
+void transforms_create(struct transforms* transforms, uint32_t capacity);
+void transforms_destroy(struct transforms* transforms);
+
+// Returns the new node's id; parent is a node id or TRANSFORM_ROOT. The
+// local transform starts out as identity.
+uint32_t transforms_add(struct transforms* transforms, uint32_t parent);
+
+void transforms_set_local(struct transforms* transforms, uint32_t node, const XrMatrix4x4f* local);
+void transforms_set_trs(struct transforms* transforms, uint32_t node, const XrVector3f* translation,
+                        const XrQuaternionf* rotation, const XrVector3f* scale);
+
+// Valid after transforms_update.
+const XrMatrix4x4f* transforms_world(const struct transforms* transforms, uint32_t node);
+
+// Large levels are split across the job system when jobs is not NULL; the
+// levels themselves still run one after another.
+void transforms_update(struct transforms* transforms, struct jobs* jobs);
+
+// result[i] = a[i] * b[i]; results must not alias the inputs.
+void transforms_multiply_batch(XrMatrix4x4f* const* results, const XrMatrix4x4f* const* a,
+                               const XrMatrix4x4f* const* b, uint32_t count);
+
+#endif /* _TRANSFORMS_H */
@@ -0,0 +1,138 @@
+// Checks the benchmark spec parser against good and bad specs, the nearest
+// rank percentiles against known distributions, and that a short run after
+// its warmup writes the frame and missed frame counts it was given. The
+// parser and percentiles are static, so the source is included rather
+// than linked.
+//
+// cc -std=gnu11 -O2 -I src tests/bench_test.c src/arena.c src/log.c -o bench_test -pthread
+// ./bench_test
+
+#include "bench.c"
+#include <stdio.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+static void expect_parse(const char* spec, bool ok) {
+    struct bench_config config;
+    if (bench_parse(&config, spec) != ok) {
+        printf("FAIL: \"%s\" should %s\n", spec, ok ? "parse" : "be rejected");
+        failures++;
+    }
+}
+
+static void expect_percentile(const float* samples, uint32_t count, uint32_t percent, float expected) {
+    float value = bench_percentile(samples, count, percent);
+    if (value != expected) {
+        printf("FAIL: p%u of %u samples is %.1f, expected %.1f\n", percent, count, value, expected);
+        failures++;
+    }
+}
+
+static void test_parse() {
+    struct bench_config config;
+    if (!bench_parse(&config, "") || strcmp(config.name, "default") != 0 || config.objects != 500 ||
+        config.frames != 600) {
+        printf("FAIL: an empty spec should give the defaults\n");
+        failures++;
+    }
+    if (!bench_parse(&config, "name=dense,objects=2000,triangles=100,overdraw=4,warmup=10,frames=300") ||
+        strcmp(config.name, "dense") != 0 || config.objects != 2000 || config.triangles != 100 ||
+        config.overdraw != 4 || config.warmup != 10 || config.frames != 300) {
+        printf("FAIL: a full spec should set every key\n");
+        failures++;
+    }
+    if (!bench_parse(&config, "objects=7") || config.objects != 7 || config.triangles != 200) {
+        printf("FAIL: keys left out should keep their defaults\n");
+        failures++;
+    }
+    expect_parse("frames=4000", true);
+    expect_parse("objects", false);
+    expect_parse("objects=12x", false);
+    expect_parse("vertices=12", false);
+    expect_parse("overdraw=0", false);
+    expect_parse("frames=0", false);
+    expect_parse("frames=4001", false);
+}
+
+static void test_percentile() {
+    float samples[100];
+    for (int i = 0; i < 100; i++) {
+        samples[i] = i + 1;
+    }
+    expect_percentile(samples, 100, 50, 50);
+    expect_percentile(samples, 100, 90, 90);
+    expect_percentile(samples, 100, 99, 99);
+    expect_percentile(samples, 100, 100, 100);
+    expect_percentile(samples, 100, 0, 1);
+    // the rank rounds up, so a high percentile of few samples is the max
+    expect_percentile(samples, 10, 99, 10);
+    expect_percentile(samples, 10, 50, 5);
+    expect_percentile(samples, 1, 99, 1);
+}
+
+static void test_run() {
+    struct bench bench;
+    bench_init(&bench, "name=test,warmup=3,frames=20");
+    if (!bench.enabled) {
+        printf("FAIL: benchmark didn't start\n");
+        failures++;
+        return;
+    }
+    uint32_t frames = 0;
+    bool done = false;
+    while (!done && frames < 100) {
+        bench_frame_begin(&bench);
+        for (int phase = BENCH_PHASE_WAIT; phase <= BENCH_PHASE_SUBMIT; phase++) {
+            usleep(100);
+            bench_phase_end(&bench, phase);
+        }
+        // the warmup frames miss too, and mustn't count
+        done = bench_frame_end(&bench, 7, frames % 4 == 0);
+        frames++;
+    }
+    if (!done || frames != 23 || bench.counts[BENCH_PHASE_FRAME] != 20 || bench.missed != 5) {
+        printf("FAIL: run ended after %u frames, %u measured, %u missed; expected 23, 20 and 5\n", frames,
+               bench.counts[BENCH_PHASE_FRAME], bench.missed);
+        failures++;
+    }
+
+    char path[] = "/tmp/bench_test_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("FAIL: can't make a temp file\n");
+        failures++;
+        bench_destroy(&bench);
+        return;
+    }
+    close(fd);
+    if (!bench_write(&bench, path, "test", 72.0f)) {
+        printf("FAIL: can't write results\n");
+        failures++;
+    } else {
+        char json[4096] = { 0 };
+        FILE* file = fopen(path, "r");
+        size_t length = file != NULL ? fread(json, 1, sizeof(json) - 1, file) : 0;
+        if (file != NULL) {
+            fclose(file);
+        }
+        if (length == 0 || strstr(json, "\"frames\": 20,") == NULL || strstr(json, "\"missed_frames\": 5,") == NULL ||
+            strstr(json, "\"draw_calls_per_frame\": 7.0,") == NULL || strstr(json, "\"gpu\": null") == NULL) {
+            printf("FAIL: unexpected results:\n%s", json);
+            failures++;
+        }
+    }
+    unlink(path);
+    bench_destroy(&bench);
+}
+
+int main() {
+    test_parse();
+    test_percentile();
+    test_run();
+    if (failures > 0) {
+        return EXIT_FAILURE;
+    }
+    printf("bench: parser, percentiles and results ok\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+// Stress test of the glue's command ring: one producer posts commands in
+// bursts and signals an eventfd after each, as the activity main thread
+// does, and one consumer blocks on the eventfd and drains the ring, as the
+// app thread's looper does. Checks that every command arrives once and in
+// order and reports the post to receive latency.
+//
+// cc -std=gnu11 -O2 -I src -pthread tests/cmd_ring_test.c -o cmd_ring_test && ./cmd_ring_test [commands]
+
+#include "cmd_ring.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_BURST 80
+
+static struct cmd_ring ring;
+static int event_fd;
+static uint32_t command_count = 200000;
+static int64_t* post_times;
+static int64_t* latencies;
+static uint32_t ring_full;
+
+static int64_t time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void* producer_main(void* param) {
+    uint32_t seed = 1;
+    uint32_t sent = 0;
+    while (sent < command_count) {
+        // bursts up to past the ring size, to exercise the full case too
+        seed = seed * 1103515245 + 12345;
+        uint32_t burst = 1 + (seed >> 16) % MAX_BURST;
+        for (uint32_t i = 0; i < burst && sent < command_count; i++, sent++) {
+            post_times[sent] = time_ns();
+            if (!cmd_ring_push(&ring, (int8_t)(sent & 0x7f))) {
+                __atomic_fetch_add(&ring_full, 1, __ATOMIC_RELAXED);
+                while (!cmd_ring_push(&ring, (int8_t)(sent & 0x7f))) {
+                    sched_yield();
+                }
+            }
+            uint64_t one = 1;
+            if (write(event_fd, &one, sizeof(one)) != sizeof(one)) {
+                perror("write");
+                exit(EXIT_FAILURE);
+            }
+        }
+        if ((seed >> 8) % 4 == 0) {
+            struct timespec pause = { 0, 20000 };
+            nanosleep(&pause, NULL);
+        }
+    }
+    return NULL;
+}
+
+static int compare(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        command_count = (uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    post_times = calloc(command_count, sizeof(int64_t));
+    latencies = calloc(command_count, sizeof(int64_t));
+    event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (post_times == NULL || latencies == NULL || event_fd < 0) {
+        perror("setup");
+        return EXIT_FAILURE;
+    }
+
+    pthread_t producer;
+    pthread_create(&producer, NULL, producer_main, NULL);
+
+    uint32_t received = 0;
+    uint32_t wakeups = 0;
+    while (received < command_count) {
+        struct pollfd fd = { event_fd, POLLIN, 0 };
+        if (poll(&fd, 1, 1000) != 1) {
+            fprintf(stderr, "FAIL: no wakeup with %u of %u commands received\n", received, command_count);
+            return EXIT_FAILURE;
+        }
+        wakeups++;
+        // reset before draining, as process_cmd does
+        uint64_t count;
+        if (read(event_fd, &count, sizeof(count)) != sizeof(count) && errno != EAGAIN) {
+            perror("read");
+            return EXIT_FAILURE;
+        }
+        int8_t cmd;
+        while ((cmd = cmd_ring_pop(&ring)) >= 0) {
+            int64_t now = time_ns();
+            if (cmd != (int8_t)(received & 0x7f)) {
+                fprintf(stderr, "FAIL: command %u is %d, expected %d\n", received, cmd, received & 0x7f);
+                return EXIT_FAILURE;
+            }
+            latencies[received] = now - post_times[received];
+            received++;
+        }
+    }
+    pthread_join(producer, NULL);
+    if (cmd_ring_pop(&ring) != -1) {
+        fprintf(stderr, "FAIL: ring not empty after the last command\n");
+        return EXIT_FAILURE;
+    }
+
+    qsort(latencies, command_count, sizeof(int64_t), compare);
+    printf("cmd_ring: %u commands, %u wakeups, ring full %u times\n", command_count, wakeups, ring_full);
+    printf("cmd_ring: latency us p50 %.1f p99 %.1f p99.9 %.1f max %.1f\n",
+           latencies[command_count / 2] / 1e3, latencies[command_count * 99 / 100] / 1e3,
+           latencies[command_count * 999 / 1000] / 1e3, latencies[command_count - 1] / 1e3);
+    return EXIT_SUCCESS;
+}
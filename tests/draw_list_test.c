@@ -0,0 +1,125 @@
+// Records draw lists on the job system and replays them the way gl_render
+// does, checking the draws against a serial walk over the visible entities
+// and the matrices against a plain multiply. Covers scenes below one
+// segment, several segments on a single thread, where the whole range
+// arrives in one call, and on several threads, and enough entities to
+// widen the segments.
+//
+// cc -std=gnu11 -O2 -I src -I $OPENXR_HOME/include -pthread tests/draw_list_test.c src/draw_list.c src/entities.c src/jobs.c src/arena.c src/log.c -o draw_list_test -lm
+// ./draw_list_test
+
+#include "draw_list.h"
+#include "entities.h"
+#include "jobs.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VIEW 1
+
+static void scene_fill(struct entities* entities, uint32_t count) {
+    srand(count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t index = entity_index(entities, entity_create(entities));
+        entities->positions[index] = (XrVector3f) { (float)(i % 50), (float)(i % 13), -(float)(i % 29) };
+        // runs of the same mesh, so both mesh commands and their elision are exercised
+        entities->meshes[index] = (uint16_t)(i / 5 % 3);
+        entities->visible[index] = (uint8_t)(rand() & 3);
+    }
+    // twice, so prev_world is filled in too
+    entities_update_world(entities, NULL);
+    entities_update_world(entities, NULL);
+}
+
+static bool check(const struct draw_list* list, const struct entities* entities, const XrMatrix4x4f* view_proj,
+                  const char* name) {
+    uint32_t expected = 0;
+    uint32_t mesh = UINT32_MAX;
+    for (uint32_t s = 0; s < list->segment_count; s++) {
+        const struct draw_segment* segment = &list->segments[s];
+        if (segment->begin > segment->end || segment->end > 2 * entities->count ||
+            (s > 0 && segment->begin < list->segments[s - 1].end)) {
+            printf("FAIL: %s: segment %u is [%u, %u)\n", name, s, segment->begin, segment->end);
+            return false;
+        }
+        for (uint32_t c = segment->begin; c < segment->end; c++) {
+            const struct draw_cmd* cmd = &list->cmds[c];
+            if (cmd->op == DRAW_OP_MESH) {
+                mesh = cmd->mesh;
+                continue;
+            }
+            while (expected < entities->count && !(entities->visible[expected] & (1u << VIEW))) {
+                expected++;
+            }
+            if (cmd->entity != expected || mesh != entities->meshes[expected]) {
+                printf("FAIL: %s: drew entity %u with mesh %u, expected entity %u with mesh %u\n", name,
+                       cmd->entity, mesh, expected, expected < entities->count ? entities->meshes[expected] : 0);
+                return false;
+            }
+            XrMatrix4x4f mvp;
+            XrMatrix4x4f prev_mvp;
+            XrMatrix4x4f_Multiply(&mvp, view_proj, &entities->world[expected]);
+            XrMatrix4x4f_Multiply(&prev_mvp, view_proj, &entities->prev_world[expected]);
+            if (memcmp(&mvp, &list->mvps[expected], sizeof(mvp)) != 0 ||
+                memcmp(&prev_mvp, &list->prev_mvps[expected], sizeof(prev_mvp)) != 0) {
+                printf("FAIL: %s: matrices of entity %u differ\n", name, expected);
+                return false;
+            }
+            expected++;
+        }
+    }
+    while (expected < entities->count && !(entities->visible[expected] & (1u << VIEW))) {
+        expected++;
+    }
+    if (expected != entities->count) {
+        printf("FAIL: %s: replay stopped before visible entity %u of %u\n", name, expected, entities->count);
+        return false;
+    }
+    return true;
+}
+
+static bool run(uint32_t count, int threads) {
+    char name[64];
+    snprintf(name, sizeof(name), "%u entities, %d threads", count, threads);
+    struct entities entities;
+    entities_create(&entities, count);
+    scene_fill(&entities, count);
+    struct jobs jobs;
+    jobs_create(&jobs, threads);
+    struct arena arena;
+    arena_create(&arena, "draw list test", (2 * sizeof(struct draw_cmd) + 2 * sizeof(XrMatrix4x4f)) * count + 64);
+    XrMatrix4x4f view_proj;
+    XrMatrix4x4f_CreateProjection(&view_proj, -1.0f, 1.0f, 1.0f, -1.0f, 0.05f, 100.0f);
+
+    bool ok = true;
+    struct draw_list list;
+    // poisoned, so a segment the recording leaves unwritten can't pass
+    memset(&list, 0xff, sizeof(list));
+    for (int repeat = 0; repeat < 3 && ok; repeat++) {
+        arena_reset(&arena);
+        struct job_counter counter = { 0 };
+        draw_list_record(&list, &arena, &entities, VIEW, &view_proj, &jobs, &counter);
+        jobs_wait(&jobs, &counter);
+        ok = check(&list, &entities, &view_proj, name);
+    }
+    if (ok) {
+        printf("%s: %u segments ok\n", name, list.segment_count);
+    }
+    arena_destroy(&arena);
+    jobs_destroy(&jobs);
+    entities_destroy(&entities);
+    return ok;
+}
+
+int main() {
+    log_init();
+    bool ok = true;
+    ok &= run(100, 1);
+    ok &= run(100, 4);
+    ok &= run(5000, 1);
+    ok &= run(5000, 4);
+    ok &= run(50000, 1);
+    ok &= run(50000, 4);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
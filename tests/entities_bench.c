@@ -0,0 +1,130 @@
+// Benchmarks the entity store at 100k entities: creation, churn with stale
+// handle detection, the world matrix update and a linear walk over the
+// components, single threaded and on the job system.
+//
+// cc -std=gnu11 -O2 -I src -I $OPENXR_HOME/include -pthread tests/entities_bench.c src/entities.c src/jobs.c src/arena.c src/log.c -o entities_bench -lm
+// ./entities_bench [entities] [threads]
+
+#include "entities.h"
+#include "jobs.h"
+#include "log.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define REPEATS 20
+
+static double time_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static bool check_world(const struct entities* entities) {
+    for (uint32_t i = 0; i < entities->count; i++) {
+        const XrMatrix4x4f* world = &entities->world[i];
+        if (fabsf(world->m[12] - entities->positions[i].x) > 1e-3f ||
+            fabsf(world->m[13] - entities->positions[i].y) > 1e-3f ||
+            fabsf(world->m[14] - entities->positions[i].z) > 1e-3f) {
+            printf("FAIL: world matrix of entity %u is not at its position\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+// best of REPEATS, in ms
+static void bench_update(struct entities* entities, struct jobs* jobs, double* update_ms, double* iterate_ms,
+                         float* checksum) {
+    *update_ms = 1e9;
+    *iterate_ms = 1e9;
+    for (int repeat = 0; repeat < REPEATS; repeat++) {
+        double start = time_ms();
+        for (uint32_t i = 0; i < entities->count; i++) {
+            entities->positions[i].y += 0.001f;
+        }
+        entities_update_world(entities, jobs);
+        double updated = time_ms();
+        float sum = 0.0f;
+        for (uint32_t i = 0; i < entities->count; i++) {
+            sum += entities->world[i].m[12] * entities->meshes[i];
+        }
+        double iterated = time_ms();
+        *checksum += sum;
+        *update_ms = fmin(*update_ms, updated - start);
+        *iterate_ms = fmin(*iterate_ms, iterated - updated);
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t count = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 100000;
+    int threads = argc > 2 ? atoi(argv[2]) : 2;
+    if (count == 0 || count >= ENTITY_MAX || threads < 0 || threads > JOBS_MAX_THREADS) {
+        printf("usage: %s [entities below %u] [job threads up to %d]\n", argv[0], ENTITY_MAX, JOBS_MAX_THREADS);
+        return EXIT_FAILURE;
+    }
+    log_init();
+    struct entities entities;
+    entities_create(&entities, count);
+    uint32_t* handles = malloc(count * sizeof(uint32_t));
+    bool ok = true;
+
+    double start = time_ms();
+    for (uint32_t i = 0; i < count; i++) {
+        handles[i] = entity_create(&entities);
+        uint32_t index = entity_index(&entities, handles[i]);
+        entities.positions[index] = (XrVector3f) { i * 0.01f, 0.0f, -(float)(i % 100) };
+        entities.meshes[index] = (uint16_t)(i % 7);
+    }
+    double create_ms = time_ms() - start;
+
+    // destroy every other one: their handles go stale, and the slots they
+    // free are reused without the new handles matching the old ones
+    start = time_ms();
+    for (uint32_t i = 0; i < count; i += 2) {
+        entity_destroy(&entities, handles[i]);
+    }
+    uint32_t stale = 0;
+    for (uint32_t i = 0; i < count; i += 2) {
+        stale += !entity_alive(&entities, handles[i]);
+    }
+    for (uint32_t i = 0; i < count; i += 2) {
+        uint32_t old = handles[i];
+        handles[i] = entity_create(&entities);
+        ok &= handles[i] != old;
+    }
+    double churn_ms = time_ms() - start;
+    uint32_t alive = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        alive += entity_alive(&entities, handles[i]);
+    }
+    if (stale != (count + 1) / 2 || alive != count || entities.count != count || !ok) {
+        printf("FAIL: %u stale of %u destroyed, %u alive of %u, a recreated handle %s\n", stale, (count + 1) / 2,
+               alive, count, ok ? "is new" : "matched a stale one");
+        ok = false;
+    }
+    printf("entities: %u created in %.2f ms, half destroyed and recreated in %.2f ms\n", count, create_ms,
+           churn_ms);
+
+    float checksum = 0.0f;
+    double update_ms, iterate_ms;
+    bench_update(&entities, NULL, &update_ms, &iterate_ms, &checksum);
+    ok &= check_world(&entities);
+    printf("entities: update %.3f ms, iterate %.3f ms, 1 thread\n", update_ms, iterate_ms);
+
+    if (threads > 0) {
+        struct jobs jobs;
+        jobs_create(&jobs, threads);
+        bench_update(&entities, &jobs, &update_ms, &iterate_ms, &checksum);
+        ok &= check_world(&entities);
+        printf("entities: update %.3f ms, %d job threads\n", update_ms, threads);
+        jobs_destroy(&jobs);
+    }
+    printf("entities: checksum %f\n", checksum);
+
+    free(handles);
+    entities_destroy(&entities);
+    log_shutdown();
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,129 @@
+// Drives foveation against a stub runtime that records the profile it is
+// asked to create and what it is applied to, and checks the property
+// parser.
+//
+// cc -std=gnu11 -O2 -I src -I $OPENXR_HOME/include -pthread tests/foveation_test.c src/foveation.c src/log.c -o foveation_test
+// ./foveation_test
+
+#include "foveation.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define STUB_SESSION ((XrSession)(uintptr_t)0x5e55)
+#define STUB_SWAPCHAIN ((XrSwapchain)(uintptr_t)0x5c)
+#define STUB_PROFILE ((XrFoveationProfileFB)(uintptr_t)0xf0)
+
+struct stub_runtime {
+    XrResult create_result;
+    int created;
+    int destroyed;
+    int updated;
+    XrSession session;
+    XrFoveationLevelFB level;
+    XrFoveationDynamicFB dynamic;
+    XrSwapchain swapchain;
+    XrFoveationProfileFB applied_profile;
+};
+
+static struct stub_runtime stub;
+
+static XrResult XRAPI_CALL stub_create_profile(XrSession session, const XrFoveationProfileCreateInfoFB* info,
+                                               XrFoveationProfileFB* profile) {
+    stub.session = session;
+    const XrFoveationLevelProfileCreateInfoFB* level_info = info->next;
+    if (info->type != XR_TYPE_FOVEATION_PROFILE_CREATE_INFO_FB || level_info == NULL ||
+        level_info->type != XR_TYPE_FOVEATION_LEVEL_PROFILE_CREATE_INFO_FB) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (!XR_SUCCEEDED(stub.create_result)) {
+        return stub.create_result;
+    }
+    stub.level = level_info->level;
+    stub.dynamic = level_info->dynamic;
+    stub.created++;
+    *profile = STUB_PROFILE;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL stub_destroy_profile(XrFoveationProfileFB profile) {
+    stub.destroyed += profile == STUB_PROFILE;
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL stub_update_swapchain(XrSwapchain swapchain, const XrSwapchainStateBaseHeaderFB* state) {
+    if (state->type != XR_TYPE_SWAPCHAIN_STATE_FOVEATION_FB) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    stub.swapchain = swapchain;
+    stub.applied_profile = ((const XrSwapchainStateFoveationFB*)state)->profile;
+    stub.updated++;
+    return XR_SUCCESS;
+}
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    if (!condition) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+int main() {
+    struct foveation foveation;
+
+    // the profile reaches the runtime as configured, and is released after
+    foveation_init(&foveation, XR_FOVEATION_LEVEL_MEDIUM_FB, XR_FOVEATION_DYNAMIC_LEVEL_ENABLED_FB,
+                   stub_create_profile, stub_destroy_profile, stub_update_swapchain);
+    expect(foveation.runtime, "runtime foveation with all functions");
+    stub = (struct stub_runtime) { XR_SUCCESS };
+    expect(foveation_apply(&foveation, STUB_SESSION, STUB_SWAPCHAIN), "apply succeeds");
+    expect(stub.session == STUB_SESSION, "profile created on the session");
+    expect(stub.level == XR_FOVEATION_LEVEL_MEDIUM_FB, "profile level");
+    expect(stub.dynamic == XR_FOVEATION_DYNAMIC_LEVEL_ENABLED_FB, "profile dynamic mode");
+    expect(stub.updated == 1 && stub.swapchain == STUB_SWAPCHAIN, "swapchain updated once");
+    expect(stub.applied_profile == STUB_PROFILE, "swapchain given the created profile");
+    expect(stub.created == 1 && stub.destroyed == 1, "profile destroyed after use");
+
+    // a level change applies the new profile
+    foveation.level = XR_FOVEATION_LEVEL_LOW_FB;
+    foveation.dynamic = XR_FOVEATION_DYNAMIC_DISABLED_FB;
+    foveation_apply(&foveation, STUB_SESSION, STUB_SWAPCHAIN);
+    expect(stub.level == XR_FOVEATION_LEVEL_LOW_FB && stub.dynamic == XR_FOVEATION_DYNAMIC_DISABLED_FB,
+           "changed level reaches the runtime");
+    expect(stub.updated == 2 && stub.destroyed == 2, "second update and destroy");
+
+    // a refused profile is not applied
+    stub = (struct stub_runtime) { XR_ERROR_FUNCTION_UNSUPPORTED };
+    expect(!foveation_apply(&foveation, STUB_SESSION, STUB_SWAPCHAIN), "apply fails when creation fails");
+    expect(stub.updated == 0 && stub.destroyed == 0, "nothing applied or destroyed after a failed create");
+
+    // without the extension nothing is called
+    foveation_init(&foveation, XR_FOVEATION_LEVEL_HIGH_FB, XR_FOVEATION_DYNAMIC_DISABLED_FB, stub_create_profile,
+                   NULL, stub_update_swapchain);
+    stub = (struct stub_runtime) { XR_SUCCESS };
+    expect(!foveation.runtime, "fallback with a function missing");
+    expect(!foveation_apply(&foveation, STUB_SESSION, STUB_SWAPCHAIN) && stub.created == 0,
+           "fallback calls nothing");
+
+    // property values
+    XrFoveationLevelFB level = XR_FOVEATION_LEVEL_NONE_FB;
+    XrFoveationDynamicFB dynamic = XR_FOVEATION_DYNAMIC_DISABLED_FB;
+    expect(foveation_parse("high,dynamic", &level, &dynamic) && level == XR_FOVEATION_LEVEL_HIGH_FB &&
+           dynamic == XR_FOVEATION_DYNAMIC_LEVEL_ENABLED_FB, "parse high,dynamic");
+    expect(foveation_parse("low", &level, &dynamic) && level == XR_FOVEATION_LEVEL_LOW_FB &&
+           dynamic == XR_FOVEATION_DYNAMIC_DISABLED_FB, "parse low");
+    expect(foveation_parse("none", &level, &dynamic) && level == XR_FOVEATION_LEVEL_NONE_FB, "parse none");
+    static const char* BAD_VALUES[] = { "", "hi", "highest", "3", "high,", "high,static", "medium,dynamic,x" };
+    for (size_t i = 0; i < sizeof(BAD_VALUES) / sizeof(BAD_VALUES[0]); i++) {
+        level = XR_FOVEATION_LEVEL_MEDIUM_FB;
+        bool parsed = foveation_parse(BAD_VALUES[i], &level, &dynamic);
+        if (parsed || level != XR_FOVEATION_LEVEL_MEDIUM_FB) {
+            printf("FAIL: parsed \"%s\"\n", BAD_VALUES[i]);
+            failures++;
+        }
+    }
+
+    printf("foveation: %d failures\n", failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
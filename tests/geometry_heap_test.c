@@ -0,0 +1,99 @@
+// Drives the geometry heap free list through random allocations and frees,
+// checking after every step that no two blocks overlap, that free blocks
+// are sorted and coalesced and that the used count adds up, then that
+// freeing everything leaves a single block. The allocator is static, so the
+// source is included rather than linked.
+//
+// cc -std=gnu11 -O2 -I src tests/geometry_heap_test.c src/loader.c src/log.c -o geometry_heap_test -lEGL -lGLESv2 -pthread
+// ./geometry_heap_test [steps]
+
+#include "geometry_heap.c"
+#include <stdio.h>
+
+#define CAPACITY 10000
+#define MAX_SIZE 200
+
+struct live_block {
+    uint32_t offset;
+    uint32_t size;
+};
+
+static uint8_t owner[CAPACITY];
+
+// the registry pulls in the OpenXR loader, and nothing here is registered
+bool resources_track(enum resource_type type, uint64_t handle, uint64_t bytes, const char* owner) {
+    return true;
+}
+
+static bool check(const struct geometry_allocator* allocator, uint32_t step) {
+    uint32_t free_size = 0;
+    for (uint32_t i = 0; i < allocator->free_count; i++) {
+        const struct geometry_block* block = &allocator->free[i];
+        free_size += block->size;
+        if (i > 0 && allocator->free[i - 1].offset + allocator->free[i - 1].size >= block->offset) {
+            printf("FAIL: step %u: free blocks %u and %u not sorted or not coalesced\n", step, i - 1, i);
+            return false;
+        }
+        for (uint32_t j = block->offset; j < block->offset + block->size; j++) {
+            if (owner[j]) {
+                printf("FAIL: step %u: free block %u covers used space at %u\n", step, i, j);
+                return false;
+            }
+        }
+    }
+    if (free_size + allocator->used != allocator->capacity) {
+        printf("FAIL: step %u: %u free and %u used of %u\n", step, free_size, allocator->used, allocator->capacity);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    uint32_t steps = argc > 1 ? (uint32_t)atoi(argv[1]) : 200000;
+    struct geometry_allocator allocator;
+    geometry_allocator_init(&allocator, CAPACITY);
+    struct live_block live[GEOMETRY_HEAP_MAX_MESHES];
+    uint32_t live_count = 0;
+    uint32_t allocs = 0;
+    uint32_t misses = 0;
+    srand(3);
+
+    for (uint32_t step = 0; step < steps; step++) {
+        if (live_count < GEOMETRY_HEAP_MAX_MESHES && (rand() & 1)) {
+            uint32_t size = 1 + rand() % MAX_SIZE;
+            uint32_t offset = geometry_allocator_alloc(&allocator, size);
+            if (offset == GEOMETRY_HEAP_INVALID) {
+                misses++;
+            } else {
+                for (uint32_t j = offset; j < offset + size; j++) {
+                    if (owner[j]) {
+                        printf("FAIL: step %u: block at %u overlaps a live one at %u\n", step, offset, j);
+                        return EXIT_FAILURE;
+                    }
+                    owner[j] = 1;
+                }
+                live[live_count++] = (struct live_block) { offset, size };
+                allocs++;
+            }
+        } else if (live_count > 0) {
+            uint32_t i = rand() % live_count;
+            geometry_allocator_free(&allocator, live[i].offset, live[i].size);
+            memset(&owner[live[i].offset], 0, live[i].size);
+            live[i] = live[--live_count];
+        }
+        if (!check(&allocator, step)) {
+            return EXIT_FAILURE;
+        }
+    }
+    while (live_count > 0) {
+        live_count--;
+        geometry_allocator_free(&allocator, live[live_count].offset, live[live_count].size);
+        memset(&owner[live[live_count].offset], 0, live[live_count].size);
+    }
+    if (!check(&allocator, steps) || allocator.free_count != 1 || allocator.free[0].size != CAPACITY) {
+        printf("FAIL: %u free blocks left after freeing everything\n", allocator.free_count);
+        return EXIT_FAILURE;
+    }
+    printf("%u steps: %u allocations, %u out of space\n", steps, allocs, misses);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,227 @@
+// Captures a few frames of meshes drawn from a geometry heap through the
+// capture wrappers, then replays them with gl_replay's parser on the same
+// context: every call has to come back once and without GL errors, and the
+// replayed image has to match the one drawn live. Runs once with
+// glDrawElementsBaseVertex and once with indices rebased on upload, whose
+// draws must only be recorded as glDrawElements. The replay tool and the
+// heap keep what is checked static, so both sources are included rather
+// than linked; the replay's calls pass through the wrappers untouched, as
+// the capture has stopped by then.
+//
+// cc -std=gnu11 -O2 -I src -DENABLE_GL_CAPTURE=1 tests/gl_capture_test.c src/gl_capture.c src/loader.c src/log.c -o gl_capture_test -lEGL -lGLESv2 -pthread
+// ./gl_capture_test
+
+#define main gl_replay_main
+#define draw_elements_base_vertex replay_draw_elements_base_vertex
+#include "../tools/gl_replay.c"
+#undef draw_elements_base_vertex
+#undef main
+#include "geometry_heap.c"
+#include "log.h"
+
+#define FRAMES 3
+#define SIZE 32
+// calls made per frame, besides the draws
+#define FRAME_CALLS 10
+#define MESH_COUNT 2
+
+static const char* VERTEX_SHADER =
+        "#version 300 es\n"
+        "uniform mat4 mvp;\n"
+        "in vec3 position;\n"
+        "void main() {\n"
+        "    gl_Position = mvp * vec4(position, 1.0);\n"
+        "}\n";
+
+static const char* FRAGMENT_SHADER =
+        "#version 300 es\n"
+        "precision mediump float;\n"
+        "out vec4 color;\n"
+        "void main() {\n"
+        "    color = vec4(gl_FragCoord.xy / 32.0, 0.5, 1.0);\n"
+        "}\n";
+
+// a quad on the left and a triangle on the right, so the second mesh
+// starts at a vertex other than 0
+static const float QUAD[] = {
+        -0.9f, -0.9f, 0.0f, -0.1f, -0.9f, 0.0f, -0.1f, 0.9f, 0.0f, -0.9f, 0.9f, 0.0f,
+};
+static const uint16_t QUAD_INDICES[] = { 0, 1, 2, 0, 2, 3 };
+static const float TRIANGLE[] = {
+        0.1f, -0.5f, 0.5f, 0.9f, -0.5f, 0.5f, 0.5f, 0.8f, -0.5f,
+};
+static const uint16_t TRIANGLE_INDICES[] = { 0, 1, 2 };
+
+static struct replay replay;
+
+struct scene {
+    GLuint program;
+    GLint mvp;
+    GLuint framebuffer;
+    struct loader loader;
+};
+
+// the registry pulls in the OpenXR loader, and nothing here is registered
+bool resources_track(enum resource_type type, uint64_t handle, uint64_t bytes, const char* owner) {
+    return true;
+}
+
+static void scene_create(struct scene* scene) {
+    scene->program = glCreateProgram();
+    glAttachShader(scene->program, compile_shader(GL_VERTEX_SHADER, VERTEX_SHADER));
+    glAttachShader(scene->program, compile_shader(GL_FRAGMENT_SHADER, FRAGMENT_SHADER));
+    glBindAttribLocation(scene->program, 0, "position");
+    glLinkProgram(scene->program);
+    scene->mvp = glGetUniformLocation(scene->program, "mvp");
+
+    GLuint textures[2];
+    glGenTextures(2, textures);
+    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, SIZE, SIZE);
+    glBindTexture(GL_TEXTURE_2D, textures[1]);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, SIZE, SIZE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &scene->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, scene->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[0], 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[1], 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // the loader shares the context the replay tool made current
+    EGLDisplay display = eglGetCurrentDisplay();
+    EGLContext context = eglGetCurrentContext();
+    EGLint config_id;
+    eglQueryContext(display, context, EGL_CONFIG_ID, &config_id);
+    const EGLint attribs[] = { EGL_CONFIG_ID, config_id, EGL_NONE };
+    EGLConfig config;
+    EGLint config_count = 0;
+    if (!eglChooseConfig(display, attribs, &config, 1, &config_count) || config_count == 0) {
+        fail("no config for the loader");
+    }
+    loader_create(&scene->loader, display, config, context);
+}
+
+static bool heap_fill(struct geometry_heap* heap, struct loader* loader, uint32_t* meshes) {
+    static const struct attrib_pointer ATTRIBS[] = { { 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0 } };
+    geometry_heap_create(heap, 3 * sizeof(float), 64, 64, ATTRIBS, 1, "gl capture test");
+    meshes[0] = geometry_heap_add(heap, loader, QUAD, 4, QUAD_INDICES, 6);
+    meshes[1] = geometry_heap_add(heap, loader, TRIANGLE, 3, TRIANGLE_INDICES, 3);
+    for (int wait = 0; wait < 2000 && !(geometry_heap_ready(heap, meshes[0]) && geometry_heap_ready(heap, meshes[1]));
+         wait++) {
+        usleep(1000);
+        geometry_heap_update(heap, loader);
+    }
+    if (!geometry_heap_ready(heap, meshes[0]) || !geometry_heap_ready(heap, meshes[1])) {
+        printf("FAIL: meshes didn't load\n");
+        return false;
+    }
+    return true;
+}
+
+// FRAME_CALLS calls and a draw per mesh, all redirected to the wrappers
+static void draw_frame(const struct scene* scene, const struct geometry_heap* heap, const uint32_t* meshes) {
+    static const GLfloat IDENTITY[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    glBindFramebuffer(GL_FRAMEBUFFER, scene->framebuffer);
+    glViewport(0, 0, SIZE, SIZE);
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glUseProgram(scene->program);
+    glUniformMatrix4fv(scene->mvp, 1, GL_FALSE, IDENTITY);
+    geometry_heap_bind(heap);
+    for (int i = 0; i < MESH_COUNT; i++) {
+        geometry_heap_draw(heap, meshes[i]);
+    }
+    glBindVertexArray(0);
+    glFlush();
+}
+
+static void read_image(GLuint framebuffer, uint8_t* pixels) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadPixels(0, 0, SIZE, SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+static bool run(struct scene* scene, bool base_vertex, uint8_t* image) {
+    const char* name = base_vertex ? "base vertex" : "rebased";
+    if (!base_vertex) {
+        // heaps created from here on rebase their indices
+        draw_elements_base_vertex = NULL;
+    }
+    struct geometry_heap* heap = calloc(1, sizeof(struct geometry_heap));
+    uint32_t meshes[MESH_COUNT];
+    if (!heap_fill(heap, &scene->loader, meshes)) {
+        return false;
+    }
+
+    char path[] = "/tmp/gl_capture_test_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("FAIL: can't make a temp file\n");
+        return false;
+    }
+    close(fd);
+    gl_capture_start(path, FRAMES);
+    for (int frame = 0; frame < FRAMES; frame++) {
+        gl_capture_frame(frame);
+        draw_frame(scene, heap, meshes);
+    }
+    // one more frame ends the capture
+    gl_capture_frame(FRAMES);
+    read_image(scene->framebuffer, image);
+
+    size_t size;
+    uint8_t* data = load_capture(path, &size);
+    unlink(path);
+    memset(&replay, 0, sizeof(replay));
+    replay_pass(&replay, data, size);
+    free(data);
+
+    bool ok = true;
+    uint64_t calls = 0;
+    for (int op = 0; op < GL_CAPTURE_OP_END; op++) {
+        calls += replay.ops[op].calls;
+        if (replay.ops[op].errors > 0) {
+            printf("FAIL: %s: %s raised %llu GL errors\n", name, OP_NAMES[op],
+                   (unsigned long long)replay.ops[op].errors);
+            ok = false;
+        }
+    }
+    uint64_t draws = replay.ops[base_vertex ? GL_CAPTURE_DRAW_ELEMENTS_BASE_VERTEX : GL_CAPTURE_DRAW_ELEMENTS].calls;
+    uint64_t other_draws =
+            replay.ops[base_vertex ? GL_CAPTURE_DRAW_ELEMENTS : GL_CAPTURE_DRAW_ELEMENTS_BASE_VERTEX].calls;
+    if (replay.frames != FRAMES || draws != FRAMES * MESH_COUNT || other_draws != 0 ||
+        calls != FRAMES * (FRAME_CALLS + MESH_COUNT)) {
+        printf("FAIL: %s: replayed %llu frames, %llu draws, %llu of the other kind and %llu calls; "
+               "expected %d, %d, 0 and %d\n",
+               name, (unsigned long long)replay.frames, (unsigned long long)draws, (unsigned long long)other_draws,
+               (unsigned long long)calls, FRAMES, FRAMES * MESH_COUNT, FRAMES * (FRAME_CALLS + MESH_COUNT));
+        ok = false;
+    }
+
+    uint8_t replayed[SIZE * SIZE * 4];
+    read_image(name_map_get(&replay.framebuffers, scene->framebuffer, "framebuffer"), replayed);
+    if (memcmp(image, replayed, sizeof(replayed)) != 0) {
+        printf("FAIL: %s: replayed image differs from the live one\n", name);
+        ok = false;
+    }
+    if (ok) {
+        printf("%s: %d frames, %llu calls replayed\n", name, FRAMES, (unsigned long long)calls);
+    }
+    return ok;
+}
+
+int main() {
+    log_init();
+    egl_create();
+    struct scene scene;
+    scene_create(&scene);
+    uint8_t images[2][SIZE * SIZE * 4];
+    bool ok = run(&scene, true, images[0]) && run(&scene, false, images[1]);
+    if (ok && memcmp(images[0], images[1], sizeof(images[0])) != 0) {
+        printf("FAIL: rebased meshes draw differently\n");
+        ok = false;
+    }
+    loader_destroy(&scene.loader);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,138 @@
+// Checks the big core selection on known cpufreq layouts, then measures
+// how a parallel_for over a fixed amount of work scales with the number of
+// job threads, checking every item ran once and that dependencies hold.
+//
+// cc -std=gnu11 -O2 -I src -pthread tests/jobs_bench.c src/jobs.c src/log.c -o jobs_bench -lm
+// ./jobs_bench [max threads] [items]
+
+#include "jobs.h"
+#include "log.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REPEATS 5
+#define GRAIN 1024
+#define DEPENDENCY_JOBS 100
+
+struct big_cores_case {
+    const char* name;
+    long max_freqs[8];
+    int cpu_count;
+    int expected[8];
+    int expected_count;
+};
+
+static const struct big_cores_case BIG_CORES_CASES[] = {
+        // Quest 2: 4 efficiency, 3 performance and 1 prime core
+        { "xr2", { 1804800, 1804800, 1804800, 1804800, 2419200, 2419200, 2419200, 2841600 }, 8,
+          { 4, 5, 6, 7 }, 4 },
+        { "two clusters", { 1000, 1000, 2000, 2000 }, 4, { 2, 3 }, 2 },
+        { "one cluster", { 2000, 2000, 2000, 2000 }, 4, { 0, 1, 2, 3 }, 4 },
+        { "no cpufreq", { 0, 0, 0, 0 }, 4, { 0, 1, 2, 3 }, 4 },
+        { "one core unknown", { 1000, 1000, 0, 2000 }, 4, { 3 }, 1 },
+};
+
+static bool check_big_cores() {
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(BIG_CORES_CASES) / sizeof(BIG_CORES_CASES[0]); i++) {
+        const struct big_cores_case* c = &BIG_CORES_CASES[i];
+        int cores[8];
+        int count = jobs_select_big_cores(c->max_freqs, c->cpu_count, cores, 8);
+        bool match = count == c->expected_count && memcmp(cores, c->expected, count * sizeof(int)) == 0;
+        printf("jobs: big cores, %s: %d cores %s\n", c->name, count, match ? "ok" : "FAIL");
+        ok &= match;
+    }
+    return ok;
+}
+
+static float* items;
+static atomic_int processed;
+static atomic_int first_stage;
+
+static double time_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void work(void* data, uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+        float x = items[i];
+        for (int k = 0; k < 32; k++) {
+            x = sinf(x) + 0.5f;
+        }
+        items[i] = x;
+    }
+    atomic_fetch_add(&processed, (int)(end - begin));
+}
+
+static void first(void* data) {
+    atomic_fetch_add(&first_stage, 1);
+}
+
+static void second(void* data) {
+    bool* ok = data;
+    if (atomic_load(&first_stage) != DEPENDENCY_JOBS) {
+        *ok = false;
+    }
+}
+
+int main(int argc, char** argv) {
+    int max_threads = argc > 1 ? atoi(argv[1]) : 4;
+    uint32_t item_count = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1 << 17;
+    if (max_threads < 1 || max_threads > JOBS_MAX_THREADS || item_count == 0) {
+        printf("usage: %s [max threads, 1 to %d] [items]\n", argv[0], JOBS_MAX_THREADS);
+        return EXIT_FAILURE;
+    }
+    log_init();
+    bool ok = check_big_cores();
+    items = malloc(item_count * sizeof(float));
+
+    double single_ms = 0.0;
+    for (int threads = 1; threads <= max_threads; threads++) {
+        struct jobs jobs;
+        jobs_create(&jobs, threads);
+        for (uint32_t i = 0; i < item_count; i++) {
+            items[i] = (float)i;
+        }
+        atomic_store(&processed, 0);
+        double best = 1e9;
+        for (int repeat = 0; repeat < REPEATS; repeat++) {
+            double start = time_ms();
+            jobs_parallel_for(&jobs, item_count, GRAIN, work, NULL);
+            best = fmin(best, time_ms() - start);
+        }
+        if (atomic_load(&processed) != REPEATS * (int)item_count) {
+            printf("FAIL: %d of %d items processed\n", atomic_load(&processed), REPEATS * (int)item_count);
+            ok = false;
+        }
+
+        bool order_ok = true;
+        struct job_counter first_counter = { 0 };
+        struct job_counter second_counter = { 0 };
+        atomic_store(&first_stage, 0);
+        for (int i = 0; i < DEPENDENCY_JOBS; i++) {
+            jobs_run(&jobs, first, NULL, &first_counter);
+        }
+        for (int i = 0; i < DEPENDENCY_JOBS / 2; i++) {
+            jobs_run_after(&jobs, second, &order_ok, &second_counter, &first_counter);
+        }
+        jobs_wait(&jobs, &second_counter);
+        if (!order_ok) {
+            printf("FAIL: a job ran before its dependency finished\n");
+            ok = false;
+        }
+
+        if (threads == 1) {
+            single_ms = best;
+        }
+        printf("jobs: %d threads, %u items in %.2f ms, %.2fx\n", threads, item_count, best, single_ms / best);
+        jobs_destroy(&jobs);
+    }
+    free(items);
+    log_shutdown();
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
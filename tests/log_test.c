@@ -0,0 +1,86 @@
+// Checks the async log: messages from several threads all come out, none
+// are lost while the ring has room, and the drain thread sleeps instead of
+// polling when there is nothing to write.
+//
+// cc -std=gnu11 -O2 -I src -pthread tests/log_test.c src/log.c -o log_test && ./log_test
+
+#include "log.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#define THREAD_COUNT 4
+#define MESSAGES_PER_BURST 16
+#define BURST_COUNT 20
+
+static int64_t time_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleep_ms(int ms) {
+    struct timespec duration = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&duration, NULL);
+}
+
+static void* producer_main(void* param) {
+    for (int burst = 0; burst < BURST_COUNT; burst++) {
+        for (int i = 0; i < MESSAGES_PER_BURST; i++) {
+            // errors, so the rate limit stays out of it
+            log_write(LOG_CATEGORY_APP, LOG_PRIORITY_ERROR, "thread %ld burst %d message %d", (long)param,
+                      burst, i);
+        }
+        sleep_ms(2);
+    }
+    return NULL;
+}
+
+int main() {
+    // the messages themselves are not interesting here
+    if (freopen("/dev/null", "w", stderr) == NULL) {
+        return EXIT_FAILURE;
+    }
+    log_init();
+
+    pthread_t threads[THREAD_COUNT];
+    for (long i = 0; i < THREAD_COUNT; i++) {
+        pthread_create(&threads[i], NULL, producer_main, (void*)i);
+    }
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // with nothing logged, the whole process should be all but idle
+    sleep_ms(20);
+    int64_t cpu_start = time_ns(CLOCK_PROCESS_CPUTIME_ID);
+    sleep_ms(500);
+    int64_t idle_cpu = time_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+
+    // and a message after the idle period still gets out promptly
+    log_write(LOG_CATEGORY_APP, LOG_PRIORITY_ERROR, "after idle");
+    log_shutdown();
+
+    struct log_stats stats;
+    log_get_stats(&stats);
+    uint64_t expected = THREAD_COUNT * BURST_COUNT * MESSAGES_PER_BURST + 1;
+    printf("log: %llu written, %llu ring full, %.3f ms cpu while idle for 500 ms\n",
+           (unsigned long long)stats.written[LOG_CATEGORY_APP],
+           (unsigned long long)stats.overflowed[LOG_CATEGORY_APP], idle_cpu / 1e6);
+    if (stats.written[LOG_CATEGORY_APP] + stats.overflowed[LOG_CATEGORY_APP] != expected) {
+        printf("FAIL: expected %llu messages\n", (unsigned long long)expected);
+        return EXIT_FAILURE;
+    }
+    if (stats.overflowed[LOG_CATEGORY_APP] != 0) {
+        printf("FAIL: ring full with room to spare\n");
+        return EXIT_FAILURE;
+    }
+    if (idle_cpu > 1000000) {
+        printf("FAIL: the drain thread is busy while there is nothing to write\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
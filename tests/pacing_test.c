@@ -0,0 +1,134 @@
+// Runs the refresh rate policy over synthetic frame time traces against a
+// simulated display: each frame is shown at the first vsync after its work
+// is done, at the pacing interval, and missed frames are judged from the
+// display times the way the app does.
+//
+// cc -std=gnu11 -O2 -I src tests/pacing_test.c src/pacing.c -o pacing_test -lm && ./pacing_test
+
+#include "pacing.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct display {
+    int64_t time;
+    int64_t previous_time;
+    uint32_t frames;
+    uint32_t missed;
+    uint32_t changes;
+};
+
+typedef float (*trace_fn)(uint32_t frame);
+
+// Runs frame_count frames of trace, requesting rate changes as the policy
+// asks, which the simulated runtime grants straight away.
+static void display_run(struct display* display, struct pacing* pacing, trace_fn trace, uint32_t frame_count) {
+    for (uint32_t i = 0; i < frame_count; i++) {
+        float frame_ms = trace(display->frames);
+        int64_t period = (int64_t)(1e9 / pacing_rate(pacing));
+        int64_t work = (int64_t)(frame_ms * 1e6);
+        // shown on the first vsync the work is done by, interval vsyncs apart at the least
+        int64_t periods = (work + period - 1) / period;
+        display->time += period * (periods > pacing->interval ? periods : pacing->interval);
+
+        bool missed = pacing_missed(pacing, display->previous_time, display->time, period);
+        display->previous_time = display->time;
+        display->missed += missed;
+        display->frames++;
+        float rate;
+        if (pacing_update(pacing, frame_ms, missed, &rate)) {
+            pacing_rate_changed(pacing, rate);
+            display->changes++;
+        }
+    }
+}
+
+// a little noise so nothing lands exactly on a boundary
+static float jitter(uint32_t frame) {
+    return (float)((frame * 2654435761u) >> 24) / 256.0f * 0.5f;
+}
+
+static float light_trace(uint32_t frame) {
+    return 5.0f + jitter(frame);
+}
+
+static float heavy_trace(uint32_t frame) {
+    return 13.0f + jitter(frame);
+}
+
+static float medium_trace(uint32_t frame) {
+    return 8.0f + jitter(frame);
+}
+
+// a hitch every 200 frames, otherwise light
+static float hitch_trace(uint32_t frame) {
+    return frame % 200 == 0 ? 30.0f : light_trace(frame);
+}
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    printf("pacing: %s: %s\n", what, condition ? "ok" : "FAIL");
+    failures += !condition;
+}
+
+int main() {
+    static const float RATES[] = { 90.0f, 72.0f, 120.0f, 80.0f };
+    struct pacing pacing;
+    struct display display;
+
+    // rates are sorted, and the current one found
+    pacing_init(&pacing, RATES, 4, 72.0f, 1);
+    expect(pacing.rates[0] == 72.0f && pacing.rates[3] == 120.0f && pacing_rate(&pacing) == 72.0f,
+           "rates sorted, current found");
+
+    // light frames climb to the top rate, and never miss on the way
+    display = (struct display) { 0 };
+    display_run(&display, &pacing, light_trace, 4000);
+    expect(pacing_rate(&pacing) == 120.0f, "light frames reach 120 Hz");
+    expect(display.missed == 0, "light frames never miss");
+
+    // heavy frames step down until they fit
+    display_run(&display, &pacing, heavy_trace, 2000);
+    expect(pacing_rate(&pacing) == 72.0f, "13 ms frames settle at 72 Hz");
+    uint32_t changes = display.changes;
+
+    // frames with headroom at 90 Hz but not at 120 Hz climb to 90 Hz only
+    display_run(&display, &pacing, medium_trace, 4000);
+    expect(pacing_rate(&pacing) == 90.0f, "8 ms frames settle at 90 Hz");
+    uint32_t missed = display.missed;
+    changes = display.changes;
+    display_run(&display, &pacing, medium_trace, 4000);
+    expect(display.changes == changes && display.missed == missed, "8 ms frames then stay put");
+
+    // an occasional hitch is not a reason to step down
+    pacing_init(&pacing, RATES, 4, 120.0f, 1);
+    display = (struct display) { 0 };
+    display_run(&display, &pacing, hitch_trace, 4000);
+    expect(display.missed > 0 && display.changes == 0, "occasional hitches keep the rate");
+
+    // with space warp every frame spans two display periods; that alone is
+    // not a miss, and light frames still climb
+    pacing_init(&pacing, RATES, 4, 72.0f, 2);
+    display = (struct display) { 0 };
+    display_run(&display, &pacing, light_trace, 4000);
+    expect(display.missed == 0, "interval 2 frames are not counted as missed");
+    expect(pacing_rate(&pacing) == 120.0f, "interval 2 light frames reach 120 Hz");
+
+    // at interval 2, 72 Hz gives 27.8 ms a frame: 30 ms frames miss
+    pacing_init(&pacing, RATES, 1, 90.0f, 2);
+    int64_t period = (int64_t)(1e9 / 90.0);
+    expect(!pacing_missed(&pacing, 1000, 1000 + 2 * period, period), "two periods at interval 2 is on time");
+    expect(pacing_missed(&pacing, 1000, 1000 + 3 * period, period), "three periods at interval 2 is missed");
+    expect(!pacing_missed(&pacing, 0, 1000, period), "first frame is never missed");
+    pacing_init(&pacing, RATES, 1, 90.0f, 1);
+    expect(pacing_missed(&pacing, 1000, 1000 + 2 * period, period), "two periods at interval 1 is missed");
+
+    // more rates than fit keeps the first ones
+    static const float MANY_RATES[] = { 60, 72, 80, 90, 96, 100, 110, 120, 144 };
+    pacing_init(&pacing, MANY_RATES, 9, 144.0f, 1);
+    expect(pacing.rate_count == PACING_MAX_RATES && pacing_rate(&pacing) == 120.0f, "extra rates dropped");
+
+    printf("pacing: %d failures\n", failures);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
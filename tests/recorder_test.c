@@ -0,0 +1,168 @@
+// Records a synthetic session to a trace and replays it: frame times and
+// views come back as recorded, frames recorded without views keep the live
+// ones, views the replaying app doesn't ask for are skipped, and session
+// state changes interleaved anywhere are stepped over. Also checks that the
+// trace reaches the file before it is closed, and that a file that isn't a
+// trace leaves the recorder off. The flush interval is static, so the
+// source is included rather than linked.
+//
+// cc -std=gnu11 -O2 -I src -I $OPENXR_HOME/include tests/recorder_test.c src/log.c -o recorder_test -pthread
+// ./recorder_test
+
+#include "recorder.c"
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FRAMES 200
+#define VIEWS 2
+#define PERIOD 13888889
+
+static XrTime frame_time(uint32_t frame) {
+    return 1000000000LL + (XrTime)frame * PERIOD;
+}
+
+// some frames aren't rendered, so they have no views
+static bool frame_rendered(uint32_t frame) {
+    return frame % 5 != 4;
+}
+
+static void frame_views(uint32_t frame, XrView* views) {
+    for (uint32_t v = 0; v < VIEWS; v++) {
+        views[v] = (XrView) { XR_TYPE_VIEW };
+        views[v].pose.orientation.w = 1.0f;
+        views[v].pose.position = (XrVector3f) { (float)frame, (float)v, -1.0f };
+        views[v].fov = (XrFovf) { -0.8f - frame * 0.001f, 0.8f, 0.9f, -0.9f };
+    }
+}
+
+static long file_size(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+static bool record(const char* path) {
+    struct recorder recorder;
+    recorder_init(&recorder, RECORDER_RECORD, path);
+    if (recorder.mode != RECORDER_RECORD) {
+        printf("FAIL: can't record to %s\n", path);
+        return false;
+    }
+    // what has been written so far, all of which a flush puts on disk
+    long written = sizeof(struct recorder_file_header);
+    for (uint32_t i = 0; i < FRAMES; i++) {
+        if (i % 50 == 0) {
+            recorder_session_state(&recorder, (XrSessionState)(1 + i / 50), frame_time(i) - 1);
+            written += sizeof(struct record_header) + sizeof(struct record_session_state);
+        }
+        XrFrameState frame_state = { XR_TYPE_FRAME_STATE };
+        frame_state.predictedDisplayTime = frame_time(i);
+        frame_state.predictedDisplayPeriod = PERIOD;
+        frame_state.shouldRender = frame_rendered(i);
+        recorder_frame(&recorder, &frame_state);
+        written += sizeof(struct record_header) + sizeof(struct record_frame);
+        if (i + 1 == RECORDER_FLUSH_FRAMES && file_size(path) != written) {
+            printf("FAIL: %ld of %ld bytes on disk after %d frames\n", file_size(path), written,
+                   RECORDER_FLUSH_FRAMES);
+            recorder_close(&recorder);
+            return false;
+        }
+        // between a frame and its views
+        if (i % 7 == 3) {
+            recorder_session_state(&recorder, XR_SESSION_STATE_FOCUSED, frame_time(i));
+            written += sizeof(struct record_header) + sizeof(struct record_session_state);
+        }
+        if (frame_rendered(i)) {
+            XrViewState view_state = { XR_TYPE_VIEW_STATE };
+            view_state.viewStateFlags = i;
+            XrView views[VIEWS];
+            frame_views(i, views);
+            recorder_views(&recorder, &view_state, views, VIEWS);
+            written += sizeof(struct record_header) + sizeof(struct record_views);
+        }
+    }
+    recorder_close(&recorder);
+    return true;
+}
+
+static bool replay(const char* path) {
+    struct recorder recorder;
+    recorder_init(&recorder, RECORDER_REPLAY, path);
+    if (!recorder_replaying(&recorder)) {
+        printf("FAIL: can't replay %s\n", path);
+        return false;
+    }
+    uint32_t replaced = 0;
+    for (uint32_t i = 0; i < FRAMES; i++) {
+        // the live runtime runs at a different time
+        XrFrameState frame_state = { XR_TYPE_FRAME_STATE };
+        frame_state.predictedDisplayTime = 5 * frame_time(i);
+        XrTime time = recorder_frame(&recorder, &frame_state);
+        if (time != frame_time(i)) {
+            printf("FAIL: frame %u replayed at %lld, recorded at %lld\n", i, (long long)time,
+                   (long long)frame_time(i));
+            recorder_close(&recorder);
+            return false;
+        }
+        // the replaying app doesn't render every frame the recording did
+        if (i % 11 == 10) {
+            continue;
+        }
+        XrViewState view_state = { XR_TYPE_VIEW_STATE };
+        view_state.viewStateFlags = UINT32_MAX;
+        XrView views[VIEWS];
+        frame_views(UINT16_MAX, views);
+        recorder_views(&recorder, &view_state, views, VIEWS);
+        uint32_t expected = frame_rendered(i) ? i : UINT16_MAX;
+        XrView expected_views[VIEWS];
+        frame_views(expected, expected_views);
+        if (view_state.viewStateFlags != (frame_rendered(i) ? i : UINT32_MAX) ||
+            memcmp(&views[0].pose, &expected_views[0].pose, sizeof(XrPosef)) != 0 ||
+            memcmp(&views[1].pose, &expected_views[1].pose, sizeof(XrPosef)) != 0 ||
+            memcmp(&views[1].fov, &expected_views[1].fov, sizeof(XrFovf)) != 0) {
+            printf("FAIL: frame %u has the views of frame %.0f, expected %s\n", i, views[0].pose.position.x,
+                   frame_rendered(i) ? "the recorded ones" : "the live ones");
+            recorder_close(&recorder);
+            return false;
+        }
+        replaced += frame_rendered(i);
+    }
+    XrFrameState frame_state = { XR_TYPE_FRAME_STATE };
+    frame_state.predictedDisplayTime = 42;
+    if (recorder_frame(&recorder, &frame_state) != 42 || recorder_replaying(&recorder) ||
+        recorder.frames != FRAMES) {
+        printf("FAIL: replay didn't end after %d frames\n", FRAMES);
+        recorder_close(&recorder);
+        return false;
+    }
+    recorder_close(&recorder);
+    printf("replayed %d frames, views of %u\n", FRAMES, replaced);
+    return true;
+}
+
+static bool replay_garbage(const char* path) {
+    FILE* file = fopen(path, "wb");
+    fputs("not a trace", file);
+    fclose(file);
+    struct recorder recorder;
+    recorder_init(&recorder, RECORDER_REPLAY, path);
+    bool off = recorder.mode == RECORDER_OFF;
+    recorder_close(&recorder);
+    if (!off) {
+        printf("FAIL: replaying a file that isn't a trace\n");
+    }
+    return off;
+}
+
+int main() {
+    char path[] = "/tmp/recorder_test_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("FAIL: can't make a temp file\n");
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    bool ok = record(path) && replay(path) && replay_garbage(path);
+    unlink(path);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
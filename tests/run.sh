@@ -0,0 +1,34 @@
+#!/bin/bash
+# Builds and runs the host tests and benchmarks in tests/ with the host
+# compiler. Each test prints what it measured and exits non-zero on failure.
+# Tests of the XR side need the OpenXR headers, found as in build.sh.
+set -e
+cd $(dirname $0)/..
+OPENXR_HOME=${OPENXR_HOME:-~/dev/OpenXR-SDK}
+CC=${CC:-cc}
+CFLAGS="-std=gnu11 -O2 -Wall -I src -I $OPENXR_HOME/include -pthread"
+OUT=$(mktemp -d)
+trap "rm -rf $OUT" EXIT
+
+run() {
+    name=$1
+    shift
+    echo "== $name"
+    $CC $CFLAGS tests/$name.c "$@" -o $OUT/$name -lm
+    $OUT/$name
+}
+
+run cmd_ring_test
+run log_test src/log.c
+run trace_test src/trace.c
+run foveation_test src/foveation.c src/log.c
+run pacing_test src/pacing.c
+run entities_bench src/entities.c src/jobs.c src/arena.c src/log.c
+run transforms_test src/transforms.c src/jobs.c src/arena.c src/log.c
+run jobs_bench src/jobs.c src/log.c
+run draw_list_test src/draw_list.c src/entities.c src/jobs.c src/arena.c src/log.c
+run geometry_heap_test src/loader.c src/log.c -lEGL -lGLESv2
+run gl_capture_test src/gl_capture.c src/loader.c src/log.c -DENABLE_GL_CAPTURE=1 -lEGL -lGLESv2
+run recorder_test src/log.c
+run bench_test src/arena.c src/log.c
+echo "all tests passed"
@@ -0,0 +1,91 @@
+// Checks that the trace file only gets an end for every begin that was
+// written, when tracing starts or stops inside a scope and when scopes nest
+// deeper than the trace keeps track of.
+//
+// cc -std=gnu11 -O2 -I src -pthread tests/trace_test.c src/trace.c -o trace_test && ./trace_test
+
+#include "trace.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEEP 100
+
+static void count_events(const char* path, int* begins, int* ends) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    char line[512];
+    *begins = 0;
+    *ends = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        *begins += strstr(line, "\"ph\":\"B\"") != NULL;
+        *ends += strstr(line, "\"ph\":\"E\"") != NULL;
+    }
+    fclose(file);
+}
+
+static bool check(const char* what, int begins, int ends, int expected) {
+    printf("trace: %s: %d begins, %d ends\n", what, begins, ends);
+    if (begins != expected || ends != expected) {
+        printf("FAIL: expected %d of each\n", expected);
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    char path[] = "/tmp/trace_test_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return EXIT_FAILURE;
+    }
+    setenv("HELLO_QUEST_TRACE_FILE", path, 1);
+    bool ok = true;
+    int begins, ends;
+
+    // started inside a scope: the outer end must not be written
+    trace_begin("outer");
+    trace_init();
+    {
+        TRACE_SCOPE("inner");
+    }
+    trace_end("outer");
+    trace_shutdown();
+    count_events(path, &begins, &ends);
+    ok &= check("started inside a scope", begins, ends, 1);
+
+    // stopped inside a scope: the end goes nowhere, and the scopes of the
+    // next trace still pair up
+    trace_init();
+    trace_begin("stopped");
+    trace_shutdown();
+    trace_end("stopped");
+    trace_init();
+    TRACE_BEGIN("after");
+    TRACE_END("after");
+    trace_shutdown();
+    count_events(path, &begins, &ends);
+    ok &= check("stopped inside a scope", begins, ends, 1);
+
+    // deeper than the trace keeps track of
+    trace_init();
+    for (int i = 0; i < DEEP; i++) {
+        trace_begin("deep");
+    }
+    for (int i = 0; i < DEEP; i++) {
+        trace_end("deep");
+    }
+    TRACE_BEGIN("after");
+    TRACE_END("after");
+    trace_shutdown();
+    count_events(path, &begins, &ends);
+    ok &= check("nested deeper than tracked", begins, ends, 65);
+
+    remove(path);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,151 @@
+// Checks transforms_multiply_batch, which is NEON on arm64, against the
+// scalar XrMatrix4x4f_Multiply, and a random hierarchy against a naive
+// walk up the parents, after a full and after a partial update, with and
+// without the job system. Built on an x86 host it checks the scalar path
+// against itself; build it on an arm64 host to check NEON.
+//
+// cc -std=gnu11 -O2 -I src -I $OPENXR_HOME/include -pthread tests/transforms_test.c src/transforms.c src/jobs.c src/arena.c src/log.c -o transforms_test -lm
+// ./transforms_test
+
+#include "jobs.h"
+#include "log.h"
+#include "transforms.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BATCH 10000
+#define NODES 20000
+// relative to the largest element of the product
+#define TOLERANCE 1e-5f
+
+static uint32_t random_state = 1;
+
+static float random_float(float range) {
+    random_state = random_state * 1664525u + 1013904223u;
+    return ((float)(random_state >> 8) / (float)(1u << 24) * 2.0f - 1.0f) * range;
+}
+
+static float max_difference(const XrMatrix4x4f* a, const XrMatrix4x4f* b) {
+    float scale = 1.0f;
+    float difference = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        scale = fmaxf(scale, fabsf(a->m[i]));
+        difference = fmaxf(difference, fabsf(a->m[i] - b->m[i]));
+    }
+    return difference / scale;
+}
+
+static bool check_batch() {
+    static XrMatrix4x4f a[BATCH], b[BATCH], results[BATCH];
+    static const XrMatrix4x4f* a_pointers[BATCH];
+    static const XrMatrix4x4f* b_pointers[BATCH];
+    static XrMatrix4x4f* result_pointers[BATCH];
+    for (int i = 0; i < BATCH; i++) {
+        // from small to large magnitudes, as scene scales and world positions get
+        float range = i % 3 == 0 ? 1.0f : i % 3 == 1 ? 100.0f : 10000.0f;
+        for (int k = 0; k < 16; k++) {
+            a[i].m[k] = random_float(range);
+            b[i].m[k] = random_float(range);
+        }
+        a_pointers[i] = &a[i];
+        b_pointers[i] = &b[i];
+        result_pointers[i] = &results[i];
+    }
+    transforms_multiply_batch(result_pointers, a_pointers, b_pointers, BATCH);
+    float worst = 0.0f;
+    for (int i = 0; i < BATCH; i++) {
+        XrMatrix4x4f expected;
+        XrMatrix4x4f_Multiply(&expected, &a[i], &b[i]);
+        worst = fmaxf(worst, max_difference(&expected, &results[i]));
+    }
+    printf("transforms: batch of %d, worst relative difference %g\n", BATCH, worst);
+    return worst <= TOLERANCE;
+}
+
+static uint32_t parents[NODES];
+static XrMatrix4x4f locals[NODES];
+
+static void naive_world(uint32_t node, XrMatrix4x4f* world) {
+    if (parents[node] == TRANSFORM_ROOT) {
+        *world = locals[node];
+        return;
+    }
+    XrMatrix4x4f parent;
+    naive_world(parents[node], &parent);
+    XrMatrix4x4f_Multiply(world, &parent, &locals[node]);
+}
+
+static void random_local(XrMatrix4x4f* local) {
+    XrVector3f translation = { random_float(1.0f), random_float(1.0f), random_float(1.0f) };
+    float angle = random_float(3.14159f);
+    XrQuaternionf rotation = { 0.0f, sinf(angle / 2), 0.0f, cosf(angle / 2) };
+    XrVector3f scale = { 1.0f, 1.0f, 1.0f };
+    XrMatrix4x4f_CreateTranslationRotationScale(local, &translation, &rotation, &scale);
+}
+
+static bool check_hierarchy(struct transforms* transforms, const char* what) {
+    float worst = 0.0f;
+    for (uint32_t i = 0; i < NODES; i++) {
+        XrMatrix4x4f expected;
+        naive_world(i, &expected);
+        worst = fmaxf(worst, max_difference(&expected, transforms_world(transforms, i)));
+    }
+    printf("transforms: %s: %u updated, worst relative difference %g\n", what, transforms->stats.updated, worst);
+    return worst <= TOLERANCE;
+}
+
+static bool check_update(struct jobs* jobs) {
+    struct transforms transforms;
+    transforms_create(&transforms, NODES);
+    random_state = 7;
+    for (uint32_t i = 0; i < NODES; i++) {
+        // mostly chains a few deep, with some new roots, added in any order
+        uint32_t parent = i == 0 || i % 50 == 0 ? TRANSFORM_ROOT : (uint32_t)(random_state % i);
+        random_state = random_state * 1664525u + 1013904223u;
+        uint32_t node = transforms_add(&transforms, parent);
+        if (node != i) {
+            printf("FAIL: node ids are not handed out in order\n");
+            return false;
+        }
+        parents[i] = parent;
+        random_local(&locals[i]);
+        transforms_set_local(&transforms, i, &locals[i]);
+    }
+    bool ok = true;
+    transforms_update(&transforms, jobs);
+    ok &= check_hierarchy(&transforms, jobs != NULL ? "full update, jobs" : "full update");
+
+    // a few dirty nodes anywhere in the tree
+    for (int i = 0; i < 20; i++) {
+        uint32_t node = (uint32_t)(random_state % NODES);
+        random_state = random_state * 1664525u + 1013904223u;
+        random_local(&locals[node]);
+        transforms_set_local(&transforms, node, &locals[node]);
+    }
+    transforms_update(&transforms, jobs);
+    ok &= transforms.stats.updated < NODES;
+    ok &= check_hierarchy(&transforms, jobs != NULL ? "partial update, jobs" : "partial update");
+    transforms_destroy(&transforms);
+    return ok;
+}
+
+int main() {
+    log_init();
+#ifdef __ARM_NEON
+    printf("transforms: NEON batch path\n");
+#else
+    printf("transforms: scalar batch path\n");
+#endif
+    bool ok = check_batch();
+    ok &= check_update(NULL);
+    struct jobs jobs;
+    jobs_create(&jobs, 2);
+    ok &= check_update(&jobs);
+    jobs_destroy(&jobs);
+    log_shutdown();
+    if (!ok) {
+        printf("FAIL: transforms differ from the scalar reference\n");
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
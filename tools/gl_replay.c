@@ -0,0 +1,731 @@
+// Replays a capture written by src/gl_capture.c on a host GLES 3 context -
+// Mesa's llvmpipe will do - and reports, per kind of call, how often it
+// was made, how often it changed no state, and the CPU time it took.
+//
+//   cc -O2 -I src tools/gl_replay.c -o gl_replay -lEGL -lGLESv2
+//   ./gl_replay [-r passes] [-f] frames.glcapture
+//
+// -r replays the whole capture that many times; objects are only created
+// on the first pass. -f finishes after every call, so the time of a call
+// includes the GPU work it caused instead of leaving it to the next call
+// that has to wait for it.
+
+#include "gl_capture.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2ext.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define REPLAY_MAX_OBJECTS 256
+#define REPLAY_MAX_UNIFORMS 64
+#define REPLAY_MAX_CAPS 16
+
+static const char* OP_NAMES[GL_CAPTURE_OP_END] = {
+        "frame", "program", "buffer", "vertex array", "texture", "framebuffer",
+        "glBindFramebuffer", "glFramebufferTexture2D", "glEnable", "glDisable", "glClearColor", "glClear",
+        "glViewport", "glScissor", "glInvalidateFramebuffer", "glBlitFramebuffer", "glUseProgram",
+        "glUniformMatrix4fv", "glBindVertexArray", "glDrawElements", "glDrawElementsBaseVertex", "glFlush",
+};
+
+// Captured object names mapped to the ones created here.
+struct name_map {
+    uint32_t captured[REPLAY_MAX_OBJECTS];
+    GLuint host[REPLAY_MAX_OBJECTS];
+    uint32_t count;
+};
+
+struct replay_uniform {
+    GLint captured;
+    GLint host;
+    // last value set, to spot redundant updates
+    bool set;
+    GLfloat value[16];
+};
+
+struct replay_program {
+    uint32_t captured;
+    GLuint host;
+    struct replay_uniform uniforms[REPLAY_MAX_UNIFORMS];
+    uint32_t uniform_count;
+};
+
+struct op_stats {
+    uint64_t calls;
+    uint64_t redundant;
+    uint64_t errors;
+    int64_t ns;
+};
+
+struct replay {
+    bool finish_each_call;
+    struct name_map buffers;
+    struct name_map vertex_arrays;
+    struct name_map textures;
+    struct name_map framebuffers;
+    struct replay_program programs[REPLAY_MAX_OBJECTS];
+    uint32_t program_count;
+
+    // state as far as the capture has set it
+    struct replay_program* program;
+    uint32_t vertex_array;
+    uint32_t draw_framebuffer;
+    uint32_t read_framebuffer;
+    GLenum caps[REPLAY_MAX_CAPS];
+    bool cap_enabled[REPLAY_MAX_CAPS];
+    uint32_t cap_count;
+    bool viewport_set;
+    uint32_t viewport[4];
+    bool scissor_set;
+    uint32_t scissor[4];
+    bool clear_color_set;
+    uint32_t clear_color[4];
+
+    struct op_stats ops[GL_CAPTURE_OP_END];
+    uint64_t frames;
+    int64_t frame_ns;
+    int64_t frame_min_ns;
+    int64_t frame_max_ns;
+    int64_t frame_start;
+};
+
+struct reader {
+    const uint32_t* words;
+    uint32_t count;
+    uint32_t at;
+};
+
+static PFNGLDRAWELEMENTSBASEVERTEXOESPROC draw_elements_base_vertex = NULL;
+
+static void fail(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "gl_replay: ");
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    exit(EXIT_FAILURE);
+}
+
+static int64_t time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static uint32_t read_word(struct reader* reader) {
+    if (reader->at >= reader->count) {
+        fail("truncated record");
+    }
+    return reader->words[reader->at++];
+}
+
+static const void* read_bytes(struct reader* reader, uint32_t* size) {
+    *size = read_word(reader);
+    uint32_t count = (*size + 3) / 4;
+    if (reader->at + count > reader->count) {
+        fail("truncated record");
+    }
+    const void* bytes = &reader->words[reader->at];
+    reader->at += count;
+    return bytes;
+}
+
+// The string is copied, the caller frees it.
+static char* read_string(struct reader* reader) {
+    uint32_t size;
+    const void* bytes = read_bytes(reader, &size);
+    char* string = malloc(size + 1);
+    memcpy(string, bytes, size);
+    string[size] = '\0';
+    return string;
+}
+
+static bool name_map_find(const struct name_map* map, uint32_t captured, GLuint* host) {
+    if (captured == 0) {
+        *host = 0;
+        return true;
+    }
+    for (uint32_t i = 0; i < map->count; i++) {
+        if (map->captured[i] == captured) {
+            *host = map->host[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static GLuint name_map_get(const struct name_map* map, uint32_t captured, const char* kind) {
+    GLuint host;
+    if (!name_map_find(map, captured, &host)) {
+        fail("capture uses %s %u before describing it", kind, captured);
+    }
+    return host;
+}
+
+static void name_map_add(struct name_map* map, uint32_t captured, GLuint host) {
+    if (map->count == REPLAY_MAX_OBJECTS) {
+        fail("too many objects");
+    }
+    map->captured[map->count] = captured;
+    map->host[map->count] = host;
+    map->count++;
+}
+
+static struct replay_program* replay_find_program(struct replay* replay, uint32_t captured) {
+    for (uint32_t i = 0; i < replay->program_count; i++) {
+        if (replay->programs[i].captured == captured) {
+            return &replay->programs[i];
+        }
+    }
+    return NULL;
+}
+
+static GLuint compile_shader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status == GL_FALSE) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        fail("can't compile shader: %s", log);
+    }
+    return shader;
+}
+
+static void replay_create_program(struct replay* replay, struct reader* reader) {
+    uint32_t captured = read_word(reader);
+    if (replay_find_program(replay, captured) != NULL) {
+        return;
+    }
+    if (replay->program_count == REPLAY_MAX_OBJECTS) {
+        fail("too many programs");
+    }
+    struct replay_program* program = &replay->programs[replay->program_count++];
+    program->captured = captured;
+    program->host = glCreateProgram();
+    char* vertex_source = read_string(reader);
+    char* fragment_source = read_string(reader);
+    GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_source);
+    GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+    free(vertex_source);
+    free(fragment_source);
+    glAttachShader(program->host, vertex_shader);
+    glAttachShader(program->host, fragment_shader);
+    uint32_t attrib_count = read_word(reader);
+    for (uint32_t i = 0; i < attrib_count; i++) {
+        GLint location = (GLint)read_word(reader);
+        char* name = read_string(reader);
+        if (location >= 0) {
+            glBindAttribLocation(program->host, (GLuint)location, name);
+        }
+        free(name);
+    }
+    glLinkProgram(program->host);
+    GLint status;
+    glGetProgramiv(program->host, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE) {
+        char log[1024];
+        glGetProgramInfoLog(program->host, sizeof(log), NULL, log);
+        fail("can't link program %u: %s", captured, log);
+    }
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    uint32_t uniform_count = read_word(reader);
+    for (uint32_t i = 0; i < uniform_count; i++) {
+        GLint location = (GLint)read_word(reader);
+        char* name = read_string(reader);
+        if (program->uniform_count < REPLAY_MAX_UNIFORMS) {
+            struct replay_uniform* uniform = &program->uniforms[program->uniform_count++];
+            uniform->captured = location;
+            uniform->host = glGetUniformLocation(program->host, name);
+            uniform->set = false;
+        }
+        free(name);
+    }
+}
+
+static void replay_create_buffer(struct replay* replay, struct reader* reader) {
+    uint32_t captured = read_word(reader);
+    GLuint buffer;
+    if (name_map_find(&replay->buffers, captured, &buffer)) {
+        return;
+    }
+    uint32_t size;
+    const void* data = read_bytes(reader, &size);
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, data, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    name_map_add(&replay->buffers, captured, buffer);
+}
+
+static void replay_create_vertex_array(struct replay* replay, struct reader* reader) {
+    uint32_t captured = read_word(reader);
+    GLuint vertex_array;
+    if (name_map_find(&replay->vertex_arrays, captured, &vertex_array)) {
+        return;
+    }
+    glGenVertexArrays(1, &vertex_array);
+    glBindVertexArray(vertex_array);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, name_map_get(&replay->buffers, read_word(reader), "buffer"));
+    uint32_t attrib_count = read_word(reader);
+    for (uint32_t i = 0; i < attrib_count; i++) {
+        uint32_t index = read_word(reader);
+        GLint size = (GLint)read_word(reader);
+        GLenum type = read_word(reader);
+        GLboolean normalized = (GLboolean)read_word(reader);
+        GLsizei stride = (GLsizei)read_word(reader);
+        GLuint buffer = name_map_get(&replay->buffers, read_word(reader), "buffer");
+        uintptr_t offset = read_word(reader);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glEnableVertexAttribArray(index);
+        glVertexAttribPointer(index, size, type, normalized, stride, (const void*)offset);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    name_map_add(&replay->vertex_arrays, captured, vertex_array);
+    glBindVertexArray(name_map_get(&replay->vertex_arrays, replay->vertex_array, "vertex array"));
+}
+
+static void replay_create_texture(struct replay* replay, struct reader* reader) {
+    uint32_t captured = read_word(reader);
+    GLuint texture;
+    if (name_map_find(&replay->textures, captured, &texture)) {
+        return;
+    }
+    GLsizei width = (GLsizei)read_word(reader);
+    GLsizei height = (GLsizei)read_word(reader);
+    GLenum format = read_word(reader);
+    if (width <= 0 || height <= 0 || format == 0) {
+        fprintf(stderr, "gl_replay: texture %u has no size, replaying it as 1x1 RGBA8\n", captured);
+        width = 1;
+        height = 1;
+        format = GL_RGBA8;
+    }
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+    if (glGetError() != GL_NO_ERROR) {
+        fail("can't create a %dx%d texture of format 0x%04x", width, height, format);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    name_map_add(&replay->textures, captured, texture);
+}
+
+static void replay_create_framebuffer(struct replay* replay, struct reader* reader) {
+    uint32_t captured = read_word(reader);
+    GLuint framebuffer;
+    if (name_map_find(&replay->framebuffers, captured, &framebuffer)) {
+        return;
+    }
+    static const GLenum ATTACHMENTS[] = { GL_COLOR_ATTACHMENT0, GL_DEPTH_ATTACHMENT, GL_STENCIL_ATTACHMENT };
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    for (int i = 0; i < 3; i++) {
+        GLuint texture = name_map_get(&replay->textures, read_word(reader), "texture");
+        if (texture != 0) {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, ATTACHMENTS[i], GL_TEXTURE_2D, texture, 0);
+        }
+    }
+    name_map_add(&replay->framebuffers, captured, framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, name_map_get(&replay->framebuffers, replay->draw_framebuffer, "framebuffer"));
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, name_map_get(&replay->framebuffers, replay->read_framebuffer, "framebuffer"));
+}
+
+static bool replay_set_cap(struct replay* replay, GLenum cap, bool enabled) {
+    for (uint32_t i = 0; i < replay->cap_count; i++) {
+        if (replay->caps[i] == cap) {
+            bool redundant = replay->cap_enabled[i] == enabled;
+            replay->cap_enabled[i] = enabled;
+            return redundant;
+        }
+    }
+    if (replay->cap_count < REPLAY_MAX_CAPS) {
+        replay->caps[replay->cap_count] = cap;
+        replay->cap_enabled[replay->cap_count] = enabled;
+        replay->cap_count++;
+    }
+    return false;
+}
+
+// Returns whether the words are what was set last time, and remembers them.
+static bool replay_set_words(bool* set, uint32_t* state, const uint32_t* words, uint32_t count) {
+    bool redundant = *set && memcmp(state, words, count * sizeof(uint32_t)) == 0;
+    memcpy(state, words, count * sizeof(uint32_t));
+    *set = true;
+    return redundant;
+}
+
+static void replay_frame(struct replay* replay) {
+    if (replay->frame_start != 0) {
+        glFinish();
+        int64_t ns = time_ns() - replay->frame_start;
+        replay->frames++;
+        replay->frame_ns += ns;
+        if (replay->frame_min_ns == 0 || ns < replay->frame_min_ns) {
+            replay->frame_min_ns = ns;
+        }
+        if (ns > replay->frame_max_ns) {
+            replay->frame_max_ns = ns;
+        }
+    }
+    replay->frame_start = time_ns();
+}
+
+// Makes one captured call, returns whether it changed no state.
+static bool replay_call(struct replay* replay, enum gl_capture_op op, struct reader* reader) {
+    uint32_t args[10];
+    switch (op) {
+        case GL_CAPTURE_BIND_FRAMEBUFFER: {
+            GLenum target = read_word(reader);
+            uint32_t captured = read_word(reader);
+            bool redundant = false;
+            if (target == GL_FRAMEBUFFER) {
+                redundant = replay->draw_framebuffer == captured && replay->read_framebuffer == captured;
+                replay->draw_framebuffer = captured;
+                replay->read_framebuffer = captured;
+            } else if (target == GL_DRAW_FRAMEBUFFER) {
+                redundant = replay->draw_framebuffer == captured;
+                replay->draw_framebuffer = captured;
+            } else {
+                redundant = replay->read_framebuffer == captured;
+                replay->read_framebuffer = captured;
+            }
+            glBindFramebuffer(target, name_map_get(&replay->framebuffers, captured, "framebuffer"));
+            return redundant;
+        }
+        case GL_CAPTURE_FRAMEBUFFER_TEXTURE_2D: {
+            GLenum target = read_word(reader);
+            GLenum attachment = read_word(reader);
+            GLenum textarget = read_word(reader);
+            GLuint texture = name_map_get(&replay->textures, read_word(reader), "texture");
+            GLint level = (GLint)read_word(reader);
+            glFramebufferTexture2D(target, attachment, textarget, texture, level);
+            return false;
+        }
+        case GL_CAPTURE_ENABLE: {
+            GLenum cap = read_word(reader);
+            glEnable(cap);
+            return replay_set_cap(replay, cap, true);
+        }
+        case GL_CAPTURE_DISABLE: {
+            GLenum cap = read_word(reader);
+            glDisable(cap);
+            return replay_set_cap(replay, cap, false);
+        }
+        case GL_CAPTURE_CLEAR_COLOR: {
+            for (int i = 0; i < 4; i++) {
+                args[i] = read_word(reader);
+            }
+            GLfloat color[4];
+            memcpy(color, args, sizeof(color));
+            glClearColor(color[0], color[1], color[2], color[3]);
+            return replay_set_words(&replay->clear_color_set, replay->clear_color, args, 4);
+        }
+        case GL_CAPTURE_CLEAR:
+            glClear(read_word(reader));
+            return false;
+        case GL_CAPTURE_VIEWPORT:
+        case GL_CAPTURE_SCISSOR: {
+            for (int i = 0; i < 4; i++) {
+                args[i] = read_word(reader);
+            }
+            if (op == GL_CAPTURE_VIEWPORT) {
+                glViewport((GLint)args[0], (GLint)args[1], (GLsizei)args[2], (GLsizei)args[3]);
+                return replay_set_words(&replay->viewport_set, replay->viewport, args, 4);
+            }
+            glScissor((GLint)args[0], (GLint)args[1], (GLsizei)args[2], (GLsizei)args[3]);
+            return replay_set_words(&replay->scissor_set, replay->scissor, args, 4);
+        }
+        case GL_CAPTURE_INVALIDATE_FRAMEBUFFER: {
+            GLenum target = read_word(reader);
+            GLsizei count = (GLsizei)read_word(reader);
+            GLenum attachments[8];
+            if (count > 8) {
+                fail("invalidating too many attachments");
+            }
+            for (GLsizei i = 0; i < count; i++) {
+                attachments[i] = read_word(reader);
+            }
+            glInvalidateFramebuffer(target, count, attachments);
+            return false;
+        }
+        case GL_CAPTURE_BLIT_FRAMEBUFFER:
+            for (int i = 0; i < 10; i++) {
+                args[i] = read_word(reader);
+            }
+            glBlitFramebuffer((GLint)args[0], (GLint)args[1], (GLint)args[2], (GLint)args[3],
+                              (GLint)args[4], (GLint)args[5], (GLint)args[6], (GLint)args[7],
+                              args[8], args[9]);
+            return false;
+        case GL_CAPTURE_USE_PROGRAM: {
+            uint32_t captured = read_word(reader);
+            struct replay_program* program = captured != 0 ? replay_find_program(replay, captured) : NULL;
+            if (captured != 0 && program == NULL) {
+                fail("capture uses program %u before describing it", captured);
+            }
+            bool redundant = replay->program == program;
+            replay->program = program;
+            glUseProgram(program != NULL ? program->host : 0);
+            return redundant;
+        }
+        case GL_CAPTURE_UNIFORM_MATRIX_4FV: {
+            GLint location = (GLint)read_word(reader);
+            GLsizei count = (GLsizei)read_word(reader);
+            GLboolean transpose = (GLboolean)read_word(reader);
+            if (reader->at + 16 * (uint32_t)count > reader->count) {
+                fail("truncated record");
+            }
+            const GLfloat* value = (const GLfloat*)&reader->words[reader->at];
+            reader->at += 16 * (uint32_t)count;
+            struct replay_uniform* uniform = NULL;
+            for (uint32_t i = 0; replay->program != NULL && i < replay->program->uniform_count; i++) {
+                if (replay->program->uniforms[i].captured == location) {
+                    uniform = &replay->program->uniforms[i];
+                }
+            }
+            if (uniform == NULL) {
+                fail("capture sets uniform %d that its program doesn't have", location);
+            }
+            glUniformMatrix4fv(uniform->host, count, transpose, value);
+            bool redundant = count == 1 && uniform->set && memcmp(uniform->value, value, sizeof(uniform->value)) == 0;
+            if (count == 1) {
+                memcpy(uniform->value, value, sizeof(uniform->value));
+                uniform->set = true;
+            }
+            return redundant;
+        }
+        case GL_CAPTURE_BIND_VERTEX_ARRAY: {
+            uint32_t captured = read_word(reader);
+            bool redundant = replay->vertex_array == captured;
+            replay->vertex_array = captured;
+            glBindVertexArray(name_map_get(&replay->vertex_arrays, captured, "vertex array"));
+            return redundant;
+        }
+        case GL_CAPTURE_DRAW_ELEMENTS:
+        case GL_CAPTURE_DRAW_ELEMENTS_BASE_VERTEX: {
+            GLenum mode = read_word(reader);
+            GLsizei count = (GLsizei)read_word(reader);
+            GLenum type = read_word(reader);
+            const void* offset = (const void*)(uintptr_t)read_word(reader);
+            if (op == GL_CAPTURE_DRAW_ELEMENTS) {
+                glDrawElements(mode, count, type, offset);
+            } else {
+                draw_elements_base_vertex(mode, count, type, offset, (GLint)read_word(reader));
+            }
+            return false;
+        }
+        case GL_CAPTURE_FLUSH:
+            glFlush();
+            return false;
+        default:
+            fail("unknown op %u", op);
+            return false;
+    }
+}
+
+static void replay_pass(struct replay* replay, const uint8_t* data, size_t size) {
+    size_t offset = 0;
+    while (offset + sizeof(struct gl_capture_header) <= size) {
+        struct gl_capture_header header;
+        memcpy(&header, data + offset, sizeof(header));
+        offset += sizeof(header);
+        if (offset + header.size > size || header.size % 4 != 0 || header.op >= GL_CAPTURE_OP_END) {
+            fail("corrupt capture at byte %zu", offset);
+        }
+        struct reader reader = { (const uint32_t*)(data + offset), header.size / 4, 0 };
+        offset += header.size;
+
+        switch (header.op) {
+            case GL_CAPTURE_FRAME:
+                replay_frame(replay);
+                continue;
+            case GL_CAPTURE_PROGRAM:
+                replay_create_program(replay, &reader);
+                continue;
+            case GL_CAPTURE_BUFFER:
+                replay_create_buffer(replay, &reader);
+                continue;
+            case GL_CAPTURE_VERTEX_ARRAY:
+                replay_create_vertex_array(replay, &reader);
+                continue;
+            case GL_CAPTURE_TEXTURE:
+                replay_create_texture(replay, &reader);
+                continue;
+            case GL_CAPTURE_FRAMEBUFFER:
+                replay_create_framebuffer(replay, &reader);
+                continue;
+            default:
+                break;
+        }
+
+        struct op_stats* stats = &replay->ops[header.op];
+        int64_t start = time_ns();
+        bool redundant = replay_call(replay, header.op, &reader);
+        if (replay->finish_each_call) {
+            glFinish();
+        }
+        stats->ns += time_ns() - start;
+        stats->calls++;
+        stats->redundant += redundant;
+        if (glGetError() != GL_NO_ERROR) {
+            stats->errors++;
+        }
+    }
+    if (offset != size) {
+        fail("capture ends in the middle of a record");
+    }
+    replay_frame(replay);
+    replay->frame_start = 0;
+}
+
+static uint8_t* load_capture(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        fail("can't open %s", path);
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    struct gl_capture_file_header header;
+    if (length < (long)sizeof(header) || fread(&header, sizeof(header), 1, file) != 1 ||
+        header.magic != GL_CAPTURE_MAGIC || header.version != GL_CAPTURE_VERSION) {
+        fail("%s is not a version %d gl capture", path, GL_CAPTURE_VERSION);
+    }
+    *size = (size_t)length - sizeof(header);
+    uint8_t* data = malloc(*size);
+    if (data == NULL || fread(data, 1, *size, file) != *size) {
+        fail("can't read %s", path);
+    }
+    fclose(file);
+    return data;
+}
+
+static void egl_create() {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display != NULL) {
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+        fail("can't initialize EGL");
+    }
+    static const EGLint CONFIG_ATTRIBS[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT_KHR,
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_NONE,
+    };
+    EGLConfig config;
+    EGLint config_count = 0;
+    if (!eglChooseConfig(display, CONFIG_ATTRIBS, &config, 1, &config_count) || config_count == 0) {
+        fail("no GLES 3 EGL config");
+    }
+    static const EGLint CONTEXT_ATTRIBS[] = { EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, CONTEXT_ATTRIBS);
+    if (context == EGL_NO_CONTEXT) {
+        fail("can't create a GLES 3 context");
+    }
+    // nothing is drawn to a surface, but not every EGL can do without one
+    static const EGLint SURFACE_ATTRIBS[] = { EGL_WIDTH, 16, EGL_HEIGHT, 16, EGL_NONE };
+    EGLSurface surface = eglCreatePbufferSurface(display, config, SURFACE_ATTRIBS);
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        fail("can't make the GLES 3 context current");
+    }
+    static const char* NAMES[] = {
+            "glDrawElementsBaseVertex", "glDrawElementsBaseVertexOES", "glDrawElementsBaseVertexEXT",
+    };
+    for (size_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]) && draw_elements_base_vertex == NULL; i++) {
+        draw_elements_base_vertex = (PFNGLDRAWELEMENTSBASEVERTEXOESPROC)eglGetProcAddress(NAMES[i]);
+    }
+    if (draw_elements_base_vertex == NULL) {
+        fail("no glDrawElementsBaseVertex");
+    }
+    printf("replaying on %s | %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+}
+
+static void replay_report(const struct replay* replay, uint32_t passes) {
+    int order[GL_CAPTURE_OP_END];
+    int count = 0;
+    uint64_t calls = 0;
+    uint64_t redundant = 0;
+    int64_t ns = 0;
+    for (int op = 0; op < GL_CAPTURE_OP_END; op++) {
+        const struct op_stats* stats = &replay->ops[op];
+        if (stats->calls > 0) {
+            order[count++] = op;
+            calls += stats->calls;
+            redundant += stats->redundant;
+            ns += stats->ns;
+        }
+    }
+    // most expensive first
+    for (int i = 1; i < count; i++) {
+        for (int j = i; j > 0 && replay->ops[order[j]].ns > replay->ops[order[j - 1]].ns; j--) {
+            int op = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = op;
+        }
+    }
+
+    printf("%llu frames in %u passes, %llu calls, %llu redundant\n\n", (unsigned long long)replay->frames, passes,
+           (unsigned long long)calls, (unsigned long long)redundant);
+    printf("%-26s %9s %9s %10s %9s %6s\n", "call", "calls", "redundant", "total ms", "avg us", "errors");
+    for (int i = 0; i < count; i++) {
+        const struct op_stats* stats = &replay->ops[order[i]];
+        printf("%-26s %9llu %9llu %10.3f %9.2f %6llu\n", OP_NAMES[order[i]], (unsigned long long)stats->calls,
+               (unsigned long long)stats->redundant, stats->ns / 1e6, stats->ns / 1e3 / stats->calls,
+               (unsigned long long)stats->errors);
+    }
+    printf("%-26s %9llu %9llu %10.3f\n\n", "total", (unsigned long long)calls, (unsigned long long)redundant,
+           ns / 1e6);
+    if (replay->frames > 0) {
+        printf("frame, with glFinish: avg %.3f ms, min %.3f ms, max %.3f ms\n",
+               replay->frame_ns / 1e6 / replay->frames, replay->frame_min_ns / 1e6, replay->frame_max_ns / 1e6);
+    }
+}
+
+int main(int argc, char** argv) {
+    static struct replay replay;
+    uint32_t passes = 1;
+    int option;
+    while ((option = getopt(argc, argv, "r:f")) != -1) {
+        switch (option) {
+            case 'r':
+                passes = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+            case 'f':
+                replay.finish_each_call = true;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-r passes] [-f] capture\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc - 1 || passes == 0) {
+        fprintf(stderr, "usage: %s [-r passes] [-f] capture\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    size_t size;
+    uint8_t* data = load_capture(argv[optind], &size);
+    egl_create();
+    for (uint32_t pass = 0; pass < passes; pass++) {
+        replay_pass(&replay, data, size);
+    }
+    replay_report(&replay, passes);
+    free(data);
+    return EXIT_SUCCESS;
+}